@@ -28,11 +28,14 @@
  processing, LED animations, and filtering algorithms, allowing you to
  focus on understanding the core GSR sensing concepts.
 
- Library files: GSRVisualizer.h and GSRVisualizer.cpp
+ Library: Workshop1_HTPAAC/libraries/GSRVisualizer (shared with 2_Hard_Mode).
+ Copy or link that folder into your Arduino libraries folder, or set the
+ sketchbook location to Workshop1_HTPAAC. This sketch builds only its basic
+ tier (GSRBasic), so none of the Hard Mode web serial code is uploaded.
 */
 
 #include <Adafruit_NeoPixel.h>
-#include "GSRVisualizer.h"  // Our custom library for clean, modular code
+#include <GSRVisualizer.h>  // Our custom library for clean, modular code
 
 //━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
 //                         HARDWARE CONFIGURATION
@@ -90,8 +93,12 @@ void setup() {
 
   strip.show();              // Turn off all LEDs initially
 
-  // Initialize visualizer
-  visualizer = new GSRVisualizer(strip, 10);
+  // Initialize visualizer: basic tier, 10-sample moving average, NUM_LEDS
+  // pixels. From here on it owns the strip: draw through visualizer->
+  // beginFrame() / setPixel() / showFrame(), not strip.setPixelColor() and
+  // strip.show(). strip.setBrightness() keeps working.
+  static FixedGSRVisualizer<GSRBasic, 10, NUM_LEDS> gsrVisualizer(strip);
+  visualizer = &gsrVisualizer;
 
   // Initialize arrays
   initializeArrays();
@@ -251,13 +258,15 @@ void checkForSpikes() {
   if (change > spikeThreshold && !inSpike) {
     inSpike = true;
 
-    // Flash LEDs red during spike
-    for (int i = 0; i < NUM_LEDS; i++) {
-      if (millis() % 200 < 100) {
-        strip.setPixelColor(i, strip.Color(255, 0, 0));
+    // Flash LEDs red during spike (through the visualizer, so brightness
+    // and the power limit still apply)
+    if (millis() % 200 < 100) {
+      visualizer->beginFrame();
+      for (int i = 0; i < NUM_LEDS; i++) {
+        visualizer->setPixel(i, 255, 0, 0);
       }
+      visualizer->showFrame();
     }
-    strip.show();
   } else if (change < spikeThreshold * 0.2 && inSpike) {
     inSpike = false;
   }
@@ -292,7 +301,7 @@ void outputSerialData() {
 
 //────────────────────────────────────────────────────────────────────────
 // Note: All complex signal processing and LED functions are now in the
-// GSRVisualizer library. See GSRVisualizer.h and GSRVisualizer.cpp
+// GSRVisualizer library. See libraries/GSRVisualizer/src/GSRVisualizer.h
 //────────────────────────────────────────────────────────────────────────
 
 //━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
@@ -23,14 +23,33 @@
  • Allows easy reuse of functions between projects
  • Keeps advanced features organized and accessible
 
+ The library lives in Workshop1_HTPAAC/libraries/GSRVisualizer and is shared
+ with 1_Hardware_Starter. Copy or link that folder into your Arduino
+ libraries folder (or set the sketchbook location to Workshop1_HTPAAC).
+ This sketch builds it with every feature tier (GSRHardMode); the starter
+ only builds the basic one.
+
  Library Components:
- • GSRVisualizer.h - Header file with class definitions
+ • GSRVisualizer.h - Header file with class definitions and feature tiers
  • GSRVisualizer.cpp - Implementation of all methods
+ • WebSerialLink.h/.cpp - Telemetry, status and commands over Serial
+ • LEDEffects.h/.cpp - Effect registry (add your own LED effects here)
+ • LEDPalette.h/.cpp - Precomputed gamma-corrected color palettes
+ • PowerLimiter.h/.cpp - Keeps the LED strip inside a current budget
+ • DitheredFrame.h/.cpp - 16-bit LED frame with temporal dithering
+ • CommandParser.h/.cpp - Allocation-free command line parser
+ • TelemetryCodec.h/.cpp - Binary telemetry frames (COBS + CRC)
+ • SerialQueue.h/.cpp - Non-blocking transmit queue (loop never waits on USB)
+ • PipelineStats.h/.cpp - Loop/LED/serial counters for the STATS command
+ • SessionLogger.h/.cpp - Saves samples to flash without slowing sampling
  • Handles: signal processing, LED animations, web serial, and more
 
  KEY FEATURES:
  ------------
  • Real-time GSR data streaming to browser (JSON format)
+ • Optional binary telemetry: every sample as a full record
+ • Batched raw capture at the full sample rate (~3 bytes/sample)
+ • Session log on the board's flash, incl. the seconds before each SCR
  • Bidirectional communication with p5.js
  • Advanced LED animations with trail effects
  • Group-based color coding for workshops
@@ -41,10 +60,18 @@
  • GSR Sensor → GPIO 2 (ESP32) or A0 (Arduino)
  • LED Strip → GPIO 3 (ESP32) or Pin 6 (Arduino)
  • Serial → 115200 baud for Web Serial API
+ • Session logging (LOG: commands) needs an ESP32: it writes to LittleFS
+   from its own FreeRTOS task. Other boards build without it and answer
+   LOG: commands with LOG_UNSUPPORTED.
 */
 
 #include <Adafruit_NeoPixel.h>
-#include "GSRVisualizer.h"  // Our custom library for clean, modular code
+#include <GSRVisualizer.h>  // Our custom library for clean, modular code
+#include <CommandParser.h>  // Fixed-size command buffer (no String, no heap)
+#if defined(ESP32)
+#include <SessionLogger.h>  // Ring-buffered session log on flash
+#include <LittleFS.h>
+#endif
 
 //━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
 //                         HARDWARE CONFIGURATION
@@ -54,6 +81,13 @@ const int GSR_PIN = 2;     // Analog pin for GSR sensor
 const int LED_PIN = 3;     // Digital pin for LED strip
 const int NUM_LEDS = 20;   // Number of LEDs
 
+//──────── LED Power Budget ────────
+// The visualizer dims frames that would draw more than this from the supply.
+// USB ports give ~500 mA; leave room for the ESP32 itself. 0 = no limit.
+const int POWER_BUDGET_MA = 400;      // Total current allowed for the strip
+const int LED_MA_PER_CHANNEL = 20;    // WS2812: ~20 mA per color at full value
+const int LED_IDLE_MA = 1;            // Current of one LED that is off
+
 /*████████████████████████████████████████████████████████████████████
 ██ CHALLENGE #1: SET YOUR GROUP NUMBER!                               ██
 ██ ➤ Change to your group number (1-5)                                ██
@@ -67,13 +101,18 @@ const int GROUP_NUMBER = 1; // Your group number (1-5)
 //━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
 
 Adafruit_NeoPixel strip(NUM_LEDS, LED_PIN, NEO_GRB + NEO_KHZ800);
-GSRVisualizer* visualizer;
+
+// All feature tiers: web serial, LED effects and simulation. Buffers are
+// sized at compile time (10-sample moving average, NUM_LEDS pixels).
+typedef FixedGSRVisualizer<GSRHardMode, 10, NUM_LEDS> HardModeVisualizer;
+HardModeVisualizer* visualizer;
 
 //━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
 //                         SENSOR VARIABLES
 //━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
 
 int gsrValue = 0;
+unsigned long sampleMicros = 0;  // When gsrValue was read
 int gsrMin = 1023;
 int gsrMax = 0;
 bool isCalibrated = false;
@@ -86,8 +125,7 @@ float emaDerivative = 0;
 float baseline = 0;
 
 //──────── Web Serial Variables ────────
-String inputBuffer = "";
-unsigned long lastSendTime = 0;
+LineAssembler commandLine;  // Collects incoming bytes until '\n'
 
 /*████████████████████████████████████████████████████████████████████
 ██ CHALLENGE #2: ADJUST DATA SENDING FREQUENCY!                       ██
@@ -96,6 +134,26 @@ unsigned long lastSendTime = 0;
 ██ ➤ 100 = Send data 10 times/second (less network traffic)          ██
 ████████████████████████████████████████████████████████████████████*/
 const int SEND_INTERVAL = 50;   // Send data every 50ms (20Hz)
+                                // p5.js can change it without reflashing: RATE:hz
+
+//──────── Timing ────────
+const unsigned long SAMPLE_INTERVAL = 10;  // Read the sensor every 10ms (100Hz)
+const int BATCH_FLUSH_MS = 200;            // TELEMETRY:BATCH sends at least every 200ms
+const int LED_REFRESH_HZ = 200;            // Re-send dithered LED frames in between
+unsigned long lastSampleTime = 0;
+
+//──────── Session Logging (ESP32) ────────
+// LOG:START saves every sample, LOG:SCR only the moments around each skin
+// conductance response (SCR), including the seconds BEFORE it was detected.
+#if defined(ESP32)
+const float SCR_RISE = 2.0;           // EMA rise per sample that starts an SCR
+bool inScr = false;
+const char* LOG_PATH = "/session.log";
+const int PRE_TRIGGER_SECONDS = 5;    // Kept in RAM until an SCR happens
+const int POST_TRIGGER_SECONDS = 10;
+SessionLogger sessionLog(1024);       // ~10 s of samples at 100 Hz (12 KB)
+FileLogSink logFile(LittleFS, LOG_PATH);  // SD works too: FileLogSink(SD, ...)
+#endif
 
 //━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
 //                            SETUP
@@ -110,16 +168,33 @@ void setup() {
   strip.setBrightness(50);
   strip.show();
 
-  // Create visualizer
-  visualizer = new GSRVisualizer(strip, 10);
+  // Create visualizer: its buffers are part of the object, so it never uses
+  // the heap. static keeps it alive after setup() returns.
+  static HardModeVisualizer gsrVisualizer(strip);
+  visualizer = &gsrVisualizer;
   visualizer->setGroupNumber(GROUP_NUMBER);
+  visualizer->setLEDCurrentProfile(LED_MA_PER_CHANNEL, LED_IDLE_MA);
+  visualizer->setPowerBudget(POWER_BUDGET_MA);
+  visualizer->setRefreshRate(LED_REFRESH_HZ);
+  visualizer->setBatchFlushInterval(BATCH_FLUSH_MS);
+  visualizer->setTelemetryRate(1000 / SEND_INTERVAL);
+
+#if defined(ESP32)
+  // Session log: pages are written by a low-priority task, never by loop()
+  if (LittleFS.begin(true)) {   // true = format on first use
+    sessionLog.setSink(&logFile);
+  }
+  sessionLog.setPreTrigger(PRE_TRIGGER_SECONDS * 1000 / SAMPLE_INTERVAL,
+                           POST_TRIGGER_SECONDS * 1000 / SAMPLE_INTERVAL);
+  sessionLog.startWriterTask();
+#endif
 
   /*████████████████████████████████████████████████████████████████████
   ██ CHALLENGE #3: MODIFY ANIMATION TRAIL LENGTH!                       ██
-  ██ ➤ In GSRVisualizer constructor above, change the trail length:     ██
+  ██ ➤ The trail effects live in the library's LEDEffects.cpp:          ██
   ██ ➤ Default trail = 5 LEDs                                           ██
   ██ ➤ Try: 3 (short trail), 10 (long trail), 15 (very long)           ██
-  ██ ➤ To change: Edit the trailLength variable in the library          ██
+  ██ ➤ To change: Edit kTrailLength at the top of LEDEffects.cpp        ██
   ████████████████████████████████████████████████████████████████████*/
 
   // Send ready signal
@@ -134,10 +209,27 @@ void setup() {
 //━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
 
 void loop() {
-  // 1. Handle incoming commands
+  visualizer->getStats().loopStarted();
+
+  // 1. Handle incoming commands, send whatever output the port can take
   handleSerialInput();
+  visualizer->serviceSerial();
+
+  // Between samples, keep the LEDs refreshing: each refresh dithers the
+  // 16-bit frame again, which smooths dim fades (no delay() needed)
+  if (millis() - lastSampleTime < SAMPLE_INTERVAL) {
+    visualizer->refresh();
+    return;
+  }
+  // Late by a whole interval or more? Those sample slots were missed
+  unsigned long sinceLastSample = millis() - lastSampleTime;
+  if (lastSampleTime != 0 && sinceLastSample >= 2 * SAMPLE_INTERVAL) {
+    visualizer->getStats().countAdcOverruns(sinceLastSample / SAMPLE_INTERVAL - 1);
+  }
+  lastSampleTime = millis();
 
   // 2. Read and process sensor
+  sampleMicros = micros();
   gsrValue = analogRead(GSR_PIN);
   average = visualizer->calculateMovingAverage(gsrValue);
 
@@ -146,13 +238,23 @@ void loop() {
   emaValue = visualizer->applyExponentialFilter(gsrValue, emaValue);
   emaDerivative = emaValue - lastEmaValue;
 
-  // 4. Send data to p5.js
-  if (millis() - lastSendTime >= SEND_INTERVAL) {
-    visualizer->sendDataToP5(emaValue);
-    lastSendTime = millis();
+#if defined(ESP32)
+  // 4. Log the sample (a copy into RAM; the writer task saves it later)
+  bool scrStarted = !inScr && emaDerivative > SCR_RISE;
+  if (emaDerivative > SCR_RISE) {
+    inScr = true;
+  } else if (emaDerivative < SCR_RISE / 2) {
+    inScr = false;
   }
+  sessionLog.record(sampleMicros, gsrValue, emaValue, scrStarted);
+#endif
 
-  // 5. Update LED visualization
+  // 5. Send data to p5.js
+  // Called every sample: the library applies the rate, field set and flow
+  // control the host asked for (RATE:, FIELDS:, CREDIT:, TELEMETRY:)
+  visualizer->sendSample(sampleMicros, gsrValue, emaValue, emaDerivative, baseline);
+
+  // 6. Update LED visualization
   // Use the simple visualization by default (same as Hardware Starter)
   // Advanced modes can still be triggered via web serial commands
   if (visualizer->getLEDMode() == MODE_GSR_VISUALIZATION) {
@@ -167,10 +269,8 @@ void loop() {
   ██ CHALLENGE #4: CHANGE ANIMATION SPEED RESPONSE!                     ██
   ██ ➤ The animation speed is controlled by GSR changes                 ██
   ██ ➤ To make it more/less sensitive, modify the library's             ██
-  ██   visualizeGSR() function speed mapping                            ██
+  ██   drawTrail() speed mapping in LEDEffects.cpp                      ██
   ████████████████████████████████████████████████████████████████████*/
-
-  delay(10);
 }
 
 //━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
@@ -179,30 +279,56 @@ void loop() {
 
 void handleSerialInput() {
   while (Serial.available()) {
-    char c = Serial.read();
-
-    if (c == '\n') {
-      /*████████████████████████████████████████████████████████████████████
-      ██ CHALLENGE #5: ADD A CUSTOM COMMAND!                                ██
-      ██ ➤ Add your own command here before the library processes it        ██
-      ██ ➤ Example: if (inputBuffer == "BLINK") { // your code here }      ██
-      ██ ➤ You can control LEDs, send data back, or trigger effects        ██
-      ████████████████████████████████████████████████████████████████████*/
-
-      // Special handling for calibration command
-      if (inputBuffer == "CALIBRATE") {
-        performCalibration();
-      } else {
-        // Let the library handle all other commands
-        visualizer->processCommand(inputBuffer, emaValue, baseline);
-      }
-      inputBuffer = "";
-    } else if (c != '\r') {
-      inputBuffer += c;
+    visualizer->getStats().countBytesIn(1);
+    // feed() returns true once a whole line has arrived
+    if (!commandLine.feed(Serial.read())) {
+      continue;
+    }
+    char* line = commandLine.line();
+
+    /*████████████████████████████████████████████████████████████████████
+    ██ CHALLENGE #5: ADD A CUSTOM COMMAND!                                ██
+    ██ ➤ Add your own command here before the library processes it        ██
+    ██ ➤ Example: if (strcmp(line, "BLINK") == 0) { // your code here }  ██
+    ██ ➤ You can control LEDs, send data back, or trigger effects        ██
+    ████████████████████████████████████████████████████████████████████*/
+
+    // Special handling for calibration command
+    if (strcmp(line, "CALIBRATE") == 0) {
+      performCalibration();
+    } else if (strncmp(line, "LOG:", 4) == 0) {
+      handleLogCommand(line + 4);
+    } else {
+      // Let the library handle all other commands
+      visualizer->processCommand(line, emaValue, baseline);
     }
   }
 }
 
+void handleLogCommand(const char* action) {
+#if defined(ESP32)
+  if (strcmp(action, "START") == 0) {
+    sessionLog.start(LOG_CONTINUOUS, esp_random());
+    visualizer->sendStatus("LOG_STARTED");
+  } else if (strcmp(action, "SCR") == 0) {
+    sessionLog.start(LOG_TRIGGERED, esp_random());
+    visualizer->sendStatus("LOG_SCR_ARMED");
+  } else if (strcmp(action, "STOP") == 0) {
+    sessionLog.stop();
+    visualizer->sendStatus("LOG_STOPPED");
+  } else if (strcmp(action, "STATUS") == 0) {
+    char status[64];
+    snprintf(status, sizeof(status), "LOG_PAGES_%lu_LOST_%lu_ERRORS_%lu",
+             (unsigned long)sessionLog.getPagesWritten(),
+             (unsigned long)sessionLog.getOverruns(),
+             (unsigned long)sessionLog.getWriteErrors());
+    visualizer->sendStatus(status);
+  }
+#else
+  visualizer->sendStatus("LOG_UNSUPPORTED");
+#endif
+}
+
 //━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
 //                          CALIBRATION
 //━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
@@ -237,6 +363,7 @@ void performCalibration() {
 
     // Show calibration animation
     visualizer->showCalibrationAnimation();
+    visualizer->serviceSerial();
 
     delay(20);
   }
@@ -271,16 +398,58 @@ COMMANDS FROM P5.JS:
 • "{\"ema\":456.78}"    - Send simulated data
 • "LED:OFF"             - Turn off LEDs
 • "LED:GSR"             - GSR visualization
+• "LED:DOWNSTREAM"      - Downstream GSR visualization
 • "LED:RAINBOW"         - Rainbow effect
 • "LED:PULSE"           - Pulsing effect
 • "LED:COLOR:255,0,0"   - Set solid color (R,G,B)
 • "BRIGHTNESS:100"      - Set brightness (0-255)
+• "POWER:500"           - Set LED current budget in mA (0 = no limit)
+• "DITHER:0"            - Turn temporal dithering off (1 = on)
+• "TELEMETRY:BIN"       - Switch to binary frames (TELEMETRY:JSON = back)
+• "TELEMETRY:BATCH"     - Raw signal at full rate in batch frames
+• "RATE:50"             - Telemetry messages per second (0 = every sample)
+• "FIELDS:raw,ema"      - Fields to send: raw, ema, deriv, baseline, all
+• "SYNC:123456789"      - Clock sync: replies {"sync":[host,rx_us,tx_us]}
+• "CREDIT:20"           - Flow control: allow 20 more telemetry messages
+                          (keep granting as you read; CREDIT:OFF = free run)
 • "PING"                - Test connection
+• "STATS"               - Loop, LED, serial and memory counters
+• "STATS:RESET"         - Start counting again
+• "LOG:START"           - Save every sample to /session.log on the board
+• "LOG:SCR"             - Save only around SCRs (5 s before, 10 s after)
+• "LOG:STOP"            - Finish the session (the last page is written)
+• "LOG:STATUS"          - Replies LOG_PAGES_n_LOST_n_ERRORS_n
+                          (LOG: needs an ESP32; other boards reply
+                          LOG_UNSUPPORTED)
 
 DATA TO P5.JS:
 ─────────────
 • {"ema":value}         - Continuous GSR data
+• {"seq":n,"t":us,...}  - Continuous GSR data after FIELDS: (t = device
+                          micros() of the sample, for latency after SYNC)
 • {"status":"message"}  - Status updates
+• {"status":"TX_DROPPED_n"} - n telemetry messages dropped so far because
+                          the host was not reading fast enough
+• {"stats":{...}}       - Reply to STATS (meaning of each counter in
+                          PipelineStats.h)
+
+BINARY TELEMETRY (after "TELEMETRY:BIN"):
+────────────────────────────────────────
+Frames end with a 0x00 byte; COBS-decode, check the CRC-16, then read the
+type byte. Layout is in TelemetryCodec.h:
+• 0x01 SAMPLE           - seq, time_us, raw, ema, derivative, baseline
+• 0x02 STATUS           - Status text
+• 0x03 BATCH            - Up to 44 raw samples, delta + zigzag varints
+• 0x04 FIELDS           - Like SAMPLE, only the fields chosen with FIELDS:
+• 0x05 SYNC             - Reply to SYNC: (host time, device rx/tx time)
+• 0x06 STATS            - Reply to STATS
+Decode captures on a computer with host_tools/telemetry_decode.
+
+SESSION LOG (/session.log on LittleFS):
+──────────────────────────────────────
+512-byte pages with a CRC each, format in SessionLogger.h. Copy the file
+off the board (or use an SD card) and turn it into CSV with
+host_tools/logger_flashsim --decode.
 
 GROUP COLORS:
 ────────────
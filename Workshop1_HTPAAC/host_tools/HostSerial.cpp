@@ -0,0 +1,54 @@
+/*
+╔══════════════════════════════════════════════════════════════════════════╗
+║               HOST SERIAL & PSEUDO-TERMINAL HELPERS IMPLEMENTATION        ║
+╚══════════════════════════════════════════════════════════════════════════╝
+*/
+
+#include "HostSerial.h"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+int64_t hostMicros() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+int openSerialPort(const char* path, bool nonBlocking) {
+  int fd = open(path, O_RDWR | O_NOCTTY | (nonBlocking ? O_NONBLOCK : 0));
+  if (fd < 0) {
+    perror(path);
+    return -1;
+  }
+  makeRaw(fd);
+  return fd;
+}
+
+void makeRaw(int fd) {
+  struct termios tio;
+  if (tcgetattr(fd, &tio) == 0) {
+    cfmakeraw(&tio);
+    cfsetispeed(&tio, B115200);
+    cfsetospeed(&tio, B115200);
+    tcsetattr(fd, TCSANOW, &tio);
+  }
+}
+
+int openPseudoTerminal(char* slavePath, size_t size) {
+  int master = posix_openpt(O_RDWR | O_NOCTTY);
+  if (master < 0 || grantpt(master) < 0 || unlockpt(master) < 0) {
+    perror("posix_openpt");
+    return -1;
+  }
+  snprintf(slavePath, size, "%s", ptsname(master));
+  // Raw from the start, so bytes written before the reader opens the
+  // slave are not mangled by the line discipline
+  makeRaw(master);
+  return master;
+}
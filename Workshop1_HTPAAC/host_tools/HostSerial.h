@@ -0,0 +1,32 @@
+/*
+╔══════════════════════════════════════════════════════════════════════════╗
+║                    HOST SERIAL & PSEUDO-TERMINAL HELPERS                  ║
+║                   Shared by the host tools (Linux / macOS)                ║
+╚══════════════════════════════════════════════════════════════════════════╝
+
+ A pseudo-terminal (pty) is a pair of file descriptors that behaves like a
+ serial cable: the tools put a simulated device on the master side and
+ open the slave path (/dev/pts/N) exactly like /dev/ttyACM0.
+*/
+
+#ifndef HOST_SERIAL_H
+#define HOST_SERIAL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// CLOCK_MONOTONIC in microseconds
+int64_t hostMicros();
+
+// Opens a serial port (or pty slave) for reading and writing raw bytes.
+// Returns the fd, or -1 after printing why.
+int openSerialPort(const char* path, bool nonBlocking = false);
+
+// 115200 8N1, no echo, no line editing, no CR/LF translation
+void makeRaw(int fd);
+
+// Creates a pty pair, returns the master fd and writes the slave path
+// into slavePath. Returns -1 on failure.
+int openPseudoTerminal(char* slavePath, size_t size);
+
+#endif
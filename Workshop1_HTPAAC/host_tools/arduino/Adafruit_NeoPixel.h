@@ -0,0 +1,48 @@
+/*
+╔══════════════════════════════════════════════════════════════════════════╗
+║                  HOST STAND-IN FOR <Adafruit_NeoPixel.h>                  ║
+╚══════════════════════════════════════════════════════════════════════════╝
+
+ Keeps the pixels in memory and counts show() calls instead of driving a
+ data pin. Color(), ColorHSV() and gamma32() follow the real library's
+ math, so a test can compare the old per-pixel rainbow with the palette.
+*/
+
+#ifndef HOST_ADAFRUIT_NEOPIXEL_H
+#define HOST_ADAFRUIT_NEOPIXEL_H
+
+#include "Arduino.h"
+
+#define NEO_GRB 0
+#define NEO_KHZ800 0
+
+class Adafruit_NeoPixel {
+  public:
+    Adafruit_NeoPixel(uint16_t n, int16_t pin, int type);
+    ~Adafruit_NeoPixel();
+
+    void begin() {}
+    void show() { shows++; }
+    void setPixelColor(uint16_t n, uint8_t r, uint8_t g, uint8_t b);
+    void setPixelColor(uint16_t n, uint32_t c);
+    uint32_t getPixelColor(uint16_t n) const;
+    uint16_t numPixels() const { return count; }
+    uint8_t getBrightness() const { return brightness; }
+    void setBrightness(uint8_t b) { brightness = b; }
+
+    static uint32_t Color(uint8_t r, uint8_t g, uint8_t b) {
+      return ((uint32_t)r << 16) | ((uint32_t)g << 8) | b;
+    }
+    static uint32_t ColorHSV(uint16_t hue, uint8_t sat = 255, uint8_t val = 255);
+    static uint8_t gamma8(uint8_t x);
+    static uint32_t gamma32(uint32_t x);
+
+    unsigned long shows;
+
+  private:
+    uint16_t count;
+    uint8_t brightness;
+    uint32_t* pixels;
+};
+
+#endif
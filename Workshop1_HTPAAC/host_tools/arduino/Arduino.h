@@ -0,0 +1,86 @@
+/*
+╔══════════════════════════════════════════════════════════════════════════╗
+║                      HOST STAND-IN FOR <Arduino.h>                        ║
+║            Just enough of the Arduino core to run the library             ║
+╚══════════════════════════════════════════════════════════════════════════╝
+
+ The host self-tests (led_check, command_fuzz) compile the GSRVisualizer
+ library itself against this folder (-Iarduino). It is a generic board:
+ neither ESP32 nor __AVR__ is defined, so board-specific code stays out.
+
+ Serial is a Print that keeps what the library writes in memory. Like a
+ real port it has a TX buffer that fills as the library writes and only
+ empties when the test calls transmit(); its size can be set to that of
+ the board the test wants to look like (AVR 63, ESP32 UART 128, CDC 256).
+*/
+
+#ifndef HOST_ARDUINO_H
+#define HOST_ARDUINO_H
+
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <cmath>
+
+using std::abs;
+using std::max;
+using std::min;
+
+#define PROGMEM
+#define pgm_read_byte(addr) (*(const uint8_t*)(addr))
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+
+//━━━━━━━━━ Time ━━━━━━━━━
+// millis()/micros() follow the host clock; delay() really sleeps
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+
+long map(long x, long inMin, long inMax, long outMin, long outMax);
+
+//━━━━━━━━━ Serial ━━━━━━━━━
+
+class Print {
+  public:
+    virtual ~Print() {}
+    virtual size_t write(uint8_t c) = 0;
+    virtual size_t write(const uint8_t* buffer, size_t size);
+    virtual int availableForWrite() { return 0; }
+};
+
+class HostSerialPort : public Print {
+  public:
+    HostSerialPort();
+
+    size_t write(uint8_t c);
+    size_t write(const uint8_t* buffer, size_t size);
+    int availableForWrite();
+
+    int available();
+    int read();
+
+    //──────── Test Controls ────────
+    void setTxBuffer(int bytes);           // TX buffer size, also empties it
+    void transmit();                       // The port sent its TX buffer
+    void input(const char* text);          // Bytes the sketch will read()
+    const char* output() const;            // Everything written so far
+    size_t outputLength() const;
+    void clearOutput();
+
+  private:
+    int txBuffer;
+    int txFree;
+    char out[16384];
+    size_t outLength;
+    const char* in;
+};
+
+extern HostSerialPort Serial;
+
+#endif
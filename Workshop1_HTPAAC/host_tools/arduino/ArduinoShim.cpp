@@ -0,0 +1,206 @@
+/*
+╔══════════════════════════════════════════════════════════════════════════╗
+║                 HOST STAND-INS FOR THE ARDUINO CORE & STRIP               ║
+╚══════════════════════════════════════════════════════════════════════════╝
+*/
+
+#include "Arduino.h"
+#include "Adafruit_NeoPixel.h"
+
+#include <time.h>
+
+//━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+//                               TIME
+//━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+
+static uint64_t monotonicMicros() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000;
+}
+
+static const uint64_t bootMicros = monotonicMicros();
+
+unsigned long micros() {
+  return (unsigned long)(monotonicMicros() - bootMicros);
+}
+
+unsigned long millis() {
+  return (unsigned long)((monotonicMicros() - bootMicros) / 1000);
+}
+
+void delay(unsigned long ms) {
+  struct timespec ts = { (time_t)(ms / 1000), (long)(ms % 1000) * 1000000L };
+  nanosleep(&ts, nullptr);
+}
+
+long map(long x, long inMin, long inMax, long outMin, long outMax) {
+  if (inMax == inMin) {
+    return outMin;
+  }
+  return (x - inMin) * (outMax - outMin) / (inMax - inMin) + outMin;
+}
+
+//━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+//                              SERIAL
+//━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+
+size_t Print::write(const uint8_t* buffer, size_t size) {
+  size_t n = 0;
+  while (n < size && write(buffer[n])) {
+    n++;
+  }
+  return n;
+}
+
+HostSerialPort Serial;
+
+HostSerialPort::HostSerialPort() : txBuffer(256), txFree(256), outLength(0), in("") {
+}
+
+size_t HostSerialPort::write(uint8_t c) {
+  return write(&c, 1);
+}
+
+// Takes at most availableForWrite() bytes, like a full TX FIFO would
+size_t HostSerialPort::write(const uint8_t* buffer, size_t size) {
+  size_t n = min(size, (size_t)availableForWrite());
+  memcpy(out + outLength, buffer, n);
+  outLength += n;
+  txFree -= n;
+  return n;
+}
+
+int HostSerialPort::availableForWrite() {
+  return min((size_t)txFree, sizeof(out) - outLength);
+}
+
+int HostSerialPort::available() {
+  return strlen(in);
+}
+
+int HostSerialPort::read() {
+  if (*in == '\0') {
+    return -1;
+  }
+  return (uint8_t)*in++;
+}
+
+void HostSerialPort::setTxBuffer(int bytes) {
+  txBuffer = bytes;
+  txFree = bytes;
+}
+
+void HostSerialPort::transmit() {
+  txFree = txBuffer;
+}
+
+void HostSerialPort::input(const char* text) {
+  in = text;
+}
+
+const char* HostSerialPort::output() const {
+  return out;
+}
+
+size_t HostSerialPort::outputLength() const {
+  return outLength;
+}
+
+void HostSerialPort::clearOutput() {
+  outLength = 0;
+}
+
+//━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+//                               STRIP
+//━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+
+Adafruit_NeoPixel::Adafruit_NeoPixel(uint16_t n, int16_t, int)
+  : shows(0), count(n), brightness(255), pixels(new uint32_t[n]()) {
+}
+
+Adafruit_NeoPixel::~Adafruit_NeoPixel() {
+  delete[] pixels;
+}
+
+void Adafruit_NeoPixel::setPixelColor(uint16_t n, uint8_t r, uint8_t g, uint8_t b) {
+  if (n < count) {
+    pixels[n] = Color(r, g, b);
+  }
+}
+
+void Adafruit_NeoPixel::setPixelColor(uint16_t n, uint32_t c) {
+  if (n < count) {
+    pixels[n] = c;
+  }
+}
+
+uint32_t Adafruit_NeoPixel::getPixelColor(uint16_t n) const {
+  return n < count ? pixels[n] : 0;
+}
+
+// Six 255-step ramps around the color wheel, then saturation and value
+uint32_t Adafruit_NeoPixel::ColorHSV(uint16_t hue, uint8_t sat, uint8_t val) {
+  uint8_t r, g, b;
+  hue = (hue * 1530L + 32768) / 65536;
+
+  if (hue < 510) {
+    b = 0;
+    if (hue < 255) {
+      r = 255;
+      g = hue;
+    } else {
+      r = 510 - hue;
+      g = 255;
+    }
+  } else if (hue < 1020) {
+    r = 0;
+    if (hue < 765) {
+      g = 255;
+      b = hue - 510;
+    } else {
+      g = 1020 - hue;
+      b = 255;
+    }
+  } else if (hue < 1530) {
+    g = 0;
+    if (hue < 1275) {
+      r = hue - 1020;
+      b = 255;
+    } else {
+      r = 255;
+      b = 1530 - hue;
+    }
+  } else {
+    r = 255;
+    g = b = 0;
+  }
+
+  uint32_t v1 = 1 + val;
+  uint16_t s1 = 1 + sat;
+  uint8_t s2 = 255 - sat;
+  return ((((((r * s1) >> 8) + s2) * v1) & 0xff00) << 8) |
+         (((((g * s1) >> 8) + s2) * v1) & 0xff00) |
+         (((((b * s1) >> 8) + s2) * v1) >> 8);
+}
+
+// Gamma 2.6 from a 256-entry table, as the real library stores in flash
+uint8_t Adafruit_NeoPixel::gamma8(uint8_t x) {
+  static uint8_t table[256];
+  static bool built = false;
+  if (!built) {
+    for (int i = 0; i < 256; i++) {
+      table[i] = (uint8_t)(pow(i / 255.0, 2.6) * 255.0 + 0.5);
+    }
+    built = true;
+  }
+  return table[x];
+}
+
+uint32_t Adafruit_NeoPixel::gamma32(uint32_t x) {
+  uint8_t* y = (uint8_t*)&x;
+  for (uint8_t i = 0; i < 4; i++) {
+    y[i] = gamma8(y[i]);
+  }
+  return x;
+}
@@ -0,0 +1,441 @@
+/*
+╔══════════════════════════════════════════════════════════════════════════╗
+║                       COMMAND PARSER FUZZ CHECK                           ║
+║      Random and over-long serial lines through the firmware's parser      ║
+╚══════════════════════════════════════════════════════════════════════════╝
+
+ Feeds random input byte by byte through LineAssembler, then hands every
+ complete line to WebSerialLink::processCommand() on a Hard Mode
+ visualizer, the same path 2_Hard_Mode's handleSerialInput() takes. The
+ library is built against the Arduino stand-ins in arduino/.
+
+ USAGE:
+ -----
+   command_fuzz 200000              (lines to send, fixed seed)
+   command_fuzz 200000 7            (another seed)
+   command_fuzz --replies           (STATS and PING through small TX buffers)
+
+ Lines are a mix of known commands with random arguments, random bytes,
+ and lines longer than GSR_COMMAND_MAX_LENGTH. operator new is counted
+ once the visualizer is built. It exits non-zero if anything allocates
+ while lines are parsed and run, or if a line longer than the buffer
+ comes out of LineAssembler instead of being dropped.
+
+ --replies asks for STATS and PING while telemetry runs, with the TX
+ buffer of each board (AVR 63 bytes, ESP32 UART 128, USB CDC 256), in
+ JSON and in batch mode. The STATS reply is longer than the smaller
+ buffers. It exits non-zero unless every reply arrives whole, nothing is
+ interleaved, and telemetry keeps flowing afterwards. It also checks that
+ telemetry discarded by a TELEMETRY: format switch is not counted as
+ dropped, and that CREDIT: grants that are negative or over 65535 are
+ ignored instead of wrapping.
+*/
+
+#include <Arduino.h>
+#include <Adafruit_NeoPixel.h>
+#include "GSRVisualizer.h"
+#include "CommandParser.h"
+#include "TelemetryCodec.h"
+#include "HostSerial.h"   // hostMicros
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <new>
+
+//━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+//                         ALLOCATION COUNTING
+//━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+
+static bool counting = false;
+static unsigned long allocations = 0;
+
+void* operator new(size_t size) {
+  if (counting) {
+    allocations++;
+  }
+  void* p = malloc(size ? size : 1);
+  if (p == nullptr) {
+    throw std::bad_alloc();
+  }
+  return p;
+}
+
+void* operator new[](size_t size) {
+  return operator new(size);
+}
+
+void operator delete(void* p) noexcept {
+  free(p);
+}
+
+void operator delete[](void* p) noexcept {
+  free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+  free(p);
+}
+
+void operator delete[](void* p, size_t) noexcept {
+  free(p);
+}
+
+//━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+//                           LINE GENERATOR
+//━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+
+static uint32_t rngState;
+
+// xorshift32: the same lines for the same seed on every machine
+static uint32_t nextRandom() {
+  rngState ^= rngState << 13;
+  rngState ^= rngState >> 17;
+  rngState ^= rngState << 5;
+  return rngState;
+}
+
+static const char* const kCommands[] = {
+  "PING", "GROUP", "BRIGHTNESS", "POWER", "DITHER", "TELEMETRY", "TELEMETRY:BIN",
+  "TELEMETRY:BATCH", "RATE", "FIELDS", "CREDIT", "SYNC", "STATS", "STATS:RESET",
+  "RESET", "LED", "LED:COLOR", "LED:RAINBOW", "LED:OFF", "sim", "{\"ema\"", "CALIBRATE",
+};
+#define COMMAND_COUNT (sizeof(kCommands) / sizeof(kCommands[0]))
+
+static const char kArgChars[] = "0123456789-+.,:; abcxyzBINJSONRESET\"{}";
+
+// Writes one line without its '\n'; returns its length
+static size_t makeLine(char* out, size_t capacity) {
+  size_t length = 0;
+  uint32_t kind = nextRandom() % 8;
+
+  if (kind < 5) {
+    // Known command, random arguments
+    const char* name = kCommands[nextRandom() % COMMAND_COUNT];
+    length = strlen(name);
+    memcpy(out, name, length);
+    if (nextRandom() % 4 != 0) {
+      out[length++] = ':';
+    }
+    size_t args = nextRandom() % 24;
+    while (args-- > 0 && length < capacity) {
+      out[length++] = kArgChars[nextRandom() % (sizeof(kArgChars) - 1)];
+    }
+  } else if (kind < 7) {
+    // Any byte but the line end
+    size_t bytes = nextRandom() % (GSR_COMMAND_MAX_LENGTH + 16);
+    while (bytes-- > 0 && length < capacity) {
+      char c = (char)(nextRandom() % 255 + 1);
+      out[length++] = c == '\n' ? ' ' : c;
+    }
+  } else {
+    // Well past the buffer: a real command followed by junk
+    const char* name = "LED:COLOR:";
+    length = strlen(name);
+    memcpy(out, name, length);
+    size_t target = GSR_COMMAND_MAX_LENGTH + 1 + nextRandom() % 400;
+    while (length < target && length < capacity) {
+      out[length++] = kArgChars[nextRandom() % (sizeof(kArgChars) - 1)];
+    }
+  }
+  return length;
+}
+
+// Bytes LineAssembler keeps: everything but '\r'
+static size_t keptLength(const char* line, size_t length) {
+  size_t kept = 0;
+  for (size_t i = 0; i < length; i++) {
+    if (line[i] != '\r') {
+      kept++;
+    }
+  }
+  return kept;
+}
+
+//━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+//                                 FUZZ
+//━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+
+static int fuzz(unsigned long lines, uint32_t seed) {
+  rngState = seed ? seed : 1;
+
+  Adafruit_NeoPixel strip(20, 0, NEO_GRB + NEO_KHZ800);
+  static FixedGSRVisualizer<GSRHardMode, 10, 20> visualizer(strip);
+  static LineAssembler assembler;
+  float emaValue = 500;
+  float baseline = 480;
+
+  unsigned long completed = 0;
+  unsigned long dropped = 0;
+  unsigned long tooLong = 0;
+  unsigned long bytes = 0;
+  char line[512];
+
+  counting = true;
+  int64_t start = hostMicros();
+
+  for (unsigned long n = 0; n < lines; n++) {
+    size_t length = makeLine(line, sizeof(line));
+    bool oversized = keptLength(line, length) > GSR_COMMAND_MAX_LENGTH;
+    line[length++] = '\n';
+    bytes += length;
+
+    for (size_t i = 0; i < length; i++) {
+      if (!assembler.feed(line[i])) {
+        continue;
+      }
+      char* command = assembler.line();
+      if (oversized || strlen(command) > GSR_COMMAND_MAX_LENGTH) {
+        tooLong++;
+        continue;
+      }
+      completed++;
+      visualizer.processCommand(command, emaValue, baseline);
+    }
+    if (oversized) {
+      dropped++;
+    }
+
+    // Keep the telemetry, replies and LEDs moving as loop() would
+    visualizer.sendSample(micros(), 500 + n % 37, emaValue, 0.5f, baseline);
+    visualizer.serviceSerial();
+    visualizer.refresh();
+    Serial.transmit();
+    Serial.clearOutput();
+  }
+
+  int64_t took = hostMicros() - start;
+  counting = false;
+
+  printf("lines:        %lu (%lu over %d bytes)\n", lines, dropped, GSR_COMMAND_MAX_LENGTH);
+  printf("processed:    %lu\n", completed);
+  printf("bytes:        %lu\n", bytes);
+  printf("time:         %.3f us/line, %.1f ns/byte\n",
+         (double)took / lines, took * 1000.0 / bytes);
+  printf("allocations:  %lu\n", allocations);
+
+  int failures = 0;
+  if (allocations != 0) {
+    fprintf(stderr, "FAIL: %lu heap allocations while parsing\n", allocations);
+    failures++;
+  }
+  if (tooLong != 0) {
+    fprintf(stderr, "FAIL: %lu lines longer than the buffer came out\n", tooLong);
+    failures++;
+  }
+  return failures == 0 ? 0 : 1;
+}
+
+//━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+//                      REPLIES THROUGH SMALL TX BUFFERS
+//━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+
+struct ReplyCount {
+  unsigned long telemetry;   // Sample lines or batch frames
+  unsigned long stats;
+  unsigned long pong;
+  unsigned long bad;         // Broken, cut short or mixed up
+};
+
+static void runCommand(WebSerialLink& link, const char* text, float& emaValue, float& baseline) {
+  char line[GSR_COMMAND_MAX_LENGTH + 1];
+  strncpy(line, text, sizeof(line) - 1);
+  line[sizeof(line) - 1] = '\0';
+  link.processCommand(line, emaValue, baseline);
+}
+
+// Objects opened in a line; -1 if the braces do not match up
+static int braces(const char* line, size_t size) {
+  int depth = 0;
+  int opened = 0;
+  for (size_t i = 0; i < size; i++) {
+    if (line[i] == '{') {
+      depth++;
+      opened++;
+    } else if (line[i] == '}' && --depth < 0) {
+      return -1;
+    }
+  }
+  return depth == 0 ? opened : -1;
+}
+
+// JSON: every line must be one whole object
+static ReplyCount countJsonLines(const char* out, size_t length) {
+  ReplyCount count = {0, 0, 0, 0};
+  const char* end = out + length;
+  while (out < end) {
+    const char* next = (const char*)memchr(out, '\n', end - out);
+    if (next == nullptr) {
+      break;   // Still going out
+    }
+    size_t size = next - out + 1;
+    bool stats = strncmp(out, "{\"stats\":{", 10) == 0;
+    if (size < 4 || out[0] != '{' || memcmp(next - 2, "}\r", 2) != 0 ||
+        braces(out, size) != (stats ? 2 : 1)) {
+      count.bad++;
+    } else if (stats) {
+      count.stats++;
+    } else if (strncmp(out, "{\"status\":\"PONG\"}", 17) == 0) {
+      count.pong++;
+    } else if (strncmp(out, "{\"ema\":", 7) == 0) {
+      count.telemetry++;
+    }
+    out = next + 1;
+  }
+  return count;
+}
+
+// Binary: every 0x00-delimited frame must pass COBS and CRC
+static ReplyCount countFrames(const char* out, size_t length) {
+  ReplyCount count = {0, 0, 0, 0};
+  uint8_t frame[512];
+  size_t frameLength = 0;
+  for (size_t i = 0; i < length; i++) {
+    if (out[i] != 0) {
+      if (frameLength < sizeof(frame)) {
+        frame[frameLength++] = out[i];
+      }
+      continue;
+    }
+    if (decodeFrame(frame, frameLength) == 0) {
+      count.bad++;
+    } else if (frame[0] == FRAME_STATS) {
+      count.stats++;
+    } else if (frame[0] == FRAME_BATCH) {
+      count.telemetry++;
+    } else if (frame[0] == FRAME_STATUS && memcmp(frame + 1, "PONG", 4) == 0) {
+      count.pong++;
+    }
+    frameLength = 0;
+  }
+  return count;
+}
+
+static bool replyCheck(int txBuffer, bool batch) {
+  Adafruit_NeoPixel strip(20, 0, NEO_GRB + NEO_KHZ800);
+  FixedGSRVisualizer<GSRHardMode, 10, 20> visualizer(strip);
+  float emaValue = 500;
+  float baseline = 480;
+
+  // Switch format with a roomy port, then start from a clean capture
+  Serial.setTxBuffer(4096);
+  if (batch) {
+    runCommand(visualizer, "TELEMETRY:BATCH", emaValue, baseline);
+  }
+  visualizer.serviceSerial();
+  Serial.clearOutput();
+  Serial.setTxBuffer(txBuffer);
+
+  // 300 loops of a 1 kHz sensor, STATS and PING after the first 50
+  unsigned long time = 0;
+  for (int loop = 0; loop < 300; loop++) {
+    if (loop == 50) {
+      runCommand(visualizer, "STATS", emaValue, baseline);
+      runCommand(visualizer, "PING", emaValue, baseline);
+    }
+    for (int i = 0; i < 4; i++) {
+      visualizer.sendSample(time += 1000, 500 + (loop + i) % 37, emaValue, 0.5f, baseline);
+    }
+    visualizer.serviceSerial();
+    Serial.transmit();
+  }
+
+  ReplyCount count = batch ? countFrames(Serial.output(), Serial.outputLength())
+                           : countJsonLines(Serial.output(), Serial.outputLength());
+  bool ok = count.stats == 1 && count.pong == 1 && count.bad == 0 && count.telemetry >= 20;
+  printf("tx %3d bytes  %-5s  stats %lu  pong %lu  telemetry %4lu  bad %lu  %s\n",
+         txBuffer, batch ? "batch" : "json", count.stats, count.pong, count.telemetry,
+         count.bad, ok ? "ok" : "FAIL");
+  return ok;
+}
+
+// Telemetry thrown away by a TELEMETRY: format switch was asked for: it
+// must not show up as dropped in STATS
+static bool discardCheck() {
+  Adafruit_NeoPixel strip(20, 0, NEO_GRB + NEO_KHZ800);
+  FixedGSRVisualizer<GSRHardMode, 10, 20> visualizer(strip);
+  float emaValue = 500;
+  float baseline = 480;
+
+  // Port full: JSON samples (20 Hz) wait in the ring, then two switches
+  Serial.clearOutput();
+  Serial.setTxBuffer(0);
+  unsigned long time = 0;
+  for (int i = 0; i < 4; i++) {
+    visualizer.sendSample(time += 60000, 500, emaValue, 0.5f, baseline);
+  }
+  runCommand(visualizer, "TELEMETRY:BIN", emaValue, baseline);
+  runCommand(visualizer, "TELEMETRY:JSON", emaValue, baseline);
+
+  Serial.setTxBuffer(4096);
+  visualizer.serviceSerial();
+  Serial.clearOutput();
+  runCommand(visualizer, "STATS", emaValue, baseline);
+  visualizer.serviceSerial();
+
+  char reply[512];
+  size_t length = min(Serial.outputLength(), sizeof(reply) - 1);
+  memcpy(reply, Serial.output(), length);
+  reply[length] = '\0';
+  bool ok = strstr(reply, "\"tx_dropped\":0,") != nullptr;
+  printf("format switch with queued telemetry: %s\n", ok ? "not counted as dropped, ok" : "FAIL");
+  return ok;
+}
+
+// CREDIT:5, then grants that are out of range or negative: exactly five
+// telemetry lines may go out, however long the sensor keeps running
+static bool creditCheck() {
+  Adafruit_NeoPixel strip(20, 0, NEO_GRB + NEO_KHZ800);
+  FixedGSRVisualizer<GSRHardMode, 10, 20> visualizer(strip);
+  float emaValue = 500;
+  float baseline = 480;
+
+  Serial.clearOutput();
+  Serial.setTxBuffer(4096);
+  runCommand(visualizer, "CREDIT:5", emaValue, baseline);
+  runCommand(visualizer, "CREDIT:-1", emaValue, baseline);
+  runCommand(visualizer, "CREDIT:70000", emaValue, baseline);
+  runCommand(visualizer, "CREDIT:18446744073709551615", emaValue, baseline);
+
+  unsigned long time = 0;
+  for (int i = 0; i < 40; i++) {
+    visualizer.sendSample(time += 60000, 500, emaValue, 0.5f, baseline);
+    visualizer.serviceSerial();
+  }
+  ReplyCount count = countJsonLines(Serial.output(), Serial.outputLength());
+  bool ok = count.telemetry == 5 && count.bad == 0;
+  printf("CREDIT:5 then -1, 70000, 2^64-1: %lu telemetry lines  %s\n",
+         count.telemetry, ok ? "ok" : "FAIL");
+  return ok;
+}
+
+static int replies() {
+  static const int kTxBuffers[] = { 63, 128, 256 };
+  int failures = (discardCheck() ? 0 : 1) + (creditCheck() ? 0 : 1);
+  for (int batch = 0; batch < 2; batch++) {
+    for (size_t i = 0; i < sizeof(kTxBuffers) / sizeof(kTxBuffers[0]); i++) {
+      if (!replyCheck(kTxBuffers[i], batch)) {
+        failures++;
+      }
+    }
+  }
+  return failures == 0 ? 0 : 1;
+}
+
+//━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+//                                 MAIN
+//━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+
+int main(int argc, char** argv) {
+  if (argc == 2 && strcmp(argv[1], "--replies") == 0) {
+    return replies();
+  }
+  if (argc < 2 || argc > 3) {
+    fprintf(stderr, "usage: %s <lines> [seed] | --replies\n", argv[0]);
+    return 1;
+  }
+  unsigned long lines = strtoul(argv[1], nullptr, 10);
+  uint32_t seed = argc == 3 ? strtoul(argv[2], nullptr, 10) : 2025;
+  return lines > 0 ? fuzz(lines, seed) : 1;
+}
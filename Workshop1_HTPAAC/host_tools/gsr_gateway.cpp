@@ -0,0 +1,425 @@
+/*
+╔══════════════════════════════════════════════════════════════════════════╗
+║                       GSR SERIAL INGESTION GATEWAY                        ║
+║     Many boards over USB serial → one steady UDP feed for dashboards      ║
+╚══════════════════════════════════════════════════════════════════════════╝
+
+ One browser tab per board (Web Serial → server.js) stops scaling after a
+ few groups. This gateway reads every board directly on one thread:
+
+ • epoll waits on all serial ports at once (Linux)
+ • Each read lands in that port's buffer and is parsed in place: JSON lines
+   are cut at '\n', binary frames (TelemetryCodec.h) are COBS-decoded
+   inside the same buffer. Only an unfinished tail is moved to the front.
+ • Every read is stamped with CLOCK_MONOTONIC on arrival
+ • A timerfd sends one UDP datagram per tick with the newest value of
+   every board, so listeners get a steady rate no matter how bursty the
+   serial side is
+
+ Both formats can appear on one port (JSON until TELEMETRY:BIN). A JSON
+ line always starts with '{'. A COBS frame never does: its first byte is
+ at most ~100 here, and '{' is 123.
+
+ USAGE:
+ -----
+   gsr_gateway [--udp host:port] [--rate hz] [--binary] <port> [port...]
+
+   --udp     Where to send datagrams (default 127.0.0.1:9000)
+   --rate    Datagrams per second, 1-1000 (default 50)
+   --binary  Send TELEMETRY:BIN to every port after opening it
+
+ DATAGRAM (one JSON object every tick, boards without new data are left out):
+   {"t":host_ms,"devices":[{"id":0,"seq":12,"ema":512.30,"raw":510,
+                            "n":4,"age_ms":3},...]}
+   id = position of the port on the command line, n = samples since the
+   last datagram, age_ms = how long ago the newest sample arrived.
+   ema is null for BATCH frames (raw only), raw is -1 for JSON lines.
+*/
+
+#include "TelemetryCodec.h"
+#include "HostSerial.h"
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <math.h>
+#include <netinet/in.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+#include <string>
+#include <vector>
+
+//━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+//                            DEVICE STATE
+//━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+
+#define GATEWAY_BUFFER 4096
+#define MAX_RATE 1000   // --rate limit: ticks faster than 1 ms cost CPU for no new data
+
+struct Device {
+  int id;
+  int fd;
+  const char* path;
+  uint8_t buffer[GATEWAY_BUFFER];
+  size_t length;               // Bytes waiting in buffer
+
+  //──────── Newest Sample ────────
+  bool hasSample;
+  uint16_t sequence;
+  float ema;                   // NAN = not in this format
+  int raw;                     // -1 = not in this format
+  int64_t arrivalMicros;
+  uint32_t samplesSinceTick;
+
+  //──────── Counters ────────
+  unsigned long samples;
+  unsigned long badFrames;
+  unsigned long overflows;
+};
+
+struct GatewayStats {
+  unsigned long bytes;
+  unsigned long samples;
+  unsigned long badFrames;
+  unsigned long datagrams;
+};
+
+//━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+//                               PARSING
+//━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+
+static void storeSample(Device& device, uint16_t sequence, float ema, int raw, int64_t arrival) {
+  device.hasSample = true;
+  device.sequence = sequence;
+  device.ema = ema;
+  device.raw = raw;
+  device.arrivalMicros = arrival;
+  device.samplesSinceTick++;
+  device.samples++;
+}
+
+// line is NUL-terminated in place (the '\n' was overwritten)
+static void handleJsonLine(Device& device, char* line, int64_t arrival) {
+  char* ema = strstr(line, "\"ema\":");
+  if (ema == nullptr) {
+    return;   // status, sync, stats...
+  }
+  char* seq = strstr(line, "\"seq\":");
+  char* raw = strstr(line, "\"raw\":");
+  storeSample(device, seq ? (uint16_t)strtoul(seq + 6, nullptr, 10) : device.sequence + 1,
+              strtof(ema + 6, nullptr), raw ? atoi(raw + 6) : -1, arrival);
+}
+
+static void handleFrame(Device& device, uint8_t* frame, size_t length, int64_t arrival) {
+  size_t body = decodeFrame(frame, length);
+  if (body == 0) {
+    device.badFrames++;
+    return;
+  }
+
+  const uint8_t* payload = frame + 1;
+  size_t payloadLength = body - 1;
+
+  switch (frame[0]) {
+    case FRAME_SAMPLE: {
+      TelemetrySample s;
+      if (unpackSample(payload, payloadLength, s)) {
+        storeSample(device, s.sequence, s.ema, s.raw, arrival);
+      }
+      break;
+    }
+
+    case FRAME_FIELDS: {
+      TelemetrySample s = { 0, 0, 0, NAN, 0, 0 };
+      uint8_t fields;
+      if (unpackSampleFields(payload, payloadLength, s, fields)) {
+        storeSample(device, s.sequence, s.ema, (fields & FIELD_RAW) ? s.raw : -1, arrival);
+      }
+      break;
+    }
+
+    case FRAME_BATCH: {
+      RawSample batch[TELEMETRY_BATCH_MAX_SAMPLES];
+      size_t count = unpackBatch(payload, payloadLength, batch, TELEMETRY_BATCH_MAX_SAMPLES);
+      if (count > 0) {
+        // Only the newest is forwarded, but all are counted
+        storeSample(device, batch[count - 1].sequence, NAN, batch[count - 1].raw, arrival);
+        device.samplesSinceTick += count - 1;
+        device.samples += count - 1;
+      }
+      break;
+    }
+  }
+}
+
+static bool isTextLine(const uint8_t* start, const uint8_t* end) {
+  for (const uint8_t* p = start; p < end; p++) {
+    if (*p < 0x20 && *p != '\r' && *p != '\t') {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Parses every complete message in device.buffer, in place
+static void parseBuffer(Device& device, int64_t arrival) {
+  uint8_t* start = device.buffer;
+  uint8_t* end = device.buffer + device.length;
+
+  while (start < end) {
+    uint8_t* newline = (uint8_t*)memchr(start, '\n', end - start);
+    if (*start == '{') {
+      if (newline == nullptr) {
+        break;
+      }
+      *newline = '\0';
+      handleJsonLine(device, (char*)start, arrival);
+      start = newline + 1;
+      continue;
+    }
+
+    // Boot messages and other plain text. A frame may contain '\n' too,
+    // but its first byte (the COBS code) is never printable here
+    uint8_t* zero = (uint8_t*)memchr(start, 0, end - start);
+    if (newline != nullptr && (zero == nullptr || newline < zero) && isTextLine(start, newline) &&
+        (zero == nullptr || (newline > start && *start >= 0x20))) {
+      start = newline + 1;
+      continue;
+    }
+    if (zero == nullptr) {
+      break;
+    }
+    if (zero > start) {
+      handleFrame(device, start, zero - start, arrival);
+    }
+    start = zero + 1;
+  }
+
+  // Keep the unfinished tail; a full buffer without any delimiter is junk
+  device.length = end - start;
+  if (device.length == GATEWAY_BUFFER) {
+    device.overflows++;
+    device.length = 0;
+  } else if (device.length > 0 && start != device.buffer) {
+    memmove(device.buffer, start, device.length);
+  }
+}
+
+//━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+//                               FAN-OUT
+//━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+
+static void sendDatagram(int sock, const sockaddr_in& target, std::vector<Device*>& devices,
+                         std::string& out, GatewayStats& stats) {
+  int64_t now = hostMicros();
+  char item[128];
+
+  out.clear();
+  snprintf(item, sizeof(item), "{\"t\":%lld,\"devices\":[", (long long)(now / 1000));
+  out += item;
+
+  bool first = true;
+  for (Device* d : devices) {
+    if (d == nullptr || d->samplesSinceTick == 0) {
+      continue;
+    }
+    char ema[16] = "null";
+    if (!isnan(d->ema)) {
+      snprintf(ema, sizeof(ema), "%.2f", d->ema);
+    }
+    int length = snprintf(item, sizeof(item),
+                          "%s{\"id\":%d,\"seq\":%u,\"ema\":%s,\"raw\":%d,\"n\":%u,\"age_ms\":%lld}",
+                          first ? "" : ",", d->id, d->sequence, ema, d->raw,
+                          d->samplesSinceTick, (long long)((now - d->arrivalMicros) / 1000));
+    out.append(item, length);
+    d->samplesSinceTick = 0;
+    first = false;
+  }
+  out += "]}";
+
+  // Sent every tick, even when empty, so listeners can rely on the rate
+  sendto(sock, out.data(), out.size(), 0, (const sockaddr*)&target, sizeof(target));
+  stats.datagrams++;
+}
+
+//━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+//                              REPORTING
+//━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+
+static double cpuSeconds() {
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec +
+         (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e6;
+}
+
+static void report(std::vector<Device*>& devices, GatewayStats& stats, GatewayStats& last,
+                   double seconds, double cpu) {
+  unsigned long bad = 0;
+  unsigned long open = 0;
+  for (Device* d : devices) {
+    if (d != nullptr) {
+      bad += d->badFrames;
+      open++;
+    }
+  }
+  fprintf(stderr, "gateway: %lu ports, %.0f samples/s, %.0f KB/s, %.0f datagrams/s, %lu bad frames, CPU %.1f%%\n",
+          open, (stats.samples - last.samples) / seconds, (stats.bytes - last.bytes) / seconds / 1024,
+          (stats.datagrams - last.datagrams) / seconds, bad, 100.0 * cpu / seconds);
+  last = stats;
+}
+
+//━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+//                                 MAIN
+//━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+
+int main(int argc, char** argv) {
+  const char* udpTarget = "127.0.0.1:9000";
+  int rate = 50;
+  bool binary = false;
+  std::vector<const char*> paths;
+
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--udp") == 0 && i + 1 < argc) {
+      udpTarget = argv[++i];
+    } else if (strcmp(argv[i], "--rate") == 0 && i + 1 < argc) {
+      char* end;
+      rate = strtol(argv[++i], &end, 10);
+      if (*end != '\0' || rate < 1 || rate > MAX_RATE) {
+        fprintf(stderr, "--rate must be 1-%d datagrams per second: %s\n", MAX_RATE, argv[i]);
+        return 1;
+      }
+    } else if (strcmp(argv[i], "--binary") == 0) {
+      binary = true;
+    } else {
+      paths.push_back(argv[i]);
+    }
+  }
+  if (paths.empty()) {
+    fprintf(stderr, "usage: %s [--udp host:port] [--rate hz] [--binary] <port> [port...]\n", argv[0]);
+    return 1;
+  }
+
+  //──────── UDP Target ────────
+  std::string host(udpTarget);
+  size_t colon = host.rfind(':');
+  sockaddr_in target;
+  memset(&target, 0, sizeof(target));
+  target.sin_family = AF_INET;
+  target.sin_port = htons(colon == std::string::npos ? 9000 : atoi(host.c_str() + colon + 1));
+  if (inet_pton(AF_INET, host.substr(0, colon).c_str(), &target.sin_addr) != 1) {
+    fprintf(stderr, "bad --udp address: %s\n", udpTarget);
+    return 1;
+  }
+  int sock = socket(AF_INET, SOCK_DGRAM, 0);
+
+  //──────── Serial Ports ────────
+  int epoll = epoll_create1(0);
+  std::vector<Device*> devices;
+  for (size_t i = 0; i < paths.size(); i++) {
+    int fd = openSerialPort(paths[i], true);
+    if (fd < 0) {
+      devices.push_back(nullptr);
+      continue;
+    }
+    Device* d = new Device();
+    d->id = i;
+    d->fd = fd;
+    d->path = paths[i];
+    d->raw = -1;
+    devices.push_back(d);
+
+    if (binary && write(fd, "TELEMETRY:BIN\n", 14) < 0) {
+      perror(paths[i]);
+    }
+
+    epoll_event event;
+    event.events = EPOLLIN;
+    event.data.ptr = d;
+    epoll_ctl(epoll, EPOLL_CTL_ADD, fd, &event);
+  }
+
+  //──────── Output Tick ────────
+  // tv_nsec must stay below one second, so --rate 1 is { 1 s, 0 ns }
+  long periodNanos = 1000000000L / rate;
+  int timer = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK);
+  itimerspec tick;
+  tick.it_interval.tv_sec = periodNanos / 1000000000L;
+  tick.it_interval.tv_nsec = periodNanos % 1000000000L;
+  tick.it_value = tick.it_interval;
+  if (timer < 0 || timerfd_settime(timer, 0, &tick, nullptr) < 0) {
+    perror("output timer");
+    return 1;
+  }
+  epoll_event timerEvent;
+  timerEvent.events = EPOLLIN;
+  timerEvent.data.ptr = nullptr;
+  epoll_ctl(epoll, EPOLL_CTL_ADD, timer, &timerEvent);
+
+  GatewayStats stats = { 0, 0, 0, 0 };
+  GatewayStats last = stats;
+  std::string datagram;
+  datagram.reserve(64 * devices.size() + 64);
+  int64_t lastReport = hostMicros();
+  double lastCpu = cpuSeconds();
+  epoll_event events[64];
+
+  for (;;) {
+    int ready = epoll_wait(epoll, events, 64, 1000);
+    if (ready < 0 && errno != EINTR) {
+      perror("epoll_wait");
+      break;
+    }
+    int64_t arrival = hostMicros();
+
+    for (int e = 0; e < ready; e++) {
+      Device* d = (Device*)events[e].data.ptr;
+
+      if (d == nullptr) {
+        uint64_t expirations;
+        if (read(timer, &expirations, sizeof(expirations)) > 0) {
+          sendDatagram(sock, target, devices, datagram, stats);
+        }
+        continue;
+      }
+
+      // Drain the port; EAGAIN means everything has been read
+      for (;;) {
+        ssize_t n = read(d->fd, d->buffer + d->length, GATEWAY_BUFFER - d->length);
+        if (n > 0) {
+          unsigned long before = d->samples;
+          d->length += n;
+          stats.bytes += n;
+          parseBuffer(*d, arrival);
+          stats.samples += d->samples - before;
+          continue;
+        }
+        if (n < 0 && errno == EAGAIN) {
+          break;
+        }
+        // Board unplugged (or loadgen stopped)
+        fprintf(stderr, "gateway: %s closed\n", d->path);
+        epoll_ctl(epoll, EPOLL_CTL_DEL, d->fd, nullptr);
+        close(d->fd);
+        devices[d->id] = nullptr;
+        delete d;
+        break;
+      }
+    }
+
+    if (arrival - lastReport >= 5000000) {
+      double cpu = cpuSeconds();
+      report(devices, stats, last, (arrival - lastReport) / 1e6, cpu - lastCpu);
+      lastReport = arrival;
+      lastCpu = cpu;
+    }
+  }
+
+  return 0;
+}
@@ -0,0 +1,275 @@
+/*
+╔══════════════════════════════════════════════════════════════════════════╗
+║                         LED PIPELINE HOST CHECKS                          ║
+║        Runs the GSRVisualizer frame path on a computer, no strip          ║
+╚══════════════════════════════════════════════════════════════════════════╝
+
+ Builds the library itself against the Arduino stand-ins in arduino/, so
+ the code timed and checked here is the code the boards run.
+
+ USAGE:
+ -----
+   led_check --bench 300 3000       (rainbow per-frame time, old vs palette)
+   led_check --power                (power limiter edge cases)
+
+ --bench times the rainbow two ways on strips of the given lengths:
+ • old      gamma32(ColorHSV(hue)) per pixel, as before LEDPalette
+ • palette  the RAINBOW effect (one blended palette lookup per pixel)
+ "colors" is the color math alone, "frame" the whole frame through
+ beginFrame() / setPixel() / showFrame() (power limit, dithering, show).
+ It also compares the two rainbows and exits non-zero if any channel
+ differs by more than a few steps.
+
+ --power draws frames under budgets that the idle current alone already
+ exceeds, blank and lit, and checks that strip.setBrightness() after the
+ visualizer was built is still applied. It exits non-zero if the limiter
+ misbehaves.
+*/
+
+#include <Arduino.h>
+#include <Adafruit_NeoPixel.h>
+#include "GSRVisualizer.h"
+#include "LEDEffects.h"
+#include "LEDPalette.h"
+#include "PowerLimiter.h"
+#include "HostSerial.h"   // hostMicros
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_LEDS 3000
+#define PALETTE_TOLERANCE 6   // Blending gamma-corrected entries is off by at most 5 anywhere on the wheel
+
+// Effects without web serial: the frame path and the registry, nothing else
+struct LEDCheckTier {
+  static constexpr bool webSerial = false;
+  static constexpr bool effects = true;
+  static constexpr bool simulation = false;
+};
+
+typedef FixedGSRVisualizer<LEDCheckTier, 10, MAX_LEDS> CheckVisualizer;
+
+//━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+//                          RAINBOW BENCHMARK
+//━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+
+// The per-pixel rainbow from before LEDPalette
+static uint32_t oldRainbowPixel(uint16_t hue, int i, int numLeds) {
+  uint16_t pixelHue = hue + (i * 65536L / numLeds);
+  return Adafruit_NeoPixel::gamma32(Adafruit_NeoPixel::ColorHSV(pixelHue));
+}
+
+// Keeps the compiler from dropping loops whose result is never used
+static volatile uint32_t sink;
+
+static double timeOldColors(int numLeds, int frames) {
+  uint32_t acc = 0;
+  int64_t start = hostMicros();
+  for (int f = 0; f < frames; f++) {
+    uint16_t hue = f * 256;
+    for (int i = 0; i < numLeds; i++) {
+      acc += oldRainbowPixel(hue, i, numLeds);
+    }
+  }
+  int64_t took = hostMicros() - start;
+  sink = acc;
+  return (double)took / frames;
+}
+
+static double timePaletteColors(int numLeds, int frames) {
+  uint32_t acc = 0;
+  int64_t start = hostMicros();
+  for (int f = 0; f < frames; f++) {
+    uint16_t hue = f * 256;
+    uint32_t hueStep = (65536UL << 8) / numLeds;
+    uint32_t wheel = 0;
+    for (int i = 0; i < numLeds; i++) {
+      acc += paletteColor(kRainbowPalette, hue + (uint16_t)(wheel >> 8));
+      wheel += hueStep;
+    }
+  }
+  int64_t took = hostMicros() - start;
+  sink = acc;
+  return (double)took / frames;
+}
+
+static double timeOldFrames(CheckVisualizer& visualizer, int numLeds, int frames) {
+  int64_t start = hostMicros();
+  for (int f = 0; f < frames; f++) {
+    uint16_t hue = f * 256;
+    visualizer.beginFrame();
+    for (int i = 0; i < numLeds; i++) {
+      visualizer.setPixel(i, oldRainbowPixel(hue, i, numLeds));
+    }
+    visualizer.showFrame();
+  }
+  return (double)(hostMicros() - start) / frames;
+}
+
+static double timePaletteFrames(CheckVisualizer& visualizer, int frames) {
+  visualizer.setEffect("RAINBOW");
+  int64_t start = hostMicros();
+  for (int f = 0; f < frames; f++) {
+    visualizer.updateLEDs(0, 0, 1023, 0);
+  }
+  return (double)(hostMicros() - start) / frames;
+}
+
+// Largest channel difference between the two rainbows over a whole frame
+static int paletteError(int numLeds) {
+  uint32_t hueStep = (65536UL << 8) / numLeds;
+  uint32_t wheel = 0;
+  int worst = 0;
+  for (int i = 0; i < numLeds; i++) {
+    uint32_t a = oldRainbowPixel(0, i, numLeds);
+    uint32_t b = paletteColor(kRainbowPalette, (uint16_t)(wheel >> 8));
+    wheel += hueStep;
+    for (int shift = 0; shift <= 16; shift += 8) {
+      int diff = abs((int)((a >> shift) & 0xFF) - (int)((b >> shift) & 0xFF));
+      worst = max(worst, diff);
+    }
+  }
+  return worst;
+}
+
+static int benchmark(int count, char** lengths) {
+  int failures = 0;
+  printf("leds   colors old   colors palette   frame old    frame palette   max diff\n");
+
+  for (int n = 0; n < count; n++) {
+    int numLeds = atoi(lengths[n]);
+    if (numLeds < 1 || numLeds > MAX_LEDS) {
+      fprintf(stderr, "strip length must be 1-%d: %s\n", MAX_LEDS, lengths[n]);
+      return 1;
+    }
+    // About 3 million pixels per measurement, whatever the strip length
+    int frames = max(50, 3000000 / numLeds);
+
+    Adafruit_NeoPixel strip(numLeds, 0, NEO_GRB + NEO_KHZ800);
+    CheckVisualizer visualizer(strip);
+    visualizer.setPowerBudget(0);
+
+    // One warm-up pass of each, so caches and the gamma table are ready
+    timeOldColors(numLeds, 1);
+    timePaletteColors(numLeds, 1);
+
+    double oldColors = timeOldColors(numLeds, frames);
+    double paletteColors = timePaletteColors(numLeds, frames);
+    double oldFrame = timeOldFrames(visualizer, numLeds, frames);
+    double paletteFrame = timePaletteFrames(visualizer, frames);
+    int error = paletteError(numLeds);
+
+    printf("%-6d %8.1f us  %11.1f us  %8.1f us  %11.1f us   %8d\n",
+           numLeds, oldColors, paletteColors, oldFrame, paletteFrame, error);
+    if (error > PALETTE_TOLERANCE) {
+      fprintf(stderr, "FAIL: palette rainbow differs by %d at %d LEDs\n", error, numLeds);
+      failures++;
+    }
+  }
+  return failures == 0 ? 0 : 1;
+}
+
+//━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+//                         POWER LIMITER CHECKS
+//━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+
+static int powerFailures = 0;
+
+// scale < 0: not visible from outside (checks through the visualizer)
+static void expect(bool ok, const char* what, int scale, unsigned milliamps) {
+  if (scale >= 0) {
+    printf("%-44s scale %3d  %5u mA  %s\n", what, scale, milliamps, ok ? "ok" : "FAIL");
+  } else {
+    printf("%-44s scale   -  %5u mA  %s\n", what, milliamps, ok ? "ok" : "FAIL");
+  }
+  if (!ok) {
+    powerFailures++;
+  }
+}
+
+// Draws one frame of the same color on every LED
+static void drawFrame(PowerLimiter& limiter, int numLeds, uint8_t value, uint8_t brightness) {
+  limiter.beginFrame();
+  for (int i = 0; i < numLeds; i++) {
+    limiter.add(value, value, value);
+  }
+  limiter.endFrame(brightness, numLeds);
+}
+
+static int powerChecks() {
+  // 20 LEDs at the default 1 mA idle: 20 mA before anything lights up
+  PowerLimiter limiter;
+
+  limiter.setBudget(10);
+  drawFrame(limiter, 20, 0, 255);
+  expect(limiter.getScale() == 255 && limiter.getEstimatedMilliamps() == 20,
+         "blank frame, idle over budget", limiter.getScale(), limiter.getEstimatedMilliamps());
+
+  // Scale 0 still lets 1/256 through, so a little over the idle current
+  drawFrame(limiter, 20, 255, 255);
+  expect(limiter.getScale() == 0 && limiter.getEstimatedMilliamps() < 20 + 1200 / 128,
+         "lit frame, idle over budget", limiter.getScale(), limiter.getEstimatedMilliamps());
+
+  // Too dim to count as any current at all
+  drawFrame(limiter, 20, 1, 0);
+  expect(limiter.getScale() == 255, "near-black frame, idle over budget",
+         limiter.getScale(), limiter.getEstimatedMilliamps());
+
+  limiter.setBudget(500);
+  drawFrame(limiter, 20, 255, 255);
+  expect(limiter.getScale() < 255 && limiter.getEstimatedMilliamps() <= 500,
+         "white frame, 500 mA budget", limiter.getScale(), limiter.getEstimatedMilliamps());
+
+  limiter.setBudget(0);
+  drawFrame(limiter, 20, 255, 255);
+  expect(limiter.getScale() == 255, "white frame, no budget",
+         limiter.getScale(), limiter.getEstimatedMilliamps());
+
+  // The same through the visualizer: POWER:10 then LED:OFF, and the
+  // blank frames of flashSuccess()
+  Adafruit_NeoPixel strip(20, 0, NEO_GRB + NEO_KHZ800);
+  CheckVisualizer visualizer(strip);
+  visualizer.setPowerBudget(10);
+  visualizer.setEffect("OFF");
+  visualizer.updateLEDs(0, 0, 1023, 0);
+  expect(visualizer.getEstimatedMilliamps() == 20, "visualizer LED:OFF under POWER:10",
+         -1, visualizer.getEstimatedMilliamps());
+
+  visualizer.flashSuccess();
+  expect(visualizer.getEstimatedMilliamps() == 20, "visualizer flashSuccess() under POWER:10",
+         -1, visualizer.getEstimatedMilliamps());
+
+  // strip.setBrightness() from the sketch after the visualizer was built:
+  // taken over at the next frame, so the limiter still sees it
+  visualizer.setPowerBudget(0);
+  visualizer.beginFrame();
+  for (int i = 0; i < 20; i++) {
+    visualizer.setPixel(i, 255, 255, 255);
+  }
+  visualizer.showFrame();
+  unsigned full = visualizer.getEstimatedMilliamps();
+  strip.setBrightness(50);
+  visualizer.showFrame();
+  unsigned dimmed = visualizer.getEstimatedMilliamps();
+  expect(strip.getBrightness() == 255 && dimmed < 20 + (full - 20) / 4,
+         "strip.setBrightness(50) after construction", -1, dimmed);
+
+  return powerFailures == 0 ? 0 : 1;
+}
+
+//━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+//                                 MAIN
+//━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+
+int main(int argc, char** argv) {
+  if (argc >= 3 && strcmp(argv[1], "--bench") == 0) {
+    return benchmark(argc - 2, argv + 2);
+  }
+  if (argc == 2 && strcmp(argv[1], "--power") == 0) {
+    return powerChecks();
+  }
+
+  fprintf(stderr, "usage: %s --bench <leds> [<leds> ...] | --power\n", argv[0]);
+  return 1;
+}
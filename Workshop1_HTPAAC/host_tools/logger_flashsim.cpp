@@ -0,0 +1,334 @@
+/*
+╔══════════════════════════════════════════════════════════════════════════╗
+║                     SESSION LOGGER FLASH STAND-IN                         ║
+║     Runs the firmware's SessionLogger against a slow file, and decodes    ║
+║                          the logs it writes                               ║
+╚══════════════════════════════════════════════════════════════════════════╝
+
+ --simulate compiles the real SessionLogger.cpp and drives it the way the
+ board does: one thread records samples on a fixed schedule (loop), another
+ runs service() (the writer task) into a file that sleeps like flash does,
+ including the occasional long erase stall. Afterwards the file is decoded
+ and checked:
+   • continuous: every sample is there, in order, or counted as lost
+   • triggered: each SCR has its full pre- and post-trigger window
+   • a page torn in half by a "power cut" is rejected, the rest still read
+ It also reports the slowest record() call, which is what sampling pays,
+ and counts operator new inside record() and service(): both must run
+ without touching the heap (the ring is allocated once, when the logger
+ is built).
+
+ USAGE:
+ -----
+   logger_flashsim --simulate [seconds] [hz]     (default 10 s at 1000 Hz)
+   logger_flashsim --decode session.log > samples.csv
+*/
+
+#include "SessionLogger.h"
+#include "HostSerial.h"   // hostMicros
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <new>
+#include <thread>
+#include <vector>
+
+//━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+//                         ALLOCATION COUNTING
+//━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+// Per thread, so only the logger's own calls count, not the vectors and
+// threads of this test around them.
+
+static thread_local bool counting = false;
+static std::atomic<unsigned long> allocations(0);
+
+void* operator new(size_t size) {
+  if (counting) {
+    allocations++;
+  }
+  void* p = malloc(size ? size : 1);
+  if (p == nullptr) {
+    throw std::bad_alloc();
+  }
+  return p;
+}
+
+void* operator new[](size_t size) {
+  return operator new(size);
+}
+
+void operator delete(void* p) noexcept {
+  free(p);
+}
+
+void operator delete[](void* p) noexcept {
+  free(p);
+}
+
+//━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+//                         FILE-BACKED "FLASH"
+//━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+
+class SlowFileSink : public LogSink {
+  private:
+    FILE* file;
+    int pageMicros;         // Cost of one page program
+    int stallEvery;         // Every Nth page also pays an erase
+    int stallMicros;
+    unsigned long pages;
+
+  public:
+    SlowFileSink(FILE* output, int writeMicros, int everyPages, int eraseMicros)
+        : file(output), pageMicros(writeMicros), stallEvery(everyPages),
+          stallMicros(eraseMicros), pages(0) {
+    }
+
+    bool append(const uint8_t* page, size_t length) {
+      usleep(pageMicros);
+      if (++pages % stallEvery == 0) {
+        usleep(stallMicros);
+      }
+      return fwrite(page, 1, length, file) == length;
+    }
+
+    void sync() {
+      fflush(file);
+    }
+};
+
+//━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+//                              DECODING
+//━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+
+struct DecodedLog {
+  std::vector<LogRecord> records;
+  std::vector<uint16_t> sessions;   // Session of each record
+  unsigned long pages;
+  unsigned long badPages;
+  unsigned long lost;
+};
+
+static DecodedLog decodeLog(const char* path) {
+  DecodedLog log = DecodedLog();
+  FILE* file = fopen(path, "rb");
+  if (file == nullptr) {
+    return log;
+  }
+
+  uint8_t page[LOG_PAGE_SIZE];
+  size_t got;
+  while ((got = fread(page, 1, LOG_PAGE_SIZE, file)) > 0) {
+    LogPageInfo info;
+    if (got < LOG_PAGE_SIZE || !readLogPage(page, info)) {
+      log.badPages++;
+      continue;
+    }
+    log.pages++;
+    log.lost += info.lost;
+    for (uint8_t i = 0; i < info.count; i++) {
+      LogRecord record;
+      readLogRecord(page, i, record);
+      log.records.push_back(record);
+      log.sessions.push_back(info.session);
+    }
+  }
+  fclose(file);
+  return log;
+}
+
+static int decodeToCsv(const char* path) {
+  DecodedLog log = decodeLog(path);
+  printf("session,time_us,raw,ema,trigger\n");
+  for (size_t i = 0; i < log.records.size(); i++) {
+    const LogRecord& r = log.records[i];
+    printf("%u,%u,%u,%.3f,%d\n", log.sessions[i], r.timeMicros, r.raw, r.ema,
+           (r.flags & LOG_RECORD_TRIGGER) ? 1 : 0);
+  }
+  fprintf(stderr, "%lu pages, %lu bad pages, %lu samples lost on the device\n",
+          log.pages, log.badPages, log.lost);
+  return 0;
+}
+
+//━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+//                             SIMULATION
+//━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+// Sample i carries ema = i, so the checks can tell exactly which samples
+// reached the file.
+
+#define TRIGGER_EVERY 1500   // Samples between simulated SCRs
+
+struct RunResult {
+  uint32_t recorded;
+  uint32_t overruns;
+  unsigned long allocations;
+  int64_t slowestRecordMicros;
+  std::vector<uint32_t> triggers;
+};
+
+static RunResult runLogger(LogMode mode, const char* path, int seconds, int hz,
+                           uint32_t pre, uint32_t post) {
+  FILE* file = fopen(path, "wb");
+  // 512-byte page ≈ 3 ms, plus a 60 ms erase every 8 pages (LittleFS-like)
+  SlowFileSink sink(file, 3000, 8, 60000);
+  // The board keeps ~10 s at 100 Hz; give faster runs the same margin
+  SessionLogger logger(hz * 2 > 1024 ? hz * 2 : 1024);
+  logger.setSink(&sink);
+  logger.setPreTrigger(pre, post);
+  logger.start(mode, mode == LOG_CONTINUOUS ? 1 : 2);
+
+  unsigned long allocationsBefore = allocations.load();
+
+  // The writer task: low priority, sleeps 20 ms when idle
+  std::atomic<bool> running(true);
+  std::thread writer([&]() {
+    counting = true;
+    while (running.load()) {
+      if (!logger.service()) {
+        usleep(20000);
+      }
+    }
+    while (logger.service()) {
+    }
+    counting = false;
+  });
+
+  RunResult result = RunResult();
+  int64_t period = 1000000 / hz;
+  int64_t next = hostMicros();
+  uint32_t total = seconds * hz;
+  for (uint32_t i = 0; i < total; i++) {
+    int64_t now = hostMicros();
+    if (now < next) {
+      usleep(next - now);
+    }
+    next += period;
+
+    bool trigger = (i % TRIGGER_EVERY) == TRIGGER_EVERY / 2;
+    if (trigger) {
+      result.triggers.push_back(i);
+    }
+    int64_t before = hostMicros();
+    counting = true;
+    logger.record(i * period, i & 0x3FF, (float)i, trigger);
+    counting = false;
+    int64_t took = hostMicros() - before;
+    if (took > result.slowestRecordMicros) {
+      result.slowestRecordMicros = took;
+    }
+  }
+  result.recorded = total;
+
+  logger.stop();
+  running = false;
+  writer.join();
+  result.overruns = logger.getOverruns();
+  result.allocations = allocations.load() - allocationsBefore;
+  fclose(file);
+  return result;
+}
+
+static bool checkContinuous(const char* path, const RunResult& run) {
+  DecodedLog log = decodeLog(path);
+  bool ok = log.badPages == 0 && log.lost == run.overruns && run.allocations == 0 &&
+            log.records.size() + run.overruns == run.recorded;
+  for (size_t i = 1; i < log.records.size(); i++) {
+    if (log.records[i].ema <= log.records[i - 1].ema) {
+      ok = false;    // Out of order or duplicated
+    }
+  }
+  printf("continuous: %u recorded, %zu in file, %u lost (file says %lu), %lu pages, slowest record() %lld us, %lu allocations → %s\n",
+         run.recorded, log.records.size(), run.overruns, log.lost, log.pages,
+         (long long)run.slowestRecordMicros, run.allocations, ok ? "OK" : "FAIL");
+  return ok;
+}
+
+static bool checkTriggered(const char* path, const RunResult& run, uint32_t pre, uint32_t post) {
+  DecodedLog log = decodeLog(path);
+  std::vector<bool> present(run.recorded, false);
+  for (const LogRecord& r : log.records) {
+    present[(uint32_t)r.ema] = true;
+  }
+
+  unsigned long complete = 0;
+  for (uint32_t t : run.triggers) {
+    bool whole = true;
+    for (uint32_t i = (t >= pre ? t - pre : 0); i <= t + post && i < run.recorded; i++) {
+      whole = whole && present[i];
+    }
+    complete += whole;
+  }
+
+  // Between captures nothing should be written
+  size_t expected = 0;
+  for (uint32_t i = 0; i < run.recorded; i++) {
+    for (uint32_t t : run.triggers) {
+      if (i + pre >= t && i <= t + post) {
+        expected++;
+        break;
+      }
+    }
+  }
+
+  bool ok = log.badPages == 0 && complete == run.triggers.size() && run.allocations == 0 &&
+            log.records.size() == expected;
+  printf("triggered:  %zu SCRs, %lu with full %u+%u window, %zu samples in file (expected %zu), %lu pages, %lu allocations → %s\n",
+         run.triggers.size(), complete, pre, post, log.records.size(), expected, log.pages,
+         run.allocations, ok ? "OK" : "FAIL");
+  return ok;
+}
+
+static bool checkTornPage(const char* path) {
+  DecodedLog before = decodeLog(path);
+
+  // Cut the file in the middle of its last page
+  FILE* file = fopen(path, "rb+");
+  fseek(file, 0, SEEK_END);
+  long size = ftell(file);
+  fclose(file);
+  if (truncate(path, size - LOG_PAGE_SIZE / 2) != 0) {
+    return false;
+  }
+
+  DecodedLog after = decodeLog(path);
+  bool ok = after.badPages == 1 && after.pages == before.pages - 1;
+  printf("power cut:  last page torn, %lu of %lu pages still valid → %s\n",
+         after.pages, before.pages, ok ? "OK" : "FAIL");
+  return ok;
+}
+
+//━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+//                                 MAIN
+//━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+
+int main(int argc, char** argv) {
+  if (argc >= 3 && strcmp(argv[1], "--decode") == 0) {
+    return decodeToCsv(argv[2]);
+  }
+  if (argc < 2 || strcmp(argv[1], "--simulate") != 0) {
+    fprintf(stderr, "usage: %s --simulate [seconds] [hz] | --decode <file>\n", argv[0]);
+    return 1;
+  }
+
+  int seconds = argc > 2 ? atoi(argv[2]) : 10;
+  int hz = argc > 3 ? atoi(argv[3]) : 1000;
+  uint32_t pre = hz / 2;
+  uint32_t post = hz / 4;
+  if (seconds <= 0 || hz <= 0 || hz > 1000000) {
+    return 1;
+  }
+
+  const char* path = "flashsim_continuous.log";
+  RunResult continuous = runLogger(LOG_CONTINUOUS, path, seconds, hz, pre, post);
+  bool ok = checkContinuous(path, continuous);
+  ok = checkTornPage(path) && ok;
+
+  path = "flashsim_triggered.log";
+  RunResult triggered = runLogger(LOG_TRIGGERED, path, seconds, hz, pre, post);
+  ok = checkTriggered(path, triggered, pre, post) && ok;
+
+  return ok ? 0 : 1;
+}
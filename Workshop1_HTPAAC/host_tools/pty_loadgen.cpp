@@ -0,0 +1,192 @@
+/*
+╔══════════════════════════════════════════════════════════════════════════╗
+║                     PSEUDO-TERMINAL LOAD GENERATOR                        ║
+║        Dozens of fake GSR boards for testing gsr_gateway without          ║
+║                           any hardware                                    ║
+╚══════════════════════════════════════════════════════════════════════════╝
+
+ Creates N pseudo-terminals and streams telemetry into each one at the
+ given rate, like N boards running 2_Hard_Mode. The slave paths are
+ printed one per line, so the gateway can be pointed at them directly.
+
+ USAGE:
+ -----
+   pty_loadgen <devices> <hz> [json|bin|batch] [seconds] > ports.txt &
+   gsr_gateway --udp 127.0.0.1:9000 $(cat ports.txt)
+
+ Writes never block: if the reader falls behind and a pty buffer fills,
+ the message is counted as dropped (like SerialQueue on the device).
+ Totals are printed to stderr every 5 seconds.
+*/
+
+#include "TelemetryCodec.h"
+#include "HostSerial.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <vector>
+
+//━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+//                            FAKE DEVICE
+//━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+
+enum OutputFormat {
+  OUTPUT_JSON,
+  OUTPUT_BINARY,
+  OUTPUT_BATCH
+};
+
+struct FakeDevice {
+  int fd;
+  uint16_t sequence;
+  float ema;
+  double phase;          // Each device drifts differently
+  TelemetryBatch batch;
+};
+
+// Slow drift plus occasional skin-response bumps, like a real finger
+static uint16_t nextReading(FakeDevice& device, unsigned long tick) {
+  double value = 500 + 120 * sin(device.phase + tick / 400.0);
+  if ((tick + (unsigned long)(device.phase * 100)) % 600 < 80) {
+    value += 60 * sin(((tick % 600) / 80.0) * M_PI);
+  }
+  return (uint16_t)(value + rand() % 7 - 3);
+}
+
+struct LoadStats {
+  unsigned long messages;
+  unsigned long bytes;
+  unsigned long dropped;
+};
+
+static void writeMessage(FakeDevice& device, const uint8_t* data, size_t length, LoadStats& stats) {
+  ssize_t n = write(device.fd, data, length);
+  if (n == (ssize_t)length) {
+    stats.messages++;
+    stats.bytes += length;
+  } else {
+    // EAGAIN (buffer full) or a short write: the reader is behind
+    stats.dropped++;
+  }
+}
+
+static void emitSample(FakeDevice& device, OutputFormat format, unsigned long tick, LoadStats& stats) {
+  uint16_t raw = nextReading(device, tick);
+  float previous = device.ema;
+  device.ema = device.ema == 0 ? raw : 0.3f * raw + 0.7f * device.ema;
+  uint32_t now = (uint32_t)hostMicros();
+
+  if (format == OUTPUT_JSON) {
+    char line[48];
+    int length = snprintf(line, sizeof(line), "{\"ema\":%.2f}\r\n", device.ema);
+    writeMessage(device, (const uint8_t*)line, length, stats);
+    return;
+  }
+
+  uint8_t frame[TELEMETRY_MAX_FRAME(TELEMETRY_MAX_PAYLOAD)];
+  if (format == OUTPUT_BATCH) {
+    if (!device.batch.add(device.sequence, now, raw)) {
+      size_t length = encodeFrame(FRAME_BATCH, device.batch.payload(), device.batch.size(), frame);
+      writeMessage(device, frame, length, stats);
+      device.batch.reset();
+      device.batch.add(device.sequence, now, raw);
+    }
+    device.sequence++;
+    if (device.batch.age(now) >= 200000) {
+      size_t length = encodeFrame(FRAME_BATCH, device.batch.payload(), device.batch.size(), frame);
+      writeMessage(device, frame, length, stats);
+      device.batch.reset();
+    }
+    return;
+  }
+
+  TelemetrySample sample = { device.sequence++, now, raw, device.ema, device.ema - previous, 500 };
+  uint8_t payload[TELEMETRY_SAMPLE_PAYLOAD];
+  size_t length = encodeFrame(FRAME_SAMPLE, payload, packSample(sample, payload), frame);
+  writeMessage(device, frame, length, stats);
+}
+
+//━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+//                                 MAIN
+//━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+
+int main(int argc, char** argv) {
+  if (argc < 3) {
+    fprintf(stderr, "usage: %s <devices> <hz> [json|bin|batch] [seconds]\n", argv[0]);
+    return 1;
+  }
+  int count = atoi(argv[1]);
+  int hz = atoi(argv[2]);
+  OutputFormat format = OUTPUT_BINARY;
+  if (argc > 3 && strcmp(argv[3], "json") == 0) {
+    format = OUTPUT_JSON;
+  } else if (argc > 3 && strcmp(argv[3], "batch") == 0) {
+    format = OUTPUT_BATCH;
+  }
+  int seconds = argc > 4 ? atoi(argv[4]) : 0;   // 0 = until killed
+  if (count <= 0 || hz <= 0) {
+    return 1;
+  }
+
+  std::vector<FakeDevice> devices(count);
+  for (int i = 0; i < count; i++) {
+    char path[64];
+    devices[i].fd = openPseudoTerminal(path, sizeof(path));
+    if (devices[i].fd < 0) {
+      return 1;
+    }
+    int flags = fcntl(devices[i].fd, F_GETFL);
+    fcntl(devices[i].fd, F_SETFL, flags | O_NONBLOCK);
+    devices[i].sequence = 0;
+    devices[i].ema = 0;
+    devices[i].phase = i * 0.7;
+    printf("%s\n", path);
+  }
+  fflush(stdout);
+
+  // All devices tick together on one absolute schedule, so a slow
+  // iteration is caught up instead of lowering the rate
+  LoadStats stats = { 0, 0, 0 };
+  LoadStats reported = stats;
+  int64_t period = 1000000 / hz;
+  int64_t start = hostMicros();
+  int64_t nextTick = start;
+  int64_t nextReport = start + 5000000;
+  unsigned long tick = 0;
+
+  for (;;) {
+    int64_t now = hostMicros();
+    if (seconds > 0 && now - start >= (int64_t)seconds * 1000000) {
+      break;
+    }
+    if (now < nextTick) {
+      usleep(nextTick - now);
+      continue;
+    }
+
+    for (int i = 0; i < count; i++) {
+      emitSample(devices[i], format, tick, stats);
+    }
+    tick++;
+    nextTick += period;
+
+    if (now >= nextReport) {
+      fprintf(stderr, "loadgen: %lu msg/s, %lu B/s, %lu dropped\n",
+              (stats.messages - reported.messages) / 5, (stats.bytes - reported.bytes) / 5,
+              stats.dropped - reported.dropped);
+      reported = stats;
+      nextReport += 5000000;
+    }
+  }
+
+  for (int i = 0; i < count; i++) {
+    close(devices[i].fd);
+  }
+  return 0;
+}
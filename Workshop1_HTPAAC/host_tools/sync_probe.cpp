@@ -0,0 +1,375 @@
+/*
+╔══════════════════════════════════════════════════════════════════════════╗
+║                     CLOCK SYNC & LATENCY PROBE                            ║
+║       How old is a GSR sample by the time the computer receives it?       ║
+╚══════════════════════════════════════════════════════════════════════════╝
+
+ Runs repeated SYNC exchanges (see TelemetryCodec.h) against the device,
+ keeps the exchange with the smallest round trip from a sliding window,
+ and uses that clock offset to turn every telemetry time_us into host
+ time. Prints each exchange as it happens, then the latency distribution.
+
+ USAGE:
+ -----
+   sync_probe /dev/ttyACM0 [rounds]     real device (switches it to TELEMETRY:BIN)
+   sync_probe --simulate [rounds]       built-in fake device on a pseudo-terminal
+
+ --simulate forks a stand-in device behind a pty with a clock that starts
+ just before the 32-bit micros() wrap, runs 50 ppm fast, and random,
+ asymmetric USB delays. It knows the true offset, so the "error" column
+ shows how far the estimate is off.
+
+ Latency here is sensor → host read(); the browser adds its own render
+ delay on top.
+*/
+
+#include "TelemetryCodec.h"
+#include "HostSerial.h"
+
+#include <algorithm>
+#include <vector>
+
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+//━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+//                               CLOCKS
+//━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+
+static void sleepMicros(int64_t us) {
+  if (us > 0) {
+    usleep(us);
+  }
+}
+
+// The device sends micros() as 32 bits, which wraps every ~71 minutes
+class DeviceClock {
+  private:
+    bool started = false;
+    int64_t high = 0;
+    uint32_t last = 0;
+
+  public:
+    int64_t unwrap(uint32_t raw) {
+      if (!started) {
+        started = true;
+        last = raw;
+        return raw;
+      }
+      if (raw < last && last - raw > 0x80000000u) {
+        high += 1LL << 32;      // Wrapped forward
+        last = raw;
+      } else if (raw > last && raw - last > 0x80000000u) {
+        return high - (1LL << 32) + raw;   // Late value from before the wrap
+      } else if (raw > last) {
+        last = raw;
+      }
+      return high + raw;
+    }
+};
+
+//━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+//                          OFFSET ESTIMATOR
+//━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+// NTP's clock filter: an exchange with a short round trip had little room
+// for asymmetric delay, so its offset is the most trustworthy. The window
+// is short so a drifting device clock is still followed.
+
+struct SyncExchange {
+  int64_t offset;   // Device clock - host clock
+  int64_t rtt;
+};
+
+class OffsetEstimator {
+  private:
+    static const size_t kWindow = 8;
+    SyncExchange window[kWindow];
+    size_t count = 0;
+
+  public:
+    void add(const SyncExchange& exchange) {
+      window[count % kWindow] = exchange;
+      count++;
+    }
+
+    bool ready() const {
+      return count >= 4;
+    }
+
+    SyncExchange best() const {
+      size_t n = std::min(count, kWindow);
+      SyncExchange result = window[0];
+      for (size_t i = 1; i < n; i++) {
+        if (window[i].rtt < result.rtt) {
+          result = window[i];
+        }
+      }
+      return result;
+    }
+};
+
+//━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+//                      SIMULATED DEVICE (--simulate)
+//━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+
+struct SimulatedClock {
+  int64_t hostStart;      // Host time when the device "booted"
+  int64_t deviceStart;    // Device micros() at that moment (unwrapped)
+  double skew;            // Device clock rate error
+
+  int64_t deviceAt(int64_t host) const {
+    return deviceStart + (int64_t)((host - hostStart) * (1.0 + skew));
+  }
+
+  int64_t trueOffset(int64_t host) const {
+    return deviceAt(host) - host;
+  }
+};
+
+static int64_t randomMicros(int64_t low, int64_t high) {
+  return low + rand() % (high - low + 1);
+}
+
+// One-way USB/driver delay: usually short, sometimes a long stall
+static int64_t usbDelay(int64_t low, int64_t high) {
+  return (rand() % 10 == 0) ? randomMicros(3000, 8000) : randomMicros(low, high);
+}
+
+static void writeFrame(int fd, uint8_t type, const uint8_t* payload, size_t length) {
+  uint8_t frame[TELEMETRY_MAX_FRAME(TELEMETRY_MAX_PAYLOAD)];
+  size_t n = encodeFrame(type, payload, length, frame);
+  if (write(fd, frame, n) < 0) {
+    _exit(0);
+  }
+}
+
+// Child process: behaves like the firmware for SYNC and 100 Hz telemetry
+static void runSimulatedDevice(int fd, const SimulatedClock& clock) {
+  char line[128];
+  size_t lineLength = 0;
+  bool binary = false;
+  uint16_t sequence = 0;
+  int64_t nextSample = hostMicros() + 10000;
+
+  for (;;) {
+    int64_t wait = nextSample - hostMicros();
+    struct pollfd pfd = { fd, POLLIN, 0 };
+    if (poll(&pfd, 1, wait > 0 ? (int)(wait / 1000) : 0) > 0) {
+      char buffer[256];
+      ssize_t n = read(fd, buffer, sizeof(buffer));
+      if (n <= 0) {
+        _exit(0);   // Probe closed the port
+      }
+
+      for (ssize_t i = 0; i < n; i++) {
+        if (buffer[i] == '\r') {
+          continue;
+        }
+        if (buffer[i] != '\n') {
+          if (lineLength < sizeof(line) - 1) {
+            line[lineLength++] = buffer[i];
+          }
+          continue;
+        }
+        line[lineLength] = '\0';
+        lineLength = 0;
+
+        if (strcmp(line, "TELEMETRY:BIN") == 0) {
+          const char* ack = "{\"status\":\"TELEMETRY_BINARY\"}\r\n";
+          if (write(fd, ack, strlen(ack)) < 0) {
+            _exit(0);
+          }
+          binary = true;
+        } else if (strncmp(line, "SYNC:", 5) == 0 && binary) {
+          sleepMicros(usbDelay(150, 600));           // Host → device
+          SyncReply reply;
+          reply.hostTime = strtoull(line + 5, nullptr, 10);
+          reply.deviceRxMicros = (uint32_t)clock.deviceAt(hostMicros());
+          sleepMicros(randomMicros(20, 200));        // Firmware loop
+          reply.deviceTxMicros = (uint32_t)clock.deviceAt(hostMicros());
+          sleepMicros(usbDelay(300, 1500));          // Device → host
+          uint8_t payload[TELEMETRY_SYNC_PAYLOAD];
+          writeFrame(fd, FRAME_SYNC, payload, packSyncReply(reply, payload));
+        }
+      }
+    }
+
+    if (binary && hostMicros() >= nextSample) {
+      TelemetrySample sample = { sequence++, (uint32_t)clock.deviceAt(hostMicros()),
+                                 (uint16_t)randomMicros(480, 520), 500, 0, 500 };
+      sleepMicros(usbDelay(300, 2500));              // Queueing + USB frame
+      uint8_t payload[TELEMETRY_SAMPLE_PAYLOAD];
+      writeFrame(fd, FRAME_SAMPLE, payload, packSample(sample, payload));
+      nextSample += 10000;
+    }
+  }
+}
+
+static int openSimulatedDevice(SimulatedClock& clock, pid_t& child) {
+  char path[64];
+  int master = openPseudoTerminal(path, sizeof(path));
+  if (master < 0) {
+    return -1;
+  }
+  int fd = openSerialPort(path);
+  if (fd < 0) {
+    return -1;
+  }
+
+  clock.hostStart = hostMicros();
+  clock.deviceStart = 4294000000LL;   // ~1 s before micros() wraps
+  clock.skew = 50e-6;
+
+  child = fork();
+  if (child == 0) {
+    close(fd);
+    srand(getpid());
+    runSimulatedDevice(master, clock);
+  }
+  close(master);
+  return fd;
+}
+
+static void sendLine(int fd, const char* text) {
+  if (write(fd, text, strlen(text)) < 0) {
+    perror("write");
+  }
+}
+
+//━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+//                                 PROBE
+//━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+
+static double percentile(std::vector<double>& values, double p) {
+  size_t index = (size_t)(p / 100.0 * (values.size() - 1));
+  std::nth_element(values.begin(), values.begin() + index, values.end());
+  return values[index];
+}
+
+static void runProbe(int fd, int rounds, const SimulatedClock* truth) {
+  DeviceClock deviceClock;
+  OffsetEstimator estimator;
+  std::vector<double> latencies;
+  uint8_t frame[1024];
+  size_t frameLength = 0;
+  int replies = 0;
+
+  sendLine(fd, "TELEMETRY:BIN\n");
+  usleep(100000);
+
+  printf("round   rtt_us  offset_us   best_offset_us%s\n", truth ? "   error_us" : "");
+
+  int64_t end = hostMicros() + (int64_t)rounds * 100000 + 200000;
+  int64_t nextSync = hostMicros();
+  int sent = 0;
+
+  while (hostMicros() < end) {
+    if (sent < rounds && hostMicros() >= nextSync) {
+      char command[48];
+      snprintf(command, sizeof(command), "SYNC:%lld\n", (long long)hostMicros());
+      sendLine(fd, command);
+      sent++;
+      nextSync += 100000;
+    }
+
+    struct pollfd pfd = { fd, POLLIN, 0 };
+    if (poll(&pfd, 1, 5) <= 0) {
+      continue;
+    }
+    uint8_t buffer[512];
+    ssize_t n = read(fd, buffer, sizeof(buffer));
+    int64_t arrival = hostMicros();
+    if (n <= 0) {
+      break;
+    }
+
+    for (ssize_t i = 0; i < n; i++) {
+      if (buffer[i] != 0) {
+        if (frameLength < sizeof(frame)) {
+          frame[frameLength++] = buffer[i];
+        }
+        continue;
+      }
+
+      size_t body = decodeFrame(frame, frameLength);
+      frameLength = 0;
+      if (body == 0) {
+        continue;   // Text before the switch, or a damaged frame
+      }
+
+      if (frame[0] == FRAME_SYNC) {
+        SyncReply reply;
+        if (!unpackSyncReply(frame + 1, body - 1, reply)) {
+          continue;
+        }
+        int64_t t1 = (int64_t)reply.hostTime;
+        int64_t t2 = deviceClock.unwrap(reply.deviceRxMicros);
+        int64_t t3 = deviceClock.unwrap(reply.deviceTxMicros);
+        int64_t t4 = arrival;
+
+        SyncExchange exchange;
+        exchange.rtt = (t4 - t1) - (t3 - t2);
+        exchange.offset = ((t2 - t1) + (t3 - t4)) / 2;
+        estimator.add(exchange);
+        SyncExchange best = estimator.best();
+
+        printf("%5d %8lld %10lld %16lld", ++replies, (long long)exchange.rtt,
+               (long long)exchange.offset, (long long)best.offset);
+        if (truth != nullptr) {
+          printf(" %10lld", (long long)(best.offset - truth->trueOffset(t4)));
+        }
+        printf("\n");
+      } else if (frame[0] == FRAME_SAMPLE && estimator.ready()) {
+        TelemetrySample sample;
+        if (unpackSample(frame + 1, body - 1, sample)) {
+          int64_t sampleHostTime = deviceClock.unwrap(sample.timeMicros) - estimator.best().offset;
+          latencies.push_back((arrival - sampleHostTime) / 1000.0);
+        }
+      }
+    }
+  }
+
+  sendLine(fd, "TELEMETRY:JSON\n");
+
+  if (latencies.empty()) {
+    printf("\nno telemetry received after sync\n");
+    return;
+  }
+  printf("\nsensor → host latency over %zu samples (ms):\n", latencies.size());
+  printf("  p50 %.2f   p90 %.2f   p99 %.2f   max %.2f\n", percentile(latencies, 50),
+         percentile(latencies, 90), percentile(latencies, 99), percentile(latencies, 100));
+}
+
+//━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+//                                 MAIN
+//━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+
+int main(int argc, char** argv) {
+  if (argc < 2) {
+    fprintf(stderr, "usage: %s <serial port | --simulate> [rounds]\n", argv[0]);
+    return 1;
+  }
+  int rounds = argc > 2 ? atoi(argv[2]) : 40;
+  bool simulate = strcmp(argv[1], "--simulate") == 0;
+
+  SimulatedClock clock;
+  pid_t child = -1;
+  int fd = simulate ? openSimulatedDevice(clock, child) : openSerialPort(argv[1]);
+  if (fd < 0) {
+    return 1;
+  }
+
+  runProbe(fd, rounds, simulate ? &clock : nullptr);
+
+  close(fd);
+  if (child > 0) {
+    kill(child, SIGTERM);
+    waitpid(child, nullptr, 0);
+  }
+  return 0;
+}
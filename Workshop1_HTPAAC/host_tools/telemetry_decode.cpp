@@ -0,0 +1,277 @@
+/*
+╔══════════════════════════════════════════════════════════════════════════╗
+║                       TELEMETRY CAPTURE DECODER                           ║
+║        Turns a binary serial capture from 2_Hard_Mode into CSV            ║
+╚══════════════════════════════════════════════════════════════════════════╝
+
+ Uses the same TelemetryCodec.cpp as the firmware, so device and host can
+ never disagree about the frame layout.
+
+ USAGE:
+ -----
+   telemetry_decode capture.bin > samples.csv
+   cat /dev/ttyACM0 | telemetry_decode -        (after sending TELEMETRY:BATCH)
+   telemetry_decode --roundtrip 10000           (encode/decode check + size report)
+
+ CSV columns: seq,time_us,raw,ema,derivative,baseline
+ (batch frames carry only raw, FIELDS frames only the chosen subset;
+ missing columns are left empty)
+ Status and STATS frames are printed as "# ..." lines; totals go to stderr.
+*/
+
+#include "TelemetryCodec.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+//━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+//                              STATISTICS
+//━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+
+struct DecodeStats {
+  unsigned long bytes;        // Every byte read, including delimiters and junk
+  unsigned long frames;       // Frames that passed COBS + CRC
+  unsigned long badFrames;    // Frames that failed (text lines, line noise)
+  unsigned long samples;      // Sample rows written
+};
+
+static void printReport(const DecodeStats& stats) {
+  fprintf(stderr, "bytes:        %lu\n", stats.bytes);
+  fprintf(stderr, "frames:       %lu good, %lu bad\n", stats.frames, stats.badFrames);
+  fprintf(stderr, "samples:      %lu\n", stats.samples);
+  if (stats.samples > 0) {
+    fprintf(stderr, "bytes/sample: %.2f\n", (double)stats.bytes / stats.samples);
+  }
+}
+
+//━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+//                            FRAME HANDLING
+//━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+
+static void handleFrame(uint8_t* frame, size_t length, FILE* out, DecodeStats& stats) {
+  size_t body = decodeFrame(frame, length);
+  if (body == 0) {
+    stats.badFrames++;
+    return;
+  }
+  stats.frames++;
+
+  const uint8_t* payload = frame + 1;
+  size_t payloadLength = body - 1;
+
+  switch (frame[0]) {
+    case FRAME_SAMPLE: {
+      TelemetrySample s;
+      if (unpackSample(payload, payloadLength, s)) {
+        fprintf(out, "%u,%lu,%u,%.3f,%.3f,%.3f\n", s.sequence, (unsigned long)s.timeMicros,
+                s.raw, s.ema, s.derivative, s.baseline);
+        stats.samples++;
+      }
+      break;
+    }
+
+    case FRAME_FIELDS: {
+      TelemetrySample s;
+      uint8_t fields;
+      if (unpackSampleFields(payload, payloadLength, s, fields)) {
+        fprintf(out, "%u,%lu,", s.sequence, (unsigned long)s.timeMicros);
+        if (fields & FIELD_RAW) {
+          fprintf(out, "%u", s.raw);
+        }
+        fputc(',', out);
+        if (fields & FIELD_EMA) {
+          fprintf(out, "%.3f", s.ema);
+        }
+        fputc(',', out);
+        if (fields & FIELD_DERIVATIVE) {
+          fprintf(out, "%.3f", s.derivative);
+        }
+        fputc(',', out);
+        if (fields & FIELD_BASELINE) {
+          fprintf(out, "%.3f", s.baseline);
+        }
+        fputc('\n', out);
+        stats.samples++;
+      }
+      break;
+    }
+
+    case FRAME_BATCH: {
+      RawSample batch[TELEMETRY_BATCH_MAX_SAMPLES];
+      size_t count = unpackBatch(payload, payloadLength, batch, TELEMETRY_BATCH_MAX_SAMPLES);
+      for (size_t i = 0; i < count; i++) {
+        fprintf(out, "%u,%lu,%u,,,\n", batch[i].sequence, (unsigned long)batch[i].timeMicros, batch[i].raw);
+      }
+      stats.samples += count;
+      break;
+    }
+
+    case FRAME_STATS: {
+      StatsReport r;
+      if (unpackStatsReport(payload, payloadLength, r)) {
+        fprintf(out, "# STATS ms=%u loops=%u loop_max_us=%u shows=%u show_mean_us=%u show_max_us=%u "
+                "rx=%u tx=%u tx_dropped=%u adc_overruns=%u heap_free=%u heap_block=%u\n",
+                r.elapsedMillis, r.loops, r.loopMaxMicros, r.shows, r.showMeanMicros, r.showMaxMicros,
+                r.bytesIn, r.bytesOut, r.droppedBytes, r.adcOverruns, r.freeHeap, r.largestFreeBlock);
+      }
+      break;
+    }
+
+    case FRAME_STATUS:
+      fprintf(out, "# %.*s\n", (int)payloadLength, (const char*)payload);
+      break;
+  }
+}
+
+static int decodeStream(FILE* in, FILE* out) {
+  DecodeStats stats = {0, 0, 0, 0};
+  uint8_t frame[1024];
+  size_t length = 0;
+  bool overflow = false;
+  int c;
+
+  fprintf(out, "seq,time_us,raw,ema,derivative,baseline\n");
+
+  while ((c = fgetc(in)) != EOF) {
+    stats.bytes++;
+    if (c != 0) {
+      if (length < sizeof(frame)) {
+        frame[length++] = c;
+      } else {
+        overflow = true;
+      }
+      continue;
+    }
+
+    // 0x00 ends a frame; text before TELEMETRY:BIN just shows up as bad frames
+    if (overflow) {
+      stats.badFrames++;
+    } else if (length > 0) {
+      handleFrame(frame, length, out, stats);
+    }
+    length = 0;
+    overflow = false;
+  }
+
+  printReport(stats);
+  return 0;
+}
+
+//━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+//                           ROUND-TRIP CHECK
+//━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+// Feeds a synthetic GSR signal (slow drift, skin response bumps, ADC noise,
+// loop jitter) through both encoders exactly like the firmware does, then
+// decodes it again and compares every field.
+
+static int roundTrip(unsigned long count) {
+  srand(1);
+
+  RawSample* sent = new RawSample[count];
+  uint32_t time = 123456;
+  for (unsigned long i = 0; i < count; i++) {
+    double drift = 500 + 150 * sin(i / 3000.0);
+    double response = (i % 700 < 150) ? 80 * sin((i % 700) * M_PI / 150) : 0;
+    int noise = rand() % 9 - 4;
+    sent[i].sequence = i;
+    sent[i].timeMicros = time;
+    sent[i].raw = (uint16_t)fmax(0, fmin(4095, drift + response + noise));
+    time += 10000 + rand() % 1200;   // 100 Hz plus loop jitter
+  }
+
+  uint8_t frame[TELEMETRY_MAX_FRAME(TELEMETRY_MAX_PAYLOAD)];
+  unsigned long recordBytes = 0;
+  unsigned long batchBytes = 0;
+  unsigned long batchFrames = 0;
+  unsigned long received = 0;
+  unsigned long mismatches = 0;
+  TelemetryBatch batch;
+
+  // Flushes the batch through the full wire path and checks what comes out
+  auto flush = [&]() {
+    size_t length = encodeFrame(FRAME_BATCH, batch.payload(), batch.size(), frame);
+    batchBytes += length;
+    batchFrames++;
+    batch.reset();
+
+    size_t body = decodeFrame(frame, length - 1);
+    RawSample decoded[TELEMETRY_BATCH_MAX_SAMPLES];
+    size_t n = body > 0 ? unpackBatch(frame + 1, body - 1, decoded, TELEMETRY_BATCH_MAX_SAMPLES) : 0;
+    if (n == 0) {
+      mismatches++;
+    }
+    for (size_t i = 0; i < n; i++, received++) {
+      const RawSample& expected = sent[received];
+      if (decoded[i].sequence != (uint16_t)expected.sequence ||
+          decoded[i].timeMicros != expected.timeMicros || decoded[i].raw != expected.raw) {
+        mismatches++;
+      }
+    }
+  };
+
+  for (unsigned long i = 0; i < count; i++) {
+    // Single records, as sent by TELEMETRY:BIN
+    TelemetrySample sample = {(uint16_t)i, sent[i].timeMicros, sent[i].raw, 0, 0, 0};
+    uint8_t payload[TELEMETRY_SAMPLE_PAYLOAD];
+    size_t length = encodeFrame(FRAME_SAMPLE, payload, packSample(sample, payload), frame);
+    recordBytes += length;
+
+    TelemetrySample decoded;
+    size_t body = decodeFrame(frame, length - 1);
+    if (body == 0 || !unpackSample(frame + 1, body - 1, decoded) ||
+        decoded.timeMicros != sample.timeMicros || decoded.raw != sample.raw) {
+      mismatches++;
+    }
+
+    // Batches, as sent by TELEMETRY:BATCH (200 ms flush like the sketch)
+    if (!batch.add(sent[i].sequence, sent[i].timeMicros, sent[i].raw)) {
+      flush();
+      batch.add(sent[i].sequence, sent[i].timeMicros, sent[i].raw);
+    }
+    if (batch.age(sent[i].timeMicros) >= 200000) {
+      flush();
+    }
+  }
+  if (batch.count() > 0) {
+    flush();
+  }
+
+  printf("samples:              %lu\n", count);
+  printf("record frames:        %.2f bytes/sample\n", (double)recordBytes / count);
+  printf("batch frames:         %.2f bytes/sample (%lu frames, %.1f samples each)\n",
+         (double)batchBytes / count, batchFrames, (double)count / batchFrames);
+  printf("JSON {\"ema\":123.45}:  16.00 bytes/sample (ema only, with CRLF)\n");
+  printf("decoded:              %lu, mismatches: %lu\n", received, mismatches);
+
+  delete[] sent;
+  return (mismatches == 0 && received == count) ? 0 : 1;
+}
+
+//━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+//                                 MAIN
+//━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+
+int main(int argc, char** argv) {
+  if (argc == 3 && strcmp(argv[1], "--roundtrip") == 0) {
+    unsigned long count = strtoul(argv[2], nullptr, 10);
+    return count > 0 ? roundTrip(count) : 1;
+  }
+
+  if (argc != 2) {
+    fprintf(stderr, "usage: %s <capture.bin | -> | --roundtrip <samples>\n", argv[0]);
+    return 1;
+  }
+
+  FILE* in = strcmp(argv[1], "-") == 0 ? stdin : fopen(argv[1], "rb");
+  if (in == nullptr) {
+    perror(argv[1]);
+    return 1;
+  }
+  int result = decodeStream(in, stdout);
+  if (in != stdin) {
+    fclose(in);
+  }
+  return result;
+}
@@ -0,0 +1,81 @@
+/*
+╔══════════════════════════════════════════════════════════════════════════╗
+║                 SERIAL COMMAND PARSER IMPLEMENTATION                      ║
+╚══════════════════════════════════════════════════════════════════════════╝
+*/
+
+#include "CommandParser.h"
+
+//━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+//                          LINE ASSEMBLER
+//━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+
+LineAssembler::LineAssembler() {
+    reset();
+}
+
+bool LineAssembler::feed(char c) {
+    if (c == '\n') {
+        bool complete = !overflow;
+        buffer[length] = '\0';
+        length = 0;
+        overflow = false;
+        return complete;  // Over-long lines are dropped whole
+    }
+
+    if (c == '\r') {
+        return false;
+    }
+
+    if (length < GSR_COMMAND_MAX_LENGTH) {
+        buffer[length++] = c;
+    } else {
+        overflow = true;
+    }
+    return false;
+}
+
+char* LineAssembler::line() {
+    return buffer;
+}
+
+void LineAssembler::reset() {
+    length = 0;
+    overflow = false;
+    buffer[0] = '\0';
+}
+
+//━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+//                          COMMAND SPLITTING
+//━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+
+ParsedCommand splitCommand(char* line) {
+    // Trim leading and trailing whitespace in place
+    while (*line == ' ' || *line == '\t') {
+        line++;
+    }
+    char* end = line + strlen(line);
+    while (end > line && (end[-1] == ' ' || end[-1] == '\t')) {
+        *--end = '\0';
+    }
+
+    ParsedCommand command = { line, nullptr };
+    char* colon = strchr(line, ':');
+    if (colon != nullptr) {
+        *colon = '\0';
+        command.args = colon + 1;
+    }
+    return command;
+}
+
+//━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+//                          COMMAND HASHING
+//━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+
+uint32_t hashName(const char* name) {
+    uint32_t hash = 2166136261UL;
+    while (*name) {
+        hash = (hash ^ (uint8_t)*name++) * 16777619UL;
+    }
+    return hash;
+}
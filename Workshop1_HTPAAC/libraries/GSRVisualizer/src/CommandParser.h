@@ -0,0 +1,72 @@
+/*
+╔══════════════════════════════════════════════════════════════════════════╗
+║                      SERIAL COMMAND PARSER                                ║
+║            Fixed-buffer line assembly and hashed command dispatch         ║
+╚══════════════════════════════════════════════════════════════════════════╝
+
+ Commands from p5.js arrive one byte at a time. Building them up in an
+ Arduino String allocates on the heap for every byte and every substring,
+ which slowly fragments memory over a long session. This parser never
+ allocates:
+
+ • LineAssembler collects bytes into a fixed buffer. Each byte costs the
+   same small, bounded amount of work; lines that are too long are dropped.
+ • splitCommand() trims the line and splits "NAME:ARGS" in place by
+   writing a '\0' over the first ':'.
+ • commandHash() turns a name into a number. It is constexpr, so command
+   names can be used as switch labels: the compiler computes their hashes
+   and rejects the build if two names ever collide.
+*/
+
+#ifndef COMMAND_PARSER_H
+#define COMMAND_PARSER_H
+
+#include <Arduino.h>
+
+// Longest command line accepted (e.g. "LED:COLOR:255,255,255")
+#define GSR_COMMAND_MAX_LENGTH 64
+
+//━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+//                          LINE ASSEMBLER
+//━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+
+class LineAssembler {
+  private:
+    char buffer[GSR_COMMAND_MAX_LENGTH + 1];
+    uint8_t length;
+    bool overflow;
+
+  public:
+    LineAssembler();
+
+    // Feed one byte; returns true when a complete line is ready in line()
+    bool feed(char c);
+    char* line();
+    void reset();
+};
+
+//━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+//                          COMMAND SPLITTING
+//━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+
+struct ParsedCommand {
+  char* name;   // Text before the first ':' (whole line if there is none)
+  char* args;   // Text after the first ':' or nullptr
+};
+
+// Modifies line in place; name/args point into it
+ParsedCommand splitCommand(char* line);
+
+//━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+//                          COMMAND HASHING
+//━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+// FNV-1a. The constexpr form is for case labels, hashName() for input;
+// both give the same value.
+
+constexpr uint32_t commandHash(const char* name, uint32_t hash = 2166136261UL) {
+  return *name ? commandHash(name + 1, (hash ^ (uint8_t)*name) * 16777619UL) : hash;
+}
+
+uint32_t hashName(const char* name);
+
+#endif
@@ -0,0 +1,74 @@
+/*
+╔══════════════════════════════════════════════════════════════════════════╗
+║                16-BIT DITHERED FRAME BUFFER IMPLEMENTATION                ║
+╚══════════════════════════════════════════════════════════════════════════╝
+*/
+
+#include "DitheredFrame.h"
+
+DitheredFrame::DitheredFrame(uint16_t* valueStorage, uint8_t* residualStorage, int ledCount)
+    : values(valueStorage), residuals(residualStorage), numLeds(ledCount), dithering(true) {
+
+    for (int i = 0; i < numLeds * 3; i++) {
+        values[i] = 0;
+        residuals[i] = 0;
+    }
+}
+
+//━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+//                           DRAWING
+//━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+
+void DitheredFrame::clear() {
+    // Residuals are kept so fades stay smooth from frame to frame
+    for (int i = 0; i < numLeds * 3; i++) {
+        values[i] = 0;
+    }
+}
+
+void DitheredFrame::set(int ledIndex, uint16_t r, uint16_t g, uint16_t b) {
+    uint16_t* pixel = &values[ledIndex * 3];
+    pixel[0] = r;
+    pixel[1] = g;
+    pixel[2] = b;
+}
+
+void DitheredFrame::scale(int ledIndex, uint8_t amount) {
+    uint16_t* pixel = &values[ledIndex * 3];
+    for (int c = 0; c < 3; c++) {
+        pixel[c] = ((uint32_t)pixel[c] * (amount + 1)) >> 8;
+    }
+}
+
+void DitheredFrame::setDithering(bool enabled) {
+    dithering = enabled;
+}
+
+//━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+//                           OUTPUT PASS
+//━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+
+void DitheredFrame::render(Adafruit_NeoPixel& strip, uint32_t gain) {
+    uint8_t out[3];
+
+    for (int i = 0; i < numLeds; i++) {
+        uint16_t* pixel = &values[i * 3];
+        uint8_t* residual = &residuals[i * 3];
+
+        for (int c = 0; c < 3; c++) {
+            // 65535 × 65536 still fits in 32 bits
+            uint32_t level = ((uint32_t)pixel[c] * gain) >> 16;
+
+            if (dithering) {
+                level += residual[c];
+                residual[c] = level & 0xFF;
+            } else {
+                level += 0x80;  // Plain rounding
+            }
+
+            out[c] = level > 0xFFFF ? 255 : level >> 8;
+        }
+
+        strip.setPixelColor(i, out[0], out[1], out[2]);
+    }
+}
@@ -0,0 +1,51 @@
+/*
+╔══════════════════════════════════════════════════════════════════════════╗
+║                     16-BIT DITHERED FRAME BUFFER                          ║
+║           Smooth low-brightness fades on an 8-bit LED strip               ║
+╚══════════════════════════════════════════════════════════════════════════╝
+
+ WS2812 LEDs only take 8 bits per color. At a brightness of 50 a dim trail
+ only has a handful of real steps left, so fades visibly jump. This buffer
+ keeps every channel at 16 bits and applies brightness (and the power
+ limit) in 16 bits too. Only the final output is cut down to 8 bits.
+
+ TEMPORAL DITHERING:
+ ------------------
+ The bits lost in that last step are not thrown away: each channel keeps
+ its remainder and adds it to the next refresh. A value of 2.3 is shown
+ as 2, 2, 3, 2, 2, 3... and the eye averages it to 2.3. Refreshing the
+ strip often (see GSRVisualizer::refresh) makes this flicker invisible.
+
+ COST: one multiply, add and shift per channel per refresh. Sending the
+ data to the strip (~30 µs per LED) costs far more than the dithering.
+
+ The owner passes in the two arrays (3 × LEDs each), so nothing is
+ allocated here; GSRVisualizer sizes them at compile time.
+*/
+
+#ifndef DITHERED_FRAME_H
+#define DITHERED_FRAME_H
+
+#include <Arduino.h>
+#include <Adafruit_NeoPixel.h>
+
+class DitheredFrame {
+  private:
+    uint16_t* values;     // 3 channels per LED, 0-65535
+    uint8_t* residuals;   // Carried quantization error per channel
+    int numLeds;
+    bool dithering;
+
+  public:
+    DitheredFrame(uint16_t* valueStorage, uint8_t* residualStorage, int ledCount);
+
+    void clear();
+    void set(int ledIndex, uint16_t r, uint16_t g, uint16_t b);
+    void scale(int ledIndex, uint8_t amount);
+    void setDithering(bool enabled);
+
+    // gain: 0-65536, brightness and power limit combined (65536 = full)
+    void render(Adafruit_NeoPixel& strip, uint32_t gain);
+};
+
+#endif
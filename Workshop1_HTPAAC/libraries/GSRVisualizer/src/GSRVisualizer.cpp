@@ -5,34 +5,38 @@
 */
 
 #include "GSRVisualizer.h"
+#include "LEDEffects.h"
+
+const GroupColor kGroupColors[GROUP_COUNT] PROGMEM = {
+    {255, 0, 0},     // Red
+    {0, 255, 0},     // Green
+    {0, 0, 255},     // Blue
+    {255, 128, 0},   // Orange
+    {255, 0, 255}    // Purple
+};
+
+GroupColor getGroupColor(int group) {
+    const GroupColor* entry = &kGroupColors[constrain(group - 1, 0, GROUP_COUNT - 1)];
+    GroupColor color = { pgm_read_byte(&entry->r), pgm_read_byte(&entry->g), pgm_read_byte(&entry->b) };
+    return color;
+}
 
-GSRVisualizer::GSRVisualizer(Adafruit_NeoPixel& ledStrip, int numSamples)
-    : strip(ledStrip), numReadings(numSamples), readIndex(0), total(0),
+GSRVisualizer::GSRVisualizer(Adafruit_NeoPixel& ledStrip, const VisualizerBuffers& buffers)
+    : strip(ledStrip), numLeds(min((int)ledStrip.numPixels(), buffers.maxLeds)),
+      ledFrame(buffers.frameValues, buffers.frameResiduals, numLeds), outputGain(0),
+      refreshIntervalMicros(5000), lastRefreshMicros(0),
+      readings(buffers.readings), numReadings(buffers.numReadings), readIndex(0), total(0),
       alpha(0.3), inSpike(false), spikeThreshold(100.0), lastFilteredValue(0),
-      animationPosition(0), lastAnimationTime(0), trailLength(5),
-      currentLEDMode(MODE_GSR_VISUALIZATION), solidColor(0), groupNumber(1),
+      currentEffect(0), groupNumber(0),
       adaptiveBaseline(0), adaptiveAlpha(0.001), normalizedEma(0),
       shortTermBaseline(0), simulationMode(false), simulatedEma(0) {
 
-    numLeds = strip.numPixels();
-    readings = new int[numReadings];
+    brightness = strip.getBrightness();
+    takeStripBrightness();
 
     for (int i = 0; i < numReadings; i++) {
         readings[i] = 0;
     }
-
-    // Initialize group colors
-    groupColors = new GroupColor[5];
-    groupColors[0] = {255, 0, 0};     // Red
-    groupColors[1] = {0, 255, 0};     // Green
-    groupColors[2] = {0, 0, 255};     // Blue
-    groupColors[3] = {255, 128, 0};   // Orange
-    groupColors[4] = {255, 0, 255};   // Purple
-}
-
-GSRVisualizer::~GSRVisualizer() {
-    delete[] readings;
-    delete[] groupColors;
 }
 
 //━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
@@ -60,15 +64,12 @@ void GSRVisualizer::checkForSpikes(float filteredValue) {
     if (change > dynamicThreshold && !inSpike) {
         inSpike = true;
 
-        // Create a bright flash effect when spike detected
-        static unsigned long spikeStartTime = millis();
-        spikeStartTime = millis();
-
-        // Bright white flash that fades to red
+        // Bright white flash when a spike is detected
+        beginFrame();
         for (int i = 0; i < numLeds; i++) {
-            strip.setPixelColor(i, strip.Color(255, 100, 100));  // Bright pink-white
+            setPixel(i, 255, 100, 100);  // Bright pink-white
         }
-        strip.show();
+        showFrame();
 
     } else if (change < dynamicThreshold * 0.3 && inSpike) {
         inSpike = false;
@@ -89,6 +90,12 @@ void GSRVisualizer::updateAdaptiveBaseline(float emaValue) {
     }
 }
 
+// RESET from the host: start adapting again from the current value
+void GSRVisualizer::resetAdaptiveBaseline(float emaValue) {
+    adaptiveBaseline = emaValue;
+    shortTermBaseline = emaValue;
+}
+
 float GSRVisualizer::calculateNormalizedEma(float emaValue, int gsrMin, int gsrMax) {
     float deviation = emaValue - adaptiveBaseline;
     float range = max(50.0, abs(gsrMax - gsrMin) * 0.3);
@@ -121,7 +128,9 @@ float GSRVisualizer::getCombinedSignal(float emaValue, float emaDerivative, int
 //                         BASIC LED VISUALIZATION
 //━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
 
-void GSRVisualizer::updateLEDDisplay(float value, int gsrMin, int gsrMax) {
+// The gsrMin / gsrMax range is not used: the display follows the change
+// from its own running baseline instead
+void GSRVisualizer::updateLEDDisplay(float value, int, int) {
     // CRITICAL: GSR typically varies by ~100 units during normal use
     // We need to be very sensitive to these small changes
 
@@ -160,14 +169,15 @@ void GSRVisualizer::updateLEDDisplay(float value, int gsrMin, int gsrMax) {
         flowPosition -= numLeds;
     }
 
-    strip.clear();
+    beginFrame();
 
-    // Use group colors for Hard Mode
+    // Group color once a group is set (Hard Mode), else the starter's pink
     int baseR, baseG, baseB;
-    if (groupColors != nullptr && groupNumber > 0 && groupNumber <= 5) {
-        baseR = groupColors[groupNumber - 1].r;
-        baseG = groupColors[groupNumber - 1].g;
-        baseB = groupColors[groupNumber - 1].b;
+    if (groupNumber > 0 && groupNumber <= GROUP_COUNT) {
+        GroupColor color = getGroupColor(groupNumber);
+        baseR = color.r;
+        baseG = color.g;
+        baseB = color.b;
     } else {
         // Fallback to deep pink if no group set
         baseR = 255;
@@ -194,23 +204,20 @@ void GSRVisualizer::updateLEDDisplay(float value, int gsrMin, int gsrMax) {
             // No squaring - keep it linear for clarity
         }
 
-        // Apply the color with intensity
-        int r = baseR * intensity;
-        int g = baseG * intensity;
-        int b = baseB * intensity;
+        // Apply the color with intensity (16-bit, so slow fades stay smooth)
+        uint16_t r = baseR * intensity * 257;
+        uint16_t g = baseG * intensity * 257;
+        uint16_t b = baseB * intensity * 257;
 
-        strip.setPixelColor(i, strip.Color(r, g, b));
-    }
+        // Add a dim background glow so you can see the strip is on
+        r = max(r, (uint16_t)(10 * 257));  // Very dim pink glow
+        g = max(g, (uint16_t)(1 * 257));
+        b = max(b, (uint16_t)(5 * 257));
 
-    // Add a dim background glow so you can see the strip is on
-    for (int i = 0; i < numLeds; i++) {
-        uint32_t currentColor = strip.getPixelColor(i);
-        if (currentColor == 0) {  // Only add glow to unlit pixels
-            strip.setPixelColor(i, strip.Color(10, 1, 5));  // Very dim pink glow
-        }
+        setPixel16(i, r, g, b);
     }
 
-    strip.show();
+    showFrame();
 }
 
 /*
@@ -227,102 +234,17 @@ void GSRVisualizer::updateLEDDisplay(float value, int gsrMin, int gsrMax) {
 //━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
 
 void GSRVisualizer::updateLEDs(float emaValue, int gsrMin, int gsrMax, float emaDerivative) {
-    switch (currentLEDMode) {
-        case MODE_GSR_VISUALIZATION:
-            visualizeGSR(false, emaValue, gsrMin, gsrMax, emaDerivative);
-            break;
-
-        case MODE_GSR_DOWNSTREAM:
-            visualizeGSR(true, emaValue, gsrMin, gsrMax, emaDerivative);
-            break;
-
-        case MODE_SOLID_COLOR:
-            setSolidColor();
-            break;
-
-        case MODE_PULSE:
-            showPulse();
-            break;
-
-        case MODE_RAINBOW:
-            showRainbow();
-            break;
-
-        case MODE_OFF:
-            strip.clear();
-            strip.show();
-            break;
-    }
+    // Single indexed call into the effect registry (LEDEffects.cpp)
+    EffectFrame frame = { emaValue, gsrMin, gsrMax, emaDerivative };
+    kLEDEffects[currentEffect].render(*this, frame);
 }
 
-uint32_t GSRVisualizer::getColorForLevel(int ledIndex) {
+uint32_t GSRVisualizer::getColorForLevel(int) {
     // Using single color #FF1493 (Deep Pink) for all LEDs
     // RGB(255, 20, 147)
     return strip.Color(255, 20, 147);
 }
 
-//━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
-//         HARD MODE: ADVANCED GSR VISUALIZATION WITH TRAIL EFFECT
-//━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
-
-void GSRVisualizer::visualizeGSR(bool downstream, float emaValue, int gsrMin, int gsrMax, float emaDerivative) {
-    float animationSpeed;
-
-    if (simulationMode && downstream) {
-        animationSpeed = map(simulatedEma, 0, 1023, 0.5, 8.0);
-    } else {
-        updateAdaptiveBaseline(emaValue);
-        calculateNormalizedEma(emaValue, gsrMin, gsrMax);
-        float amplifiedSignal = getCombinedSignal(emaValue, emaDerivative, gsrMin, gsrMax);
-        animationSpeed = 0.2 + amplifiedSignal * 7.8;
-    }
-
-    unsigned long currentTime = millis();
-    float deltaTime = (currentTime - lastAnimationTime) / 1000.0;
-    lastAnimationTime = currentTime;
-
-    if (downstream) {
-        animationPosition -= animationSpeed * deltaTime * 2;
-        if (animationPosition < -trailLength) {
-            animationPosition = numLeds + trailLength;
-        }
-    } else {
-        animationPosition += animationSpeed * deltaTime * 2;
-        if (animationPosition > numLeds + trailLength) {
-            animationPosition = -trailLength;
-        }
-    }
-
-    strip.clear();
-
-    GroupColor baseColor = groupColors[constrain(groupNumber - 1, 0, 4)];
-
-    for (int i = 0; i < numLeds; i++) {
-        float distance = downstream ? (i - animationPosition) : (animationPosition - i);
-
-        if (distance >= 0 && distance <= trailLength) {
-            float intensity = 1.0 - (distance / trailLength);
-            intensity = intensity * intensity;
-
-            int r = baseColor.r * intensity;
-            int g = baseColor.g * intensity;
-            int b = baseColor.b * intensity;
-
-            strip.setPixelColor(i, strip.Color(r, g, b));
-        } else {
-            float glowIntensity = map(emaValue, gsrMin, gsrMax, 0.02, 0.15);
-
-            int r = baseColor.r * glowIntensity;
-            int g = baseColor.g * glowIntensity;
-            int b = baseColor.b * glowIntensity;
-
-            strip.setPixelColor(i, strip.Color(r, g, b));
-        }
-    }
-
-    strip.show();
-}
-
 //━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
 //                         BASIC LED ANIMATIONS
 //━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
@@ -331,167 +253,99 @@ void GSRVisualizer::showCalibrationAnimation() {
     float pulse = (sin(millis() / 300.0) + 1.0) / 2.0;
     int brightness = 20 + (30 * pulse);
 
+    beginFrame();
     for (int i = 0; i < numLeds; i++) {
-        strip.setPixelColor(i, strip.Color(brightness, brightness, brightness));
+        setPixel(i, brightness, brightness, brightness);
     }
-    strip.show();
+    showFrame();
 }
 
 void GSRVisualizer::flashSuccess() {
     for (int i = 0; i < 3; i++) {
         setAllPixels(0, 255, 0);
         delay(200);
-        strip.clear();
-        strip.show();
+        beginFrame();
+        showFrame();
         delay(200);
     }
 }
 
 void GSRVisualizer::setAllPixels(int r, int g, int b) {
+    beginFrame();
     for (int i = 0; i < numLeds; i++) {
-        strip.setPixelColor(i, strip.Color(r, g, b));
+        setPixel(i, r, g, b);
     }
-    strip.show();
+    showFrame();
 }
 
 void GSRVisualizer::addBreathingEffect(int ledIndex) {
     float breath = (sin(millis() / 200.0) + 1.0) / 2.0;
-    uint32_t color = strip.getPixelColor(ledIndex);
-
-    int r = ((color >> 16) & 0xFF) * (0.5 + 0.5 * breath);
-    int g = ((color >> 8) & 0xFF) * (0.5 + 0.5 * breath);
-    int b = (color & 0xFF) * (0.5 + 0.5 * breath);
-
-    strip.setPixelColor(ledIndex, strip.Color(r, g, b));
+    ledFrame.scale(ledIndex, 128 + 127 * breath);
 }
 
 //━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
-//              HARD MODE: SPECIAL LED EFFECTS
+//                           FRAME OUTPUT
 //━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
-
-void GSRVisualizer::setSolidColor() {
-    for (int i = 0; i < numLeds; i++) {
-        strip.setPixelColor(i, solidColor);
-    }
-    strip.show();
+// Every effect draws a frame as beginFrame() → setPixel() once per LED →
+// showFrame(). Pixels go into the 16-bit ledFrame and are counted by the
+// power limiter as they are set. The output pass applies brightness and
+// the power limit together, dithers down to 8 bits and sends the strip.
+
+void GSRVisualizer::beginFrame() {
+    ledFrame.clear();
+    powerLimiter.beginFrame();
 }
 
-void GSRVisualizer::showPulse() {
-    float pulse = (sin(millis() / 300.0) + 1.0) / 2.0;
-    int brightness = 20 + (200 * pulse);
-
-    for (int i = 0; i < numLeds; i++) {
-        strip.setPixelColor(i, strip.Color(brightness, brightness, brightness));
-    }
-    strip.show();
+void GSRVisualizer::setPixel(int ledIndex, uint8_t r, uint8_t g, uint8_t b) {
+    setPixel16(ledIndex, r * 257, g * 257, b * 257);
 }
 
-void GSRVisualizer::showRainbow() {
-    static uint16_t hue = 0;
-
-    for (int i = 0; i < numLeds; i++) {
-        int pixelHue = hue + (i * 65536L / numLeds);
-        strip.setPixelColor(i, strip.gamma32(strip.ColorHSV(pixelHue)));
-    }
-
-    strip.show();
-    hue += 256;
+void GSRVisualizer::setPixel(int ledIndex, uint32_t color) {
+    setPixel(ledIndex, (color >> 16) & 0xFF, (color >> 8) & 0xFF, color & 0xFF);
 }
 
-//━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
-//              HARD MODE: WEB SERIAL COMMUNICATION
-//━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
-
-void GSRVisualizer::sendDataToP5(float emaValue) {
-    Serial.print("{\"ema\":");
-    Serial.print(emaValue, 2);
-    Serial.println("}");
+void GSRVisualizer::setPixel16(int ledIndex, uint16_t r, uint16_t g, uint16_t b) {
+    powerLimiter.add(r >> 8, g >> 8, b >> 8);
+    ledFrame.set(ledIndex, r, g, b);
 }
 
-void GSRVisualizer::sendStatus(String status) {
-    Serial.print("{\"status\":\"");
-    Serial.print(status);
-    Serial.println("\"}");
+void GSRVisualizer::showFrame() {
+    takeStripBrightness();
+    uint8_t limit = powerLimiter.endFrame(brightness, numLeds);
+    outputGain = (uint32_t)(brightness + 1) * (limit + 1);
+    pushFrame();
 }
 
-void GSRVisualizer::processCommand(String command, float& emaValue, float& baseline) {
-    command.trim();
-
-    if (command == "CALIBRATE") {
-        sendStatus("CALIBRATION_REQUESTED");
-
-    } else if (command == "RESET") {
-        baseline = emaValue;
-        adaptiveBaseline = emaValue;
-        shortTermBaseline = emaValue;
-        sendStatus("RESET_COMPLETE");
-
-    } else if (command.startsWith("LED:")) {
-        String ledCmd = command.substring(4);
-
-        if (ledCmd == "OFF") {
-            currentLEDMode = MODE_OFF;
-        } else if (ledCmd == "RAINBOW") {
-            currentLEDMode = MODE_RAINBOW;
-        } else if (ledCmd == "PULSE") {
-            currentLEDMode = MODE_PULSE;
-        } else if (ledCmd == "GSR") {
-            currentLEDMode = MODE_GSR_VISUALIZATION;
-        } else if (ledCmd.startsWith("COLOR:")) {
-            currentLEDMode = MODE_SOLID_COLOR;
-            parseColorCommand(ledCmd.substring(6));
-        }
-
-    } else if (command.startsWith("BRIGHTNESS:")) {
-        int brightness = command.substring(11).toInt();
-        brightness = constrain(brightness, 0, 255);
-        strip.setBrightness(brightness);
-
-    } else if (command.startsWith("GROUP:")) {
-        int newGroup = command.substring(6).toInt();
-        groupNumber = constrain(newGroup, 1, 5);
-        sendStatus("GROUP_CHANGED_TO_" + String(groupNumber));
-
-    } else if (command == "PING") {
-        sendStatus("PONG");
-
-    } else if (command == "sim") {
-        simulationMode = !simulationMode;
-        if (simulationMode) {
-            currentLEDMode = MODE_GSR_DOWNSTREAM;
-            sendStatus("SIMULATION_ON");
-        } else {
-            currentLEDMode = MODE_GSR_VISUALIZATION;
-            sendStatus("SIMULATION_OFF");
-        }
-
-    } else if (command.startsWith("{\"ema\":")) {
-        int startIdx = command.indexOf(':') + 1;
-        int endIdx = command.indexOf('}');
-        if (startIdx > 0 && endIdx > startIdx) {
-            String emaStr = command.substring(startIdx, endIdx);
-            simulatedEma = emaStr.toFloat();
-
-            if (simulationMode) {
-                currentLEDMode = MODE_GSR_DOWNSTREAM;
-            }
-        }
+// Call as often as possible from loop(): re-sends the current frame with
+// fresh dithering between new frames, up to the configured refresh rate
+void GSRVisualizer::refresh() {
+    if (refreshIntervalMicros == 0 || outputGain == 0) {
+        return;
+    }
+    if (micros() - lastRefreshMicros >= refreshIntervalMicros) {
+        pushFrame();
     }
 }
 
-void GSRVisualizer::parseColorCommand(String colorStr) {
-    int commaIndex1 = colorStr.indexOf(',');
-    int commaIndex2 = colorStr.lastIndexOf(',');
-
-    if (commaIndex1 > 0 && commaIndex2 > commaIndex1) {
-        int r = colorStr.substring(0, commaIndex1).toInt();
-        int g = colorStr.substring(commaIndex1 + 1, commaIndex2).toInt();
-        int b = colorStr.substring(commaIndex2 + 1).toInt();
-
-        solidColor = strip.Color(r, g, b);
+// Brightness is applied in 16 bits before dithering, so the strip itself
+// always runs at full scale. Checked every frame: strip.setBrightness() in
+// the sketch after the visualizer was created still takes effect.
+void GSRVisualizer::takeStripBrightness() {
+    uint8_t stripBrightness = strip.getBrightness();
+    if (stripBrightness != 255) {
+        brightness = stripBrightness;
+        strip.setBrightness(255);
     }
 }
 
+void GSRVisualizer::pushFrame() {
+    ledFrame.render(strip, outputGain);
+    unsigned long showStart = micros();
+    strip.show();
+    lastRefreshMicros = micros();
+    pipelineStats.showTook(lastRefreshMicros - showStart);
+}
+
 //━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
 //                         CONFIGURATION METHODS
 //━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
@@ -506,11 +360,25 @@ void GSRVisualizer::setExponentialAlpha(float newAlpha) {
 
 //──────── Hard Mode Configuration Methods ────────
 void GSRVisualizer::setLEDMode(LEDMode mode) {
-    currentLEDMode = mode;
+    // Modes left out of this build are ignored
+    int effect = findEffectByMode(mode);
+    if (effect >= 0) {
+        currentEffect = effect;
+    }
+}
+
+bool GSRVisualizer::setEffect(const char* token) {
+    int effect = findEffect(token);
+    if (effect < 0) {
+        return false;
+    }
+    currentEffect = effect;
+    return true;
 }
 
 void GSRVisualizer::setGroupNumber(int group) {
-    groupNumber = constrain(group, 1, 5);
+    // 0 = no group: updateLEDDisplay() falls back to deep pink
+    groupNumber = constrain(group, 0, GROUP_COUNT);
 }
 
 void GSRVisualizer::setSimulationMode(bool enabled) {
@@ -521,14 +389,64 @@ void GSRVisualizer::setSimulatedEma(float value) {
     simulatedEma = value;
 }
 
+void GSRVisualizer::setBrightness(uint8_t value) {
+    brightness = value;
+}
+
+void GSRVisualizer::setDithering(bool enabled) {
+    ledFrame.setDithering(enabled);
+}
+
+void GSRVisualizer::setRefreshRate(int hz) {
+    // Sending the strip takes ~30 µs per LED, so long strips refresh slower
+    // than asked: 20 LEDs manage well over 200 Hz, 300 LEDs about 100 Hz
+    refreshIntervalMicros = hz > 0 ? 1000000UL / hz : 0;
+}
+
+void GSRVisualizer::setPowerBudget(uint16_t milliamps) {
+    powerLimiter.setBudget(milliamps);
+}
+
+void GSRVisualizer::setLEDCurrentProfile(uint8_t milliampsPerChannel, uint8_t idleMilliamps) {
+    powerLimiter.setLEDProfile(milliampsPerChannel, idleMilliamps);
+}
+
+uint16_t GSRVisualizer::getEstimatedMilliamps() {
+    return powerLimiter.getEstimatedMilliamps();
+}
+
 LEDMode GSRVisualizer::getLEDMode() {
-    return currentLEDMode;
+    return effectMode(currentEffect);
+}
+
+const char* GSRVisualizer::getEffectToken() {
+    return kLEDEffects[currentEffect].token;
+}
+
+int GSRVisualizer::getGroupNumber() {
+    return groupNumber;
 }
 
 bool GSRVisualizer::isSimulationMode() {
     return simulationMode;
 }
 
+float GSRVisualizer::getSimulatedEma() {
+    return simulatedEma;
+}
+
+int GSRVisualizer::getNumLeds() {
+    return numLeds;
+}
+
+PipelineStats& GSRVisualizer::getStats() {
+    return pipelineStats;
+}
+
+Adafruit_NeoPixel& GSRVisualizer::getStrip() {
+    return strip;
+}
+
 /*
 ╚══════════════════════════════════════════════════════════════════════════╝
                       END OF HARD MODE IMPLEMENTATIONS
@@ -0,0 +1,346 @@
+/*
+╔══════════════════════════════════════════════════════════════════════════╗
+║                         GSR VISUALIZER LIBRARY                            ║
+║            Signal Processing, LED Effects & Web Serial                    ║
+╚══════════════════════════════════════════════════════════════════════════╝
+
+ One library for both sketches. 1_Hardware_Starter and 2_Hard_Mode include
+ it as <GSRVisualizer.h>; install it by copying or linking this folder into
+ your Arduino libraries folder (or set the sketchbook to Workshop1_HTPAAC).
+
+ FEATURE TIERS:
+ -------------
+ • basic        filtering, spike check, updateLEDDisplay(), animations
+ • web serial   telemetry, status and commands (WebSerialLink.h)
+ • effects      the LED effect registry and "LED:" commands (LEDEffects.h)
+ • simulation   "sim" and simulated {"ema":...} values from p5.js
+ A sketch picks its tiers with the first template argument of
+ FixedGSRVisualizer (GSRBasic, GSRWebSerial, GSRHardMode, or a struct of
+ its own). Tiers that are off add no member, no buffer and no reference
+ to their code, so the linker leaves them out: the starter build carries
+ no serial queue, telemetry, command parser or rainbow palette.
+
+ NO HEAP:
+ -------
+ The visualizer never calls new or builds a String. Every buffer it needs
+ (moving-average window, LED frame, serial rings) is part of
+ FixedGSRVisualizer<window, LEDs>, so its size is known when compiling
+ and it lives wherever the object lives. Boards that run for days can
+ fragment the heap with repeated small allocations until a larger one
+ fails; with no allocations there is nothing to fragment. heap_free and
+ heap_block in STATS should stay flat.
+*/
+
+#ifndef GSR_VISUALIZER_H
+#define GSR_VISUALIZER_H
+
+#include <Arduino.h>
+#include <Adafruit_NeoPixel.h>
+#include "PowerLimiter.h"
+#include "DitheredFrame.h"
+#include "PipelineStats.h"
+#include "WebSerialLink.h"
+
+//━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+//                           LED MODES
+//━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+
+enum LEDMode {
+  MODE_GSR_VISUALIZATION,   // Default GSR visualization
+  MODE_GSR_DOWNSTREAM,      // Downstream GSR visualization
+  MODE_SOLID_COLOR,          // Solid color
+  MODE_PULSE,                // Pulsing pattern
+  MODE_RAINBOW,              // Rainbow effect
+  MODE_OFF,                  // All LEDs off
+  MODE_CUSTOM                // An effect with no mode of its own (see getEffectToken())
+};
+
+//━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+//                         GROUP COLORS
+//━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+
+#define GROUP_COUNT 5
+
+struct GroupColor {
+  uint8_t r, g, b;
+};
+
+// 1=Red, 2=Green, 3=Blue, 4=Orange, 5=Purple (kept in flash); 0 = no group
+extern const GroupColor kGroupColors[GROUP_COUNT] PROGMEM;
+
+// Reads a group's color out of flash (0 and out-of-range groups get red)
+GroupColor getGroupColor(int group);
+
+//━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+//                            STORAGE
+//━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+
+// Where GSRVisualizer's arrays live (see FixedGSRVisualizer below)
+struct VisualizerBuffers {
+  int* readings;
+  int numReadings;
+  uint16_t* frameValues;
+  uint8_t* frameResiduals;
+  int maxLeds;
+};
+
+template <int WINDOW, int LEDS>
+struct VisualizerStorage {
+  int readings[WINDOW];
+  uint16_t frameValues[LEDS * 3];
+  uint8_t frameResiduals[LEDS * 3];
+
+  VisualizerBuffers buffers() {
+    VisualizerBuffers b = { readings, WINDOW, frameValues, frameResiduals, LEDS };
+    return b;
+  }
+};
+
+//━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+//                        MAIN CLASS
+//━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+
+class GSRVisualizer {
+  private:
+    Adafruit_NeoPixel& strip;
+    int numLeds;
+
+    //──────── Frame Output Variables ────────
+    DitheredFrame ledFrame;               // 16-bit frame, dithered on output
+    uint8_t brightness;                   // Applied in 16 bits, strip stays at 255
+    uint32_t outputGain;                  // Brightness × power limit for ledFrame
+    unsigned long refreshIntervalMicros;  // 0 = only show new frames
+    unsigned long lastRefreshMicros;
+
+    //──────── Signal Processing Variables ────────
+    int* readings;
+    int numReadings;
+    int readIndex;
+    int total;
+    float alpha;  // Exponential filter smoothing factor
+
+    //──────── Spike Detection Variables ────────
+    bool inSpike;
+    float spikeThreshold;
+    float lastFilteredValue;
+
+    //──────── Web Serial Animation Variables ────────
+    uint8_t currentEffect;  // Index into kLEDEffects (see LEDEffects.h)
+    int groupNumber;        // 0 = none (starter pink)
+
+    //──────── Advanced Processing Variables ────────
+    float adaptiveBaseline;
+    float adaptiveAlpha;
+    float normalizedEma;
+    float shortTermBaseline;
+
+    //──────── Simulation Variables ────────
+    bool simulationMode;
+    float simulatedEma;
+
+    //──────── Pipeline Statistics ────────
+    PipelineStats pipelineStats;
+
+    //──────── Power Budget ────────
+    PowerLimiter powerLimiter;
+
+    void takeStripBrightness();
+    void pushFrame();
+
+  public:
+    // Use FixedGSRVisualizer instead, it brings the buffers
+    GSRVisualizer(Adafruit_NeoPixel& ledStrip, const VisualizerBuffers& buffers);
+
+    //━━━━━━━━━ Signal Processing Methods ━━━━━━━━━
+    int calculateMovingAverage(int newReading);
+    float applyExponentialFilter(int newReading, float currentFiltered);
+    void checkForSpikes(float filteredValue);
+
+    //━━━━━━━━━ Advanced Processing Methods ━━━━━━━━━
+    void updateAdaptiveBaseline(float emaValue);
+    void resetAdaptiveBaseline(float emaValue);
+    float calculateNormalizedEma(float emaValue, int gsrMin, int gsrMax);
+    float getCombinedSignal(float emaValue, float emaDerivative, int gsrMin, int gsrMax);
+
+    //━━━━━━━━━ LED Visualization Methods ━━━━━━━━━
+    void updateLEDDisplay(float value, int gsrMin, int gsrMax);
+    uint32_t getColorForLevel(int ledIndex);
+    void updateLEDs(float emaValue, int gsrMin, int gsrMax, float emaDerivative);
+
+    //━━━━━━━━━ LED Animation Methods ━━━━━━━━━
+    void showCalibrationAnimation();
+    void flashSuccess();
+    void setAllPixels(int r, int g, int b);
+    void addBreathingEffect(int ledIndex);
+
+    //━━━━━━━━━ Frame Output (all effects draw through these) ━━━━━━━━━
+    // Once the visualizer exists it owns the strip: strip.setPixelColor()
+    // and strip.show() from the sketch bypass brightness and the power
+    // limit, so draw with these instead.
+    void beginFrame();
+    void setPixel(int ledIndex, uint8_t r, uint8_t g, uint8_t b);
+    void setPixel(int ledIndex, uint32_t color);
+    void setPixel16(int ledIndex, uint16_t r, uint16_t g, uint16_t b);
+    void showFrame();
+    void refresh();
+
+    /*
+    ╔════════════════════════════════════════════════════════════════╗
+    ║                    HARD MODE SPECIFIC METHODS                   ║
+    ╠════════════════════════════════════════════════════════════════╣
+    ║  Advanced LED animations live in LEDEffects.cpp and draw        ║
+    ║  through the frame output above (effects tier). Web Serial      ║
+    ║  lives in WebSerialLink.h                                       ║
+    ╚════════════════════════════════════════════════════════════════╝
+    */
+
+    //━━━━━━━━━ Hard Mode: Effect Selection ━━━━━━━━━
+    bool setEffect(const char* token);  // e.g. "RAINBOW"; false if not in this build
+    const char* getEffectToken();
+
+    //━━━━━━━━━ Configuration Methods ━━━━━━━━━
+    void setSpikeThreshold(float threshold);
+    void setExponentialAlpha(float newAlpha);
+    void setLEDMode(LEDMode mode);
+    void setGroupNumber(int group);
+    void setSimulationMode(bool enabled);
+    void setSimulatedEma(float value);
+    void setBrightness(uint8_t value);
+    void setDithering(bool enabled);
+    void setRefreshRate(int hz);
+    void setPowerBudget(uint16_t milliamps);
+    void setLEDCurrentProfile(uint8_t milliampsPerChannel, uint8_t idleMilliamps);
+    uint16_t getEstimatedMilliamps();
+    LEDMode getLEDMode();
+    int getGroupNumber();
+    bool isSimulationMode();
+    float getSimulatedEma();
+    int getNumLeds();
+    PipelineStats& getStats();
+    Adafruit_NeoPixel& getStrip();
+};
+
+//━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+//                          FEATURE TIERS
+//━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+// Basic is always built. Simulation steers the downstream effect from
+// serial input, so it needs the other two.
+
+struct GSRBasic {
+  static constexpr bool webSerial = false;
+  static constexpr bool effects = false;
+  static constexpr bool simulation = false;
+};
+
+struct GSRWebSerial {
+  static constexpr bool webSerial = true;
+  static constexpr bool effects = false;
+  static constexpr bool simulation = false;
+};
+
+struct GSRHardMode {
+  static constexpr bool webSerial = true;
+  static constexpr bool effects = true;
+  static constexpr bool simulation = true;
+};
+
+// "LED:<token>[:<args>]" (LEDEffects.cpp)
+extern const CommandExtension kEffectCommand;
+
+//──────── Tier Commands ────────
+// Only the enabled specialization names the tier's command table, so a
+// disabled tier leaves nothing for the linker to keep.
+
+template <bool ENABLED>
+struct EffectCommands {
+  static void install(WebSerialLink& link) {}
+};
+
+template <>
+struct EffectCommands<true> {
+  static void install(WebSerialLink& link) {
+    link.addCommand(kEffectCommand);
+  }
+};
+
+template <bool ENABLED>
+struct SimulationCommands {
+  static void install(WebSerialLink& link) {}
+};
+
+template <>
+struct SimulationCommands<true> {
+  static void install(WebSerialLink& link) {
+    for (int i = 0; i < SIMULATION_COMMAND_COUNT; i++) {
+      link.addCommand(kSimulationCommands[i]);
+    }
+  }
+};
+
+//──────── Web Serial Part ────────
+// Without web serial: an empty base (no bytes, no code)
+
+template <class Features, bool ENABLED = Features::webSerial>
+class WebSerialPart {
+  protected:
+    WebSerialPart(GSRVisualizer&) {}
+};
+
+template <class Features>
+class WebSerialPart<Features, true> : private WebSerialStorage, public WebSerialLink {
+  protected:
+    WebSerialPart(GSRVisualizer& visualizer)
+        : WebSerialLink(visualizer, *static_cast<WebSerialStorage*>(this)) {
+      EffectCommands<Features::effects>::install(*this);
+      SimulationCommands<Features::simulation>::install(*this);
+    }
+};
+
+//━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+//                     VISUALIZER WITH ITS BUFFERS
+//━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+// FEATURES = tier (see above), WINDOW = samples in the moving average,
+// LEDS = longest strip supported. The storage base comes first, so it
+// exists before GSRVisualizer uses it.
+//   static FixedGSRVisualizer<GSRBasic, 10, NUM_LEDS> visualizer(strip);
+
+template <class Features, int WINDOW, int LEDS>
+class FixedGSRVisualizer : private VisualizerStorage<WINDOW, LEDS>, public GSRVisualizer,
+                           public WebSerialPart<Features> {
+    static_assert(!Features::simulation || (Features::webSerial && Features::effects),
+                  "the simulation tier needs web serial and effects");
+
+  public:
+    FixedGSRVisualizer(Adafruit_NeoPixel& ledStrip)
+        : GSRVisualizer(ledStrip, VisualizerStorage<WINDOW, LEDS>::buffers()),
+          WebSerialPart<Features>(static_cast<GSRVisualizer&>(*this)) {
+    }
+
+    // The effect registry is linked only for tiers that ask for it
+    void updateLEDs(float emaValue, int gsrMin, int gsrMax, float emaDerivative) {
+      static_assert(Features::effects, "updateLEDs() needs a tier with effects (e.g. GSRHardMode)");
+      GSRVisualizer::updateLEDs(emaValue, gsrMin, gsrMax, emaDerivative);
+    }
+
+    void setLEDMode(LEDMode mode) {
+      static_assert(Features::effects, "setLEDMode() needs a tier with effects (e.g. GSRHardMode)");
+      GSRVisualizer::setLEDMode(mode);
+    }
+
+    LEDMode getLEDMode() {
+      static_assert(Features::effects, "getLEDMode() needs a tier with effects (e.g. GSRHardMode)");
+      return GSRVisualizer::getLEDMode();
+    }
+
+    bool setEffect(const char* token) {
+      static_assert(Features::effects, "setEffect() needs a tier with effects (e.g. GSRHardMode)");
+      return GSRVisualizer::setEffect(token);
+    }
+
+    const char* getEffectToken() {
+      static_assert(Features::effects, "getEffectToken() needs a tier with effects (e.g. GSRHardMode)");
+      return GSRVisualizer::getEffectToken();
+    }
+};
+
+#endif
@@ -0,0 +1,274 @@
+/*
+╔══════════════════════════════════════════════════════════════════════════╗
+║                    LED EFFECT REGISTRY IMPLEMENTATION                     ║
+╚══════════════════════════════════════════════════════════════════════════╝
+*/
+
+#include "LEDEffects.h"
+#include "LEDPalette.h"
+
+//━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+//                    GSR TRAIL (UPSTREAM / DOWNSTREAM)
+//━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+// A bright head with a fading trail runs along the strip; the GSR signal
+// sets its speed. Downstream runs the other way, and in simulation mode
+// takes its speed from the simulated value p5.js sends.
+
+static float trailPosition = 0;
+static unsigned long lastTrailTime = 0;
+static const int kTrailLength = 5;
+
+static void drawTrail(GSRVisualizer& v, bool downstream, const EffectFrame& f) {
+    int numLeds = v.getNumLeds();
+    float animationSpeed;
+
+    if (v.isSimulationMode() && downstream) {
+        animationSpeed = map(v.getSimulatedEma(), 0, 1023, 0.5, 8.0);
+    } else {
+        v.updateAdaptiveBaseline(f.emaValue);
+        v.calculateNormalizedEma(f.emaValue, f.gsrMin, f.gsrMax);
+        float amplifiedSignal = v.getCombinedSignal(f.emaValue, f.emaDerivative, f.gsrMin, f.gsrMax);
+        animationSpeed = 0.2 + amplifiedSignal * 7.8;
+    }
+
+    unsigned long currentTime = millis();
+    float deltaTime = (currentTime - lastTrailTime) / 1000.0;
+    lastTrailTime = currentTime;
+
+    if (downstream) {
+        trailPosition -= animationSpeed * deltaTime * 2;
+        if (trailPosition < -kTrailLength) {
+            trailPosition = numLeds + kTrailLength;
+        }
+    } else {
+        trailPosition += animationSpeed * deltaTime * 2;
+        if (trailPosition > numLeds + kTrailLength) {
+            trailPosition = -kTrailLength;
+        }
+    }
+
+    v.beginFrame();
+
+    GroupColor baseColor = getGroupColor(v.getGroupNumber());
+
+    for (int i = 0; i < numLeds; i++) {
+        float distance = downstream ? (i - trailPosition) : (trailPosition - i);
+
+        if (distance >= 0 && distance <= kTrailLength) {
+            float intensity = 1.0 - (distance / kTrailLength);
+            intensity = intensity * intensity;
+
+            uint16_t r = baseColor.r * intensity * 257;
+            uint16_t g = baseColor.g * intensity * 257;
+            uint16_t b = baseColor.b * intensity * 257;
+
+            v.setPixel16(i, r, g, b);
+        } else {
+            float glowIntensity = map(f.emaValue, f.gsrMin, f.gsrMax, 0.02, 0.15);
+
+            int r = baseColor.r * glowIntensity;
+            int g = baseColor.g * glowIntensity;
+            int b = baseColor.b * glowIntensity;
+
+            v.setPixel(i, r, g, b);
+        }
+    }
+
+    v.showFrame();
+}
+
+static void renderGSR(GSRVisualizer& v, const EffectFrame& f) {
+    drawTrail(v, false, f);
+}
+
+#if GSR_EFFECT_GSR_DOWNSTREAM
+static void renderGSRDownstream(GSRVisualizer& v, const EffectFrame& f) {
+    drawTrail(v, true, f);
+}
+#endif
+
+//━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+//                            SOLID COLOR
+//━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+
+#if GSR_EFFECT_SOLID_COLOR
+static uint32_t solidColor = 0;
+
+static void renderSolidColor(GSRVisualizer& v, const EffectFrame&) {
+    int numLeds = v.getNumLeds();
+    v.beginFrame();
+    for (int i = 0; i < numLeds; i++) {
+        v.setPixel(i, solidColor);
+    }
+    v.showFrame();
+}
+
+// "R,G,B" - needs both commas, like the old String version
+static void configureSolidColor(GSRVisualizer&, const char* args) {
+    if (args == nullptr) {
+        return;
+    }
+    char* end;
+    long r = strtol(args, &end, 10);
+    if (end == args || *end != ',') {
+        return;
+    }
+    const char* next = end + 1;
+    long g = strtol(next, &end, 10);
+    if (*end != ',') {
+        return;
+    }
+    long b = strtol(end + 1, &end, 10);
+
+    solidColor = Adafruit_NeoPixel::Color(r, g, b);
+}
+#endif
+
+//━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+//                               PULSE
+//━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+
+#if GSR_EFFECT_PULSE
+static void renderPulse(GSRVisualizer& v, const EffectFrame&) {
+    int numLeds = v.getNumLeds();
+    float pulse = (sin(millis() / 300.0) + 1.0) / 2.0;
+    int brightness = 20 + (200 * pulse);
+
+    v.beginFrame();
+    for (int i = 0; i < numLeds; i++) {
+        v.setPixel(i, brightness, brightness, brightness);
+    }
+    v.showFrame();
+}
+#endif
+
+//━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+//                              RAINBOW
+//━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+
+#if GSR_EFFECT_RAINBOW
+static void renderRainbow(GSRVisualizer& v, const EffectFrame&) {
+    static uint16_t hue = 0;
+    int numLeds = v.getNumLeds();
+
+    // One full color wheel across the strip, read from the precomputed
+    // gamma-corrected palette instead of ColorHSV + gamma32 per pixel.
+    // The step keeps 8 fraction bits so long strips still close the wheel.
+    uint32_t hueStep = (65536UL << 8) / numLeds;
+    uint32_t wheel = 0;
+
+    v.beginFrame();
+    for (int i = 0; i < numLeds; i++) {
+        v.setPixel(i, paletteColor(kRainbowPalette, hue + (uint16_t)(wheel >> 8)));
+        wheel += hueStep;
+    }
+
+    v.showFrame();
+    hue += 256;
+}
+#endif
+
+//━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+//                                OFF
+//━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+
+static void renderOff(GSRVisualizer& v, const EffectFrame&) {
+    v.beginFrame();
+    v.showFrame();
+}
+
+//━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+//                          EFFECT TABLE
+//━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+// Entry 0 is the power-on default.
+
+extern constexpr LEDEffect kLEDEffects[] = {
+    { "GSR",            "GSR",        renderGSR,           nullptr },
+#if GSR_EFFECT_GSR_DOWNSTREAM
+    { "GSR Downstream", "DOWNSTREAM", renderGSRDownstream, nullptr },
+#endif
+#if GSR_EFFECT_SOLID_COLOR
+    { "Solid Color",    "COLOR",      renderSolidColor,    configureSolidColor },
+#endif
+#if GSR_EFFECT_PULSE
+    { "Pulse",          "PULSE",      renderPulse,         nullptr },
+#endif
+#if GSR_EFFECT_RAINBOW
+    { "Rainbow",        "RAINBOW",    renderRainbow,       nullptr },
+#endif
+    { "Off",            "OFF",        renderOff,           nullptr },
+};
+
+extern constexpr uint8_t kLEDEffectCount = sizeof(kLEDEffects) / sizeof(kLEDEffects[0]);
+
+// Tokens of the effects that have an LEDMode, in enum order
+static const char* const kModeTokens[] = { "GSR", "DOWNSTREAM", "COLOR", "PULSE", "RAINBOW", "OFF" };
+
+//━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+//                          LOOKUP HELPERS
+//━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+
+int findEffect(const char* token) {
+    for (uint8_t i = 0; i < kLEDEffectCount; i++) {
+        if (strcmp(kLEDEffects[i].token, token) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+int findEffectByMode(LEDMode mode) {
+    if (mode < 0 || mode >= MODE_CUSTOM) {
+        return -1;
+    }
+    return findEffect(kModeTokens[mode]);
+}
+
+LEDMode effectMode(uint8_t effect) {
+    for (uint8_t mode = 0; mode < MODE_CUSTOM; mode++) {
+        if (strcmp(kLEDEffects[effect].token, kModeTokens[mode]) == 0) {
+            return (LEDMode)mode;
+        }
+    }
+    return MODE_CUSTOM;
+}
+
+// Matches "RAINBOW" as well as "COLOR:255,0,0" (args then points at "255,0,0")
+int findEffectByToken(const char* command, const char** args) {
+    for (uint8_t i = 0; i < kLEDEffectCount; i++) {
+        size_t len = strlen(kLEDEffects[i].token);
+        if (strncmp(command, kLEDEffects[i].token, len) != 0) {
+            continue;
+        }
+        if (command[len] == '\0') {
+            *args = nullptr;
+            return i;
+        }
+        if (command[len] == ':') {
+            *args = command + len + 1;
+            return i;
+        }
+    }
+    return -1;
+}
+
+//━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+//                       "LED:" COMMAND (EFFECTS TIER)
+//━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+// Added to the web serial link by visualizers whose tier has effects
+
+static void handleLEDCommand(WebSerialLink& link, const char* args) {
+    const char* effectArgs = nullptr;
+    int effect = findEffectByToken(args, &effectArgs);
+    if (effect < 0) {
+        return;
+    }
+
+    GSRVisualizer& visualizer = link.getVisualizer();
+    visualizer.setEffect(kLEDEffects[effect].token);
+    if (kLEDEffects[effect].configure != nullptr) {
+        kLEDEffects[effect].configure(visualizer, effectArgs);
+    }
+}
+
+const CommandExtension kEffectCommand = { "LED", handleLEDCommand };
@@ -0,0 +1,84 @@
+/*
+╔══════════════════════════════════════════════════════════════════════════╗
+║                         LED EFFECT REGISTRY                               ║
+║          One table: effect name → render function → command token         ║
+╚══════════════════════════════════════════════════════════════════════════╝
+
+ Every LED effect lives in LEDEffects.cpp: its render function, any state
+ it keeps, and a row in the kLEDEffects table. Effects are keyed by their
+ token. The visualizer stores an index into the table, so drawing a frame
+ is one indexed call and "LED:<token>" commands are a table lookup.
+
+ ADDING AN EFFECT:
+ ----------------
+ 1. Write a render function:  void renderMine(GSRVisualizer& v, const EffectFrame& f)
+    drawing with v.beginFrame() / v.setPixel() / v.showFrame()
+ 2. Add a row to kLEDEffects:  { "Mine", "MINE", renderMine, nullptr }
+ 3. Send "LED:MINE" from p5.js, or call setEffect("MINE") in the sketch
+ No changes to GSRVisualizer or the LEDMode enum are needed; getLEDMode()
+ reports such effects as MODE_CUSTOM.
+*/
+
+#ifndef LED_EFFECTS_H
+#define LED_EFFECTS_H
+
+#include "GSRVisualizer.h"
+
+//━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+//                      BUILD-TIME EFFECT SELECTION
+//━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+// Set any of these to 0 (here or with -D build flags) to leave the effect
+// out of the firmware. Nothing references its code any more, so the linker
+// drops it from flash. GSR visualization and OFF are always built.
+
+#ifndef GSR_EFFECT_GSR_DOWNSTREAM
+#define GSR_EFFECT_GSR_DOWNSTREAM 1
+#endif
+
+#ifndef GSR_EFFECT_SOLID_COLOR
+#define GSR_EFFECT_SOLID_COLOR 1
+#endif
+
+#ifndef GSR_EFFECT_PULSE
+#define GSR_EFFECT_PULSE 1
+#endif
+
+#ifndef GSR_EFFECT_RAINBOW
+#define GSR_EFFECT_RAINBOW 1
+#endif
+
+//━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+//                           EFFECT TYPES
+//━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+
+// Sensor state handed to every render function
+struct EffectFrame {
+  float emaValue;
+  int gsrMin;
+  int gsrMax;
+  float emaDerivative;
+};
+
+typedef void (*EffectRenderFn)(GSRVisualizer& visualizer, const EffectFrame& frame);
+typedef void (*EffectConfigFn)(GSRVisualizer& visualizer, const char* args);
+
+struct LEDEffect {
+  const char* name;          // Human readable name
+  const char* token;         // Key: "LED:<token>" and setEffect() (e.g. "RAINBOW")
+  EffectRenderFn render;     // Draws one frame
+  EffectConfigFn configure;  // Optional: handles "LED:<token>:<args>"
+};
+
+extern const LEDEffect kLEDEffects[];
+extern const uint8_t kLEDEffectCount;
+
+//━━━━━━━━━ Lookup Helpers ━━━━━━━━━
+// The find* helpers return -1 when the effect is not part of this build.
+int findEffect(const char* token);
+int findEffectByToken(const char* command, const char** args);
+
+// The built-in LEDModes map onto tokens; other effects are MODE_CUSTOM
+int findEffectByMode(LEDMode mode);
+LEDMode effectMode(uint8_t effect);
+
+#endif
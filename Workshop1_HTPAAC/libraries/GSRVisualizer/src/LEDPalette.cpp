@@ -0,0 +1,70 @@
+/*
+╔══════════════════════════════════════════════════════════════════════════╗
+║                    LED PALETTE ENGINE IMPLEMENTATION                      ║
+╚══════════════════════════════════════════════════════════════════════════╝
+*/
+
+#include "LEDPalette.h"
+
+//━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+//                          RAINBOW PALETTE
+//━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+// Generated offline with the same HSV math as Adafruit_NeoPixel::ColorHSV
+// and the same gamma 2.6 curve as Adafruit_NeoPixel::gamma8, so the
+// rainbow looks identical to the per-pixel version. Lives in flash.
+
+const PaletteRGB kRainbowPalette[256] PROGMEM = {
+    {255,  0,  0}, {255,  0,  0}, {255,  0,  0}, {255,  0,  0}, {255,  1,  0}, {255,  1,  0}, {255,  2,  0}, {255,  2,  0},
+    {255,  3,  0}, {255,  5,  0}, {255,  6,  0}, {255,  8,  0}, {255, 10,  0}, {255, 12,  0}, {255, 14,  0}, {255, 17,  0},
+    {255, 20,  0}, {255, 24,  0}, {255, 27,  0}, {255, 31,  0}, {255, 36,  0}, {255, 41,  0}, {255, 45,  0}, {255, 51,  0},
+    {255, 57,  0}, {255, 63,  0}, {255, 70,  0}, {255, 77,  0}, {255, 85,  0}, {255, 93,  0}, {255,102,  0}, {255,111,  0},
+    {255,120,  0}, {255,130,  0}, {255,141,  0}, {255,152,  0}, {255,164,  0}, {255,176,  0}, {255,188,  0}, {255,202,  0},
+    {255,215,  0}, {255,230,  0}, {255,245,  0}, {250,255,  0}, {235,255,  0}, {220,255,  0}, {206,255,  0}, {193,255,  0},
+    {180,255,  0}, {168,255,  0}, {156,255,  0}, {145,255,  0}, {134,255,  0}, {124,255,  0}, {114,255,  0}, {105,255,  0},
+    { 96,255,  0}, { 88,255,  0}, { 80,255,  0}, { 72,255,  0}, { 65,255,  0}, { 59,255,  0}, { 53,255,  0}, { 47,255,  0},
+    { 42,255,  0}, { 38,255,  0}, { 33,255,  0}, { 29,255,  0}, { 25,255,  0}, { 21,255,  0}, { 18,255,  0}, { 15,255,  0},
+    { 13,255,  0}, { 10,255,  0}, {  8,255,  0}, {  6,255,  0}, {  5,255,  0}, {  4,255,  0}, {  3,255,  0}, {  2,255,  0},
+    {  1,255,  0}, {  1,255,  0}, {  0,255,  0}, {  0,255,  0}, {  0,255,  0}, {  0,255,  0}, {  0,255,  0}, {  0,255,  0},
+    {  0,255,  0}, {  0,255,  0}, {  0,255,  1}, {  0,255,  1}, {  0,255,  2}, {  0,255,  3}, {  0,255,  4}, {  0,255,  5},
+    {  0,255,  7}, {  0,255,  9}, {  0,255, 11}, {  0,255, 13}, {  0,255, 16}, {  0,255, 19}, {  0,255, 22}, {  0,255, 26},
+    {  0,255, 30}, {  0,255, 34}, {  0,255, 39}, {  0,255, 43}, {  0,255, 49}, {  0,255, 55}, {  0,255, 61}, {  0,255, 68},
+    {  0,255, 75}, {  0,255, 82}, {  0,255, 90}, {  0,255, 99}, {  0,255,108}, {  0,255,117}, {  0,255,127}, {  0,255,137},
+    {  0,255,148}, {  0,255,160}, {  0,255,172}, {  0,255,184}, {  0,255,197}, {  0,255,211}, {  0,255,225}, {  0,255,240},
+    {  0,255,255}, {  0,240,255}, {  0,225,255}, {  0,211,255}, {  0,197,255}, {  0,184,255}, {  0,172,255}, {  0,160,255},
+    {  0,148,255}, {  0,137,255}, {  0,127,255}, {  0,117,255}, {  0,108,255}, {  0, 99,255}, {  0, 90,255}, {  0, 82,255},
+    {  0, 75,255}, {  0, 68,255}, {  0, 61,255}, {  0, 55,255}, {  0, 49,255}, {  0, 43,255}, {  0, 39,255}, {  0, 34,255},
+    {  0, 30,255}, {  0, 26,255}, {  0, 22,255}, {  0, 19,255}, {  0, 16,255}, {  0, 13,255}, {  0, 11,255}, {  0,  9,255},
+    {  0,  7,255}, {  0,  5,255}, {  0,  4,255}, {  0,  3,255}, {  0,  2,255}, {  0,  1,255}, {  0,  1,255}, {  0,  0,255},
+    {  0,  0,255}, {  0,  0,255}, {  0,  0,255}, {  0,  0,255}, {  0,  0,255}, {  0,  0,255}, {  0,  0,255}, {  1,  0,255},
+    {  1,  0,255}, {  2,  0,255}, {  3,  0,255}, {  4,  0,255}, {  5,  0,255}, {  6,  0,255}, {  8,  0,255}, { 10,  0,255},
+    { 13,  0,255}, { 15,  0,255}, { 18,  0,255}, { 21,  0,255}, { 25,  0,255}, { 29,  0,255}, { 33,  0,255}, { 38,  0,255},
+    { 42,  0,255}, { 47,  0,255}, { 53,  0,255}, { 59,  0,255}, { 65,  0,255}, { 72,  0,255}, { 80,  0,255}, { 88,  0,255},
+    { 96,  0,255}, {105,  0,255}, {114,  0,255}, {124,  0,255}, {134,  0,255}, {145,  0,255}, {156,  0,255}, {168,  0,255},
+    {180,  0,255}, {193,  0,255}, {206,  0,255}, {220,  0,255}, {235,  0,255}, {250,  0,255}, {255,  0,245}, {255,  0,230},
+    {255,  0,215}, {255,  0,202}, {255,  0,188}, {255,  0,176}, {255,  0,164}, {255,  0,152}, {255,  0,141}, {255,  0,130},
+    {255,  0,120}, {255,  0,111}, {255,  0,102}, {255,  0, 93}, {255,  0, 85}, {255,  0, 77}, {255,  0, 70}, {255,  0, 63},
+    {255,  0, 57}, {255,  0, 51}, {255,  0, 45}, {255,  0, 41}, {255,  0, 36}, {255,  0, 31}, {255,  0, 27}, {255,  0, 24},
+    {255,  0, 20}, {255,  0, 17}, {255,  0, 14}, {255,  0, 12}, {255,  0, 10}, {255,  0,  8}, {255,  0,  6}, {255,  0,  5},
+    {255,  0,  3}, {255,  0,  2}, {255,  0,  2}, {255,  0,  1}, {255,  0,  1}, {255,  0,  0}, {255,  0,  0}, {255,  0,  0}
+};
+
+//━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+//                          PALETTE LOOKUP
+//━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+
+static inline uint8_t blendChannel(uint8_t a, uint8_t b, uint8_t amount) {
+    return a + (((int16_t)b - a) * amount >> 8);
+}
+
+uint32_t paletteColor(const PaletteRGB* palette, uint16_t hue) {
+    uint8_t index = hue >> 8;
+    uint8_t amount = hue & 0xFF;
+    const PaletteRGB* a = &palette[index];
+    const PaletteRGB* b = &palette[(uint8_t)(index + 1)];  // Wraps 255 → 0
+
+    uint8_t r = blendChannel(pgm_read_byte(&a->r), pgm_read_byte(&b->r), amount);
+    uint8_t g = blendChannel(pgm_read_byte(&a->g), pgm_read_byte(&b->g), amount);
+    uint8_t bl = blendChannel(pgm_read_byte(&a->b), pgm_read_byte(&b->b), amount);
+
+    return ((uint32_t)r << 16) | ((uint32_t)g << 8) | bl;
+}
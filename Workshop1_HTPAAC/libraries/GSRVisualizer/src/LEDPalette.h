@@ -0,0 +1,32 @@
+/*
+╔══════════════════════════════════════════════════════════════════════════╗
+║                         LED PALETTE ENGINE                                ║
+║           Precomputed gamma-corrected colors for hue effects              ║
+╚══════════════════════════════════════════════════════════════════════════╝
+
+ Converting HSV and applying gamma for every pixel on every frame is the
+ most expensive part of the rainbow effect. A palette does that work once:
+ each entry already holds the gamma-corrected RGB color, so an effect only
+ looks up two neighbouring entries and blends them.
+
+ Hue is 8.8 fixed point, the same 0-65535 range as strip.ColorHSV():
+ • upper byte → palette entry (0-255)
+ • lower byte → blend amount towards the next entry (0-255)
+*/
+
+#ifndef LED_PALETTE_H
+#define LED_PALETTE_H
+
+#include <Arduino.h>
+
+struct PaletteRGB {
+  uint8_t r, g, b;
+};
+
+// Full-saturation rainbow: strip.gamma32(strip.ColorHSV(i * 256)) for i = 0..255
+extern const PaletteRGB kRainbowPalette[256] PROGMEM;
+
+// Blended palette lookup at an 8.8 fixed-point position (wraps at 65536)
+uint32_t paletteColor(const PaletteRGB* palette, uint16_t hue);
+
+#endif
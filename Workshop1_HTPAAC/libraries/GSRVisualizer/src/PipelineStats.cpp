@@ -0,0 +1,96 @@
+/*
+╔══════════════════════════════════════════════════════════════════════════╗
+║                   PIPELINE STATISTICS IMPLEMENTATION                      ║
+╚══════════════════════════════════════════════════════════════════════════╝
+*/
+
+#include "PipelineStats.h"
+
+PipelineStats::PipelineStats() {
+    reset();
+}
+
+void PipelineStats::reset() {
+    startMillis = millis();
+    lastLoopMicros = 0;
+    loops = 0;
+    loopMaxMicros = 0;
+    shows = 0;
+    showTotalMicros = 0;
+    showMaxMicros = 0;
+    bytesIn = 0;
+    adcOverruns = 0;
+}
+
+//━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+//                             RECORDING
+//━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+
+void PipelineStats::loopStarted() {
+    // loop() runs back to back, so start-to-start is the loop time
+    unsigned long now = micros();
+    if (lastLoopMicros != 0) {
+        uint32_t took = now - lastLoopMicros;
+        if (took > loopMaxMicros) {
+            loopMaxMicros = took;
+        }
+    }
+    lastLoopMicros = now;
+    loops++;
+}
+
+void PipelineStats::showTook(uint32_t micros) {
+    shows++;
+    showTotalMicros += micros;
+    if (micros > showMaxMicros) {
+        showMaxMicros = micros;
+    }
+}
+
+void PipelineStats::countBytesIn(uint32_t count) {
+    bytesIn += count;
+}
+
+void PipelineStats::countAdcOverruns(uint32_t missedSamples) {
+    adcOverruns += missedSamples;
+}
+
+//━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+//                              READING
+//━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+
+uint32_t PipelineStats::getElapsedMillis() {
+    return millis() - startMillis;
+}
+
+uint32_t PipelineStats::getLoops() {
+    return loops;
+}
+
+uint32_t PipelineStats::getLoopMeanMicros() {
+    return loops == 0 ? 0 : (uint64_t)getElapsedMillis() * 1000 / loops;
+}
+
+uint32_t PipelineStats::getLoopMaxMicros() {
+    return loopMaxMicros;
+}
+
+uint32_t PipelineStats::getShows() {
+    return shows;
+}
+
+uint32_t PipelineStats::getShowMeanMicros() {
+    return shows == 0 ? 0 : showTotalMicros / shows;
+}
+
+uint32_t PipelineStats::getShowMaxMicros() {
+    return showMaxMicros;
+}
+
+uint32_t PipelineStats::getBytesIn() {
+    return bytesIn;
+}
+
+uint32_t PipelineStats::getAdcOverruns() {
+    return adcOverruns;
+}
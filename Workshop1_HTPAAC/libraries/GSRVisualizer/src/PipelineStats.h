@@ -0,0 +1,58 @@
+/*
+╔══════════════════════════════════════════════════════════════════════════╗
+║                        PIPELINE STATISTICS                                ║
+║          What is the sketch actually doing? Ask it with STATS             ║
+╚══════════════════════════════════════════════════════════════════════════╝
+
+ Counts loop iterations, LED strip updates, serial traffic and missed
+ sensor samples. Every counter is an add or a compare, so this stays on
+ in normal use. STATS reports them, STATS:RESET starts a new window.
+
+ WHAT TO LOOK FOR:
+ ----------------
+ • loop_max_us above the 10 ms sample interval → something blocks loop()
+ • show_mean_us grows with the number of LEDs (~30 µs per LED)
+ • adc_overruns > 0 → sample slots were missed because loop() was late
+ • heap_block much smaller than heap_free → the heap is fragmented
+*/
+
+#ifndef PIPELINE_STATS_H
+#define PIPELINE_STATS_H
+
+#include <Arduino.h>
+
+class PipelineStats {
+  private:
+    unsigned long startMillis;
+    unsigned long lastLoopMicros;   // 0 = no loop seen since reset
+    uint32_t loops;
+    uint32_t loopMaxMicros;
+    uint32_t shows;
+    uint64_t showTotalMicros;
+    uint32_t showMaxMicros;
+    uint32_t bytesIn;
+    uint32_t adcOverruns;
+
+  public:
+    PipelineStats();
+    void reset();
+
+    //━━━━━━━━━ Recording (hot path) ━━━━━━━━━
+    void loopStarted();                 // Call first thing in loop()
+    void showTook(uint32_t micros);     // Time of one strip.show()
+    void countBytesIn(uint32_t count);
+    void countAdcOverruns(uint32_t missedSamples);
+
+    //━━━━━━━━━ Reading ━━━━━━━━━
+    uint32_t getElapsedMillis();
+    uint32_t getLoops();
+    uint32_t getLoopMeanMicros();
+    uint32_t getLoopMaxMicros();
+    uint32_t getShows();
+    uint32_t getShowMeanMicros();
+    uint32_t getShowMaxMicros();
+    uint32_t getBytesIn();
+    uint32_t getAdcOverruns();
+};
+
+#endif
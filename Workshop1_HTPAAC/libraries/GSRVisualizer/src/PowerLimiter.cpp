@@ -0,0 +1,76 @@
+/*
+╔══════════════════════════════════════════════════════════════════════════╗
+║                    LED POWER LIMITER IMPLEMENTATION                       ║
+╚══════════════════════════════════════════════════════════════════════════╝
+*/
+
+#include "PowerLimiter.h"
+
+PowerLimiter::PowerLimiter()
+    : budgetMilliamps(0), milliampsPerChannel(20), idleMilliamps(1),
+      scale(255), channelSum(0), estimatedMilliamps(0) {
+}
+
+//━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+//                           CONFIGURATION
+//━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+
+void PowerLimiter::setBudget(uint16_t milliamps) {
+    budgetMilliamps = milliamps;
+}
+
+void PowerLimiter::setLEDProfile(uint8_t channelMilliamps, uint8_t darkMilliamps) {
+    milliampsPerChannel = channelMilliamps;
+    idleMilliamps = darkMilliamps;
+}
+
+//━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+//                            PER-FRAME USE
+//━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+
+void PowerLimiter::beginFrame() {
+    channelSum = 0;
+}
+
+// Call once per pixel per frame
+void PowerLimiter::add(uint8_t r, uint8_t g, uint8_t b) {
+    channelSum += r + g + b;
+}
+
+// Returns the scale (255 = full) that keeps this frame inside the budget
+uint8_t PowerLimiter::endFrame(uint8_t brightness, uint16_t numLeds) {
+    // Current the frame would draw unscaled, after the strip brightness
+    uint32_t idle = (uint32_t)idleMilliamps * numLeds;
+    uint32_t channels = ((channelSum * (brightness + 1)) >> 8) * milliampsPerChannel / 255;
+
+    // Only lit channels can be scaled: a dark frame over budget (idle
+    // current alone above it) is shown as is
+    scale = 255;
+    if (budgetMilliamps > 0 && channels > 0 && idle + channels > budgetMilliamps) {
+        // The output gain is (scale + 1) / 256, so round down to match it
+        uint32_t available = budgetMilliamps > idle ? budgetMilliamps - idle : 0;
+        uint32_t fit = available * 256 / channels;
+        scale = fit > 0 ? fit - 1 : 0;
+    }
+
+    uint32_t drawn = idle + ((channels * (scale + 1)) >> 8);
+    estimatedMilliamps = min(drawn, (uint32_t)0xFFFF);
+
+    return scale;
+}
+
+//━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+//                              REPORTING
+//━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+
+uint16_t PowerLimiter::getBudget() {
+    return budgetMilliamps;
+}
+
+uint16_t PowerLimiter::getEstimatedMilliamps() {
+    return estimatedMilliamps;
+}
+
+uint8_t PowerLimiter::getScale() {
+    return scale;
+}
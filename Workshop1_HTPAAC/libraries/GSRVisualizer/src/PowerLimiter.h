@@ -0,0 +1,54 @@
+/*
+╔══════════════════════════════════════════════════════════════════════════╗
+║                         LED POWER LIMITER                                 ║
+║            Keeps the strip inside a current budget (milliamps)            ║
+╚══════════════════════════════════════════════════════════════════════════╝
+
+ A WS2812 LED draws about 20 mA per color channel at full value, so a long
+ strip showing white can pull more than a USB port delivers. The limiter
+ estimates the current while a frame is being drawn and scales the frame
+ down just enough to stay inside the budget.
+
+ HOW IT STAYS CHEAP:
+ ------------------
+ • add() is called once per pixel while the frame is composed and only
+   adds the pixel to a running sum.
+ • endFrame() turns the sum into milliamps and returns the scale that
+   keeps the frame inside the budget.
+ • The scale is folded into the gain of the output pass (DitheredFrame),
+   which runs anyway, so limiting never costs an extra pass over the strip.
+*/
+
+#ifndef POWER_LIMITER_H
+#define POWER_LIMITER_H
+
+#include <Arduino.h>
+
+class PowerLimiter {
+  private:
+    uint16_t budgetMilliamps;      // 0 = no limit
+    uint8_t milliampsPerChannel;   // Current of one channel at value 255
+    uint8_t idleMilliamps;         // Current of one dark LED
+    uint8_t scale;                 // Scale for the last frame (255 = none)
+    uint32_t channelSum;           // Sum of requested channel values this frame
+    uint16_t estimatedMilliamps;   // Estimate for the last shown frame
+
+  public:
+    PowerLimiter();
+
+    //━━━━━━━━━ Configuration ━━━━━━━━━
+    void setBudget(uint16_t milliamps);
+    void setLEDProfile(uint8_t milliampsPerChannel, uint8_t idleMilliamps);
+
+    //━━━━━━━━━ Per-Frame Use ━━━━━━━━━
+    void beginFrame();
+    void add(uint8_t r, uint8_t g, uint8_t b);
+    uint8_t endFrame(uint8_t brightness, uint16_t numLeds);
+
+    //━━━━━━━━━ Reporting ━━━━━━━━━
+    uint16_t getBudget();
+    uint16_t getEstimatedMilliamps();
+    uint8_t getScale();
+};
+
+#endif
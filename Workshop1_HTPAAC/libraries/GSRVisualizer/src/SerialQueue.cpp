@@ -0,0 +1,201 @@
+/*
+╔══════════════════════════════════════════════════════════════════════════╗
+║                 NON-BLOCKING SERIAL TX QUEUE IMPLEMENTATION               ║
+╚══════════════════════════════════════════════════════════════════════════╝
+*/
+
+#include "SerialQueue.h"
+
+//━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+//                            MESSAGE RING
+//━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+
+MessageRing::MessageRing(uint8_t* storage, size_t bytes)
+    : buffer(storage), capacity(bytes), head(0), used(0), sent(0) {
+}
+
+uint8_t MessageRing::byteAt(size_t offset) const {
+    return buffer[(head + offset) % capacity];
+}
+
+bool MessageRing::push(const uint8_t* data, size_t length) {
+    if (length == 0 || length > 0xFFFF || length + 2 > freeBytes()) {
+        return false;
+    }
+
+    size_t tail = (head + used) % capacity;
+    buffer[tail] = length & 0xFF;
+    buffer[(tail + 1) % capacity] = length >> 8;
+    for (size_t i = 0; i < length; i++) {
+        buffer[(tail + 2 + i) % capacity] = data[i];
+    }
+    used += length + 2;
+    return true;
+}
+
+size_t MessageRing::frontLength() const {
+    return used == 0 ? 0 : byteAt(0) | (byteAt(1) << 8);
+}
+
+// Returns the bytes written; the message leaves the ring once all are out
+size_t MessageRing::writeFront(Print& port) {
+    size_t length = frontLength();
+    int room = port.availableForWrite();
+    if (length == 0 || room <= 0) {
+        return 0;
+    }
+    size_t count = min(length - sent, (size_t)room);
+
+    // At most two pieces: up to the end of the buffer, then from the start
+    size_t start = (head + 2 + sent) % capacity;
+    size_t first = min(count, capacity - start);
+    size_t written = port.write(buffer + start, first);
+    if (written == first && first < count) {
+        written += port.write(buffer, count - first);
+    }
+
+    sent += written;
+    if (sent == length) {
+        removeFront();
+    }
+    return written;
+}
+
+size_t MessageRing::dropFront() {
+    size_t length = frontLength();
+    if (length == 0) {
+        return 0;
+    }
+    if (sent == 0) {
+        removeFront();
+        return length;
+    }
+
+    // The front is partly on the wire: drop the message behind it by
+    // moving the front record up over it
+    size_t frontRecord = length + 2;
+    if (used == frontRecord) {
+        return 0;
+    }
+    size_t nextLength = byteAt(frontRecord) | (byteAt(frontRecord + 1) << 8);
+    size_t gap = nextLength + 2;
+    for (size_t i = frontRecord; i-- > 0;) {
+        buffer[(head + gap + i) % capacity] = byteAt(i);
+    }
+    head = (head + gap) % capacity;
+    used -= gap;
+    return nextLength;
+}
+
+void MessageRing::removeFront() {
+    size_t length = frontLength();
+    head = (head + length + 2) % capacity;
+    used -= length + 2;
+    sent = 0;
+}
+
+void MessageRing::clear() {
+    head = 0;
+    used = 0;
+    sent = 0;
+}
+
+bool MessageRing::isEmpty() const {
+    return used == 0;
+}
+
+size_t MessageRing::freeBytes() const {
+    return capacity - used;
+}
+
+bool MessageRing::frontStarted() const {
+    return sent > 0;
+}
+
+//━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+//                             SERIAL QUEUE
+//━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+
+SerialQueue::SerialQueue(Print& serialPort, uint8_t* telemetryStorage, size_t telemetryBytes,
+                         uint8_t* statusStorage, size_t statusBytes)
+    : port(serialPort), statusRing(statusStorage, statusBytes),
+      telemetryRing(telemetryStorage, telemetryBytes),
+      droppedMessages(0), droppedBytes(0), refusedStatus(0), bytesSent(0) {
+}
+
+bool SerialQueue::sendStatus(const uint8_t* data, size_t length) {
+    if (!statusRing.push(data, length)) {
+        refusedStatus++;
+        return false;
+    }
+    return true;
+}
+
+void SerialQueue::sendTelemetry(const uint8_t* data, size_t length) {
+    // Oldest first: make room by dropping whole messages from the front
+    while (!telemetryRing.push(data, length)) {
+        size_t dropped = telemetryRing.dropFront();
+        if (dropped == 0) {
+            // Nothing left to drop (at most a message already going out)
+            // and the message still does not fit
+            droppedMessages++;
+            droppedBytes += length;
+            return;
+        }
+        droppedMessages++;
+        droppedBytes += dropped;
+    }
+}
+
+// A message already partly sent is kept and finished. Not counted as
+// dropped: the host asked for it, nothing was congested
+void SerialQueue::discardTelemetry() {
+    while (telemetryRing.dropFront() > 0) {
+    }
+}
+
+// Sends messages until the ring is empty or the port is full; false when
+// the port filled up first
+static bool drainRing(MessageRing& ring, Print& port, uint32_t& bytesSent) {
+    while (!ring.isEmpty()) {
+        size_t written = ring.writeFront(port);
+        bytesSent += written;
+        if (written == 0 || ring.frontStarted()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void SerialQueue::drain() {
+    // Finish a telemetry message that is partly out before any status, so
+    // the two never interleave on the wire
+    if (telemetryRing.frontStarted()) {
+        bytesSent += telemetryRing.writeFront(port);
+        if (telemetryRing.frontStarted()) {
+            return;
+        }
+    }
+
+    // Status first; stop as soon as the port is full instead of waiting
+    if (!drainRing(statusRing, port, bytesSent)) {
+        return;
+    }
+    drainRing(telemetryRing, port, bytesSent);
+}
+
+uint32_t SerialQueue::getDroppedMessages() {
+    return droppedMessages;
+}
+
+uint32_t SerialQueue::getDroppedBytes() {
+    return droppedBytes;
+}
+
+uint32_t SerialQueue::getRefusedStatus() {
+    return refusedStatus;
+}
+
+uint32_t SerialQueue::getBytesSent() {
+    return bytesSent;
+}
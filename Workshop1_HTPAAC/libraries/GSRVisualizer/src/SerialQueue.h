@@ -0,0 +1,100 @@
+/*
+╔══════════════════════════════════════════════════════════════════════════╗
+║                      NON-BLOCKING SERIAL TX QUEUE                         ║
+║          The sensor loop never waits for the computer to read             ║
+╚══════════════════════════════════════════════════════════════════════════╝
+
+ Serial.print() blocks once the USB/UART transmit buffer is full, e.g.
+ when the browser tab is busy or the port is open but nobody reads it.
+ Sampling and LED animation would freeze with it. Instead, every message
+ is copied into a ring buffer here and drain() hands Serial only as many
+ bytes as availableForWrite() says fit, so write() returns immediately.
+ A message longer than the port's TX buffer (AVR: 63 bytes, ESP32 UART:
+ 128, USB CDC: 256) goes out over several drain() calls; the next message
+ starts only once it is complete, so messages are never interleaved.
+
+ DROP POLICY:
+ -----------
+ • Telemetry: when its ring is full, the OLDEST telemetry messages are
+   dropped to make room. Fresh data matters more than old data, and the
+   sequence numbers in binary frames show the host where the gap is.
+ • Status: has its own ring and is sent first. It is never dropped to make
+   room for telemetry; only if the host stops reading long enough to fill
+   the whole status ring is a new status refused (and counted).
+ • A message already partly sent is never dropped, or the host would get
+   half a frame; the drop policy takes the next-oldest message instead.
+
+ Both rings use buffers handed in by the owner; the queue never allocates.
+*/
+
+#ifndef SERIAL_QUEUE_H
+#define SERIAL_QUEUE_H
+
+#include <Arduino.h>
+
+//━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+//                            MESSAGE RING
+//━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+// Byte ring of [length:2][bytes...] records, so whole messages can be
+// dropped. The front message can go out in pieces; sent counts its
+// bytes already written.
+
+class MessageRing {
+  private:
+    uint8_t* buffer;
+    size_t capacity;
+    size_t head;       // Oldest byte
+    size_t used;
+    size_t sent;       // Bytes of the front message already written
+
+    uint8_t byteAt(size_t offset) const;
+    void removeFront();
+
+  public:
+    MessageRing(uint8_t* storage, size_t bytes);
+
+    bool push(const uint8_t* data, size_t length);   // false if it does not fit
+    size_t frontLength() const;                      // 0 when empty
+    size_t writeFront(Print& port);                  // Sends what fits of the oldest message
+    size_t dropFront();                              // Oldest message not yet started; bytes dropped
+    void clear();
+
+    bool isEmpty() const;
+    bool frontStarted() const;                       // Front message partly written
+    size_t freeBytes() const;
+};
+
+//━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+//                             SERIAL QUEUE
+//━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+
+class SerialQueue {
+  private:
+    Print& port;
+    MessageRing statusRing;
+    MessageRing telemetryRing;
+
+    //──────── Counters ────────
+    uint32_t droppedMessages;   // Telemetry dropped by the drop policy
+    uint32_t droppedBytes;
+    uint32_t refusedStatus;     // Status messages that found the status ring full
+    uint32_t bytesSent;
+
+  public:
+    SerialQueue(Print& serialPort, uint8_t* telemetryStorage, size_t telemetryBytes,
+                uint8_t* statusStorage, size_t statusBytes);
+
+    bool sendStatus(const uint8_t* data, size_t length);
+    void sendTelemetry(const uint8_t* data, size_t length);
+    void discardTelemetry();    // e.g. when the telemetry format changes; not counted as dropped
+
+    // Call every loop(): writes as much as the port can take without blocking
+    void drain();
+
+    uint32_t getDroppedMessages();
+    uint32_t getDroppedBytes();
+    uint32_t getRefusedStatus();
+    uint32_t getBytesSent();
+};
+
+#endif
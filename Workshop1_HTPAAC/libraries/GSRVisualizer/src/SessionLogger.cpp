@@ -0,0 +1,358 @@
+/*
+╔══════════════════════════════════════════════════════════════════════════╗
+║                    SESSION LOGGER IMPLEMENTATION                          ║
+╚══════════════════════════════════════════════════════════════════════════╝
+*/
+
+#include "SessionLogger.h"
+#include "TelemetryCodec.h"   // crc16Ccitt
+#include <string.h>
+
+#if defined(ESP32)
+#include <Arduino.h>          // FreeRTOS
+#endif
+
+// head and overruns are written only by record(), tail only by service().
+// Acquire/release makes the record bytes visible before the index that
+// publishes them (matters on the dual-core ESP32-S3).
+template <typename T>
+static inline T loadAcquire(const T& value) {
+    return __atomic_load_n(&value, __ATOMIC_ACQUIRE);
+}
+
+template <typename T>
+static inline void storeRelease(T& value, T newValue) {
+    __atomic_store_n(&value, newValue, __ATOMIC_RELEASE);
+}
+
+static void putU16(uint8_t* out, uint16_t value) {
+    out[0] = value & 0xFF;
+    out[1] = value >> 8;
+}
+
+static void putU32(uint8_t* out, uint32_t value) {
+    for (int i = 0; i < 4; i++) {
+        out[i] = (value >> (8 * i)) & 0xFF;
+    }
+}
+
+static uint16_t getU16(const uint8_t* in) {
+    return in[0] | (in[1] << 8);
+}
+
+static uint32_t getU32(const uint8_t* in) {
+    return (uint32_t)in[0] | ((uint32_t)in[1] << 8) | ((uint32_t)in[2] << 16) | ((uint32_t)in[3] << 24);
+}
+
+//━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+//                            CONSTRUCTOR
+//━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+
+SessionLogger::SessionLogger(uint32_t requestedCapacity)
+    : capacity(1), head(0), tail(0), overruns(0),
+      mode(LOG_OFF), session(0), generation(0),
+      sink(nullptr), preSamples(0), postSamples(0),
+      seenGeneration(0), activeMode(LOG_OFF), activeSession(0),
+      activePre(0), activePost(0), scanned(0), captureEnd(0), capturing(false),
+      overrunsWritten(0), pageCount(0), pageFlags(0), pageLost(0), pageNumber(0),
+      pagesWritten(0), writeErrors(0) {
+
+    // Power of two, so free-running indices wrap with a mask
+    while (capacity < requestedCapacity) {
+        capacity <<= 1;
+    }
+    ring = new LogRecord[capacity];
+}
+
+SessionLogger::~SessionLogger() {
+    delete[] ring;
+}
+
+//━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+//                         PRODUCER (SAMPLING)
+//━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+
+bool SessionLogger::record(uint32_t timeMicros, uint16_t raw, float ema, bool trigger) {
+    if (mode == LOG_OFF) {
+        return true;
+    }
+
+    uint32_t index = head;
+    if (index - loadAcquire(tail) >= capacity) {
+        storeRelease(overruns, overruns + 1);
+        return false;
+    }
+
+    LogRecord& slot = ring[index & (capacity - 1)];
+    slot.timeMicros = timeMicros;
+    slot.raw = raw;
+    slot.flags = trigger ? LOG_RECORD_TRIGGER : 0;
+    slot.ema = ema;
+    storeRelease(head, index + 1);
+    return true;
+}
+
+//━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+//                              CONTROL
+//━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+// The writer picks these up on its next service() call, when it sees
+// generation change.
+
+void SessionLogger::setPreTrigger(uint32_t samplesBefore, uint32_t samplesAfter) {
+    preSamples = samplesBefore < capacity / 2 ? samplesBefore : capacity / 2;
+    postSamples = samplesAfter;
+}
+
+void SessionLogger::start(LogMode logMode, uint16_t sessionId) {
+    mode = logMode;
+    session = sessionId;
+    storeRelease(generation, generation + 1);
+}
+
+void SessionLogger::stop() {
+    mode = LOG_OFF;
+    storeRelease(generation, generation + 1);
+}
+
+LogMode SessionLogger::getMode() {
+    return (LogMode)mode;
+}
+
+void SessionLogger::setSink(LogSink* destination) {
+    sink = destination;
+}
+
+//━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+//                         CONSUMER (WRITER)
+//━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+
+void SessionLogger::addToPage(const LogRecord& record) {
+    if (pageCount == 0) {
+        // Samples lost since the last page are reported in this one
+        uint32_t lost = loadAcquire(overruns) - overrunsWritten;
+        overrunsWritten += lost;
+        pageLost = lost > 0xFFFF ? 0xFFFF : lost;
+        pageFlags = pageLost > 0 ? LOG_PAGE_GAP : 0;
+    }
+
+    uint8_t* out = page + LOG_PAGE_HEADER + pageCount * LOG_RECORD_SIZE;
+    putU32(out, record.timeMicros);
+    putU16(out + 4, record.raw);
+    putU16(out + 6, record.flags);
+    memcpy(out + 8, &record.ema, 4);
+    if (record.flags & LOG_RECORD_TRIGGER) {
+        pageFlags |= LOG_PAGE_TRIGGER;
+    }
+
+    if (++pageCount == LOG_RECORDS_PER_PAGE) {
+        writePage();
+    }
+}
+
+void SessionLogger::writePage() {
+    if (pageCount == 0) {
+        return;
+    }
+
+    putU32(page, LOG_PAGE_MAGIC);
+    putU16(page + 4, activeSession);
+    putU16(page + 6, pageNumber);
+    page[8] = pageCount;
+    page[9] = pageFlags;
+    putU16(page + 10, pageLost);
+    size_t used = LOG_PAGE_HEADER + pageCount * LOG_RECORD_SIZE;
+    memset(page + used, 0, LOG_PAGE_SIZE - 2 - used);
+    putU16(page + LOG_PAGE_SIZE - 2, crc16Ccitt(page, LOG_PAGE_SIZE - 2));
+
+    if (sink != nullptr && sink->append(page, LOG_PAGE_SIZE)) {
+        pagesWritten++;
+    } else {
+        // Flash full or card pulled: stop rather than retry forever
+        writeErrors++;
+        activeMode = LOG_OFF;
+    }
+    pageNumber++;
+    pageCount = 0;
+}
+
+bool SessionLogger::service() {
+    bool worked = false;
+    uint32_t newHead = loadAcquire(head);
+
+    //──────── Start / Stop ────────
+    uint32_t currentGeneration = loadAcquire(generation);
+    if (currentGeneration != seenGeneration) {
+        // Finish the old session with what it already recorded
+        if (activeMode == LOG_CONTINUOUS || capturing) {
+            uint32_t end = capturing && (int32_t)(captureEnd - newHead) < 0 ? captureEnd : newHead;
+            while (activeMode != LOG_OFF && tail != end) {
+                addToPage(ring[tail & (capacity - 1)]);
+                storeRelease(tail, tail + 1);
+            }
+        }
+        writePage();
+        if (sink != nullptr && activeMode != LOG_OFF) {
+            sink->sync();
+        }
+
+        seenGeneration = currentGeneration;
+        activeMode = mode;
+        activeSession = session;
+        activePre = preSamples;
+        activePost = postSamples;
+        pageNumber = 0;
+        pageCount = 0;
+        capturing = false;
+        scanned = tail;
+        overrunsWritten = loadAcquire(overruns);
+        worked = true;
+    }
+
+    if (activeMode == LOG_OFF || sink == nullptr) {
+        // Nothing to write to: free the ring so record() never fills it
+        if (tail != newHead) {
+            storeRelease(tail, newHead);
+        }
+        return worked;
+    }
+
+    //──────── Triggered: find new SCRs, trim the pre-trigger window ────────
+    uint32_t end = newHead;
+    if (activeMode == LOG_TRIGGERED) {
+        for (; scanned != newHead; scanned++) {
+            if (ring[scanned & (capacity - 1)].flags & LOG_RECORD_TRIGGER) {
+                // The ring may hold more than the window if we slept a while
+                if (!capturing && scanned - tail > activePre) {
+                    storeRelease(tail, scanned - activePre);
+                }
+                capturing = true;
+                captureEnd = scanned + 1 + activePost;
+            }
+        }
+
+        if (!capturing) {
+            if (newHead - tail > activePre) {
+                storeRelease(tail, newHead - activePre);
+            }
+            return worked;
+        }
+        if ((int32_t)(captureEnd - newHead) < 0) {
+            end = captureEnd;
+        }
+    }
+
+    //──────── Pages ────────
+    // At most one page per call, so a stop() is noticed quickly
+    uint32_t pagesBefore = pageNumber;
+    while (tail != end && pageNumber == pagesBefore && activeMode != LOG_OFF) {
+        addToPage(ring[tail & (capacity - 1)]);
+        storeRelease(tail, tail + 1);
+        worked = true;
+    }
+
+    if (capturing && tail == captureEnd) {
+        // Capture complete: make it durable now, not when the next one starts
+        capturing = false;
+        writePage();
+        sink->sync();
+        worked = true;
+    }
+    return worked;
+}
+
+//━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+//                              COUNTERS
+//━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+
+uint32_t SessionLogger::getOverruns() {
+    return loadAcquire(overruns);
+}
+
+uint32_t SessionLogger::getPagesWritten() {
+    return pagesWritten;
+}
+
+uint32_t SessionLogger::getWriteErrors() {
+    return writeErrors;
+}
+
+uint32_t SessionLogger::getQueued() {
+    return loadAcquire(head) - loadAcquire(tail);
+}
+
+//━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+//                              DECODING
+//━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+
+bool readLogPage(const uint8_t* page, LogPageInfo& info) {
+    if (getU32(page) != LOG_PAGE_MAGIC) {
+        return false;
+    }
+    if (crc16Ccitt(page, LOG_PAGE_SIZE - 2) != getU16(page + LOG_PAGE_SIZE - 2)) {
+        return false;
+    }
+
+    info.session = getU16(page + 4);
+    info.page = getU16(page + 6);
+    info.count = page[8];
+    info.flags = page[9];
+    info.lost = getU16(page + 10);
+    return info.count <= LOG_RECORDS_PER_PAGE;
+}
+
+void readLogRecord(const uint8_t* page, uint8_t index, LogRecord& record) {
+    const uint8_t* in = page + LOG_PAGE_HEADER + index * LOG_RECORD_SIZE;
+    record.timeMicros = getU32(in);
+    record.raw = getU16(in + 4);
+    record.flags = getU16(in + 6);
+    memcpy(&record.ema, in + 8, 4);
+}
+
+//━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+//                         ESP32: TASK AND FILE
+//━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+
+#if defined(ESP32)
+
+static void writerTask(void* parameter) {
+    SessionLogger* logger = (SessionLogger*)parameter;
+    for (;;) {
+        if (!logger->service()) {
+            vTaskDelay(pdMS_TO_TICKS(20));   // ~2 samples at 100 Hz
+        }
+    }
+}
+
+bool SessionLogger::startWriterTask(int priority, int core) {
+    return xTaskCreatePinnedToCore(writerTask, "gsr_log", 4096, this, priority, nullptr, core) == pdPASS;
+}
+
+FileLogSink::FileLogSink(fs::FS& fs, const char* filePath)
+    : filesystem(fs), path(filePath), pagesSinceSync(0) {
+}
+
+bool FileLogSink::append(const uint8_t* data, size_t length) {
+    if (!file) {
+        file = filesystem.open(path, FILE_APPEND);
+        if (!file) {
+            return false;
+        }
+    }
+    if (file.write(data, length) != length) {
+        return false;
+    }
+    // Bound what a power loss can take without syncing every page
+    if (++pagesSinceSync >= 8) {
+        sync();
+    }
+    return true;
+}
+
+void FileLogSink::sync() {
+    if (file) {
+        file.flush();
+    }
+    pagesSinceSync = 0;
+}
+
+#endif
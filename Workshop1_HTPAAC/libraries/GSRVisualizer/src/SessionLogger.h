@@ -0,0 +1,197 @@
+/*
+╔══════════════════════════════════════════════════════════════════════════╗
+║                          SESSION LOGGER                                   ║
+║      Keeps the session on flash/SD, even when the computer goes away      ║
+╚══════════════════════════════════════════════════════════════════════════╝
+
+ loop() hands every sample to record(), which copies 12 bytes into a RAM
+ ring and returns. A separate low-priority writer (a FreeRTOS task on
+ ESP32) takes samples out of the ring, packs them into 512-byte pages and
+ appends whole pages to a file. Flash writes can stall for tens of
+ milliseconds; only the writer waits for them, never sampling.
+
+ The ring has exactly one producer (record) and one consumer (service),
+ each owning one index, so no lock is needed. When the ring is full the
+ NEW sample is dropped and counted; the next page written says how many
+ were lost, so gaps are visible in the file.
+
+ MODES:
+ -----
+ • LOG_CONTINUOUS: every sample goes to the file
+ • LOG_TRIGGERED: the ring keeps the last preSamples in RAM. When a
+   sample is recorded with trigger = true (an SCR was detected), those
+   earlier samples, the trigger and postSamples after it are written.
+   Triggers during a capture extend it.
+
+ FILE FORMAT (append-only, little-endian):
+ ----------------------------------------
+   page = [magic "GSRL":4] [session:2] [page:2] [count:1] [flags:1]
+          [lost:2] [count × record:12] [zero padding] [crc16:2]   512 bytes
+   record = time_us:u32 raw:u16 flags:u16 ema:f32
+ The CRC (same CCITT CRC as TelemetryCodec) covers the first 510 bytes.
+ A page cut short by a power loss fails its CRC and is skipped; every
+ page before it is still good. Pages of one session share a session id
+ and count up from 0. A partial page (count < 41) is written when a
+ capture ends or logging stops.
+
+ Decode files on a computer with host_tools/logger_flashsim --decode.
+*/
+
+#ifndef SESSION_LOGGER_H
+#define SESSION_LOGGER_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#if defined(ESP32)
+#include <FS.h>
+#endif
+
+#define LOG_PAGE_SIZE 512
+#define LOG_PAGE_HEADER 12
+#define LOG_RECORD_SIZE 12
+#define LOG_RECORDS_PER_PAGE ((LOG_PAGE_SIZE - LOG_PAGE_HEADER - 2) / LOG_RECORD_SIZE)
+#define LOG_PAGE_MAGIC 0x4C525347UL   // "GSRL"
+
+//──────── Flags ────────
+#define LOG_RECORD_TRIGGER 0x0001     // record: an SCR was detected here
+#define LOG_PAGE_TRIGGER 0x01         // page: contains a trigger record
+#define LOG_PAGE_GAP 0x02             // page: samples are missing before it
+
+enum LogMode {
+  LOG_OFF,
+  LOG_CONTINUOUS,
+  LOG_TRIGGERED
+};
+
+struct LogRecord {
+  uint32_t timeMicros;
+  uint16_t raw;
+  uint16_t flags;
+  float ema;
+};
+
+//━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+//                            WHERE PAGES GO
+//━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+// A file on LittleFS or SD on the board, a plain file on a computer.
+
+class LogSink {
+  public:
+    virtual ~LogSink() {}
+    virtual bool append(const uint8_t* page, size_t length) = 0;   // false = full/failed
+    virtual void sync() {}                                         // Push to the medium
+};
+
+//━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+//                            SESSION LOGGER
+//━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+
+class SessionLogger {
+  private:
+    //──────── Ring (record() writes head, service() writes tail) ────────
+    LogRecord* ring;
+    uint32_t capacity;            // Power of two
+    uint32_t head;                // Next slot record() fills
+    uint32_t tail;                // Next slot service() reads
+    uint32_t overruns;            // Samples record() had to drop
+
+    //──────── Control (written by start/stop, read by service) ────────
+    uint8_t mode;                 // LogMode
+    uint16_t session;
+    uint32_t generation;          // Bumped by every start/stop
+    LogSink* sink;
+    uint32_t preSamples;
+    uint32_t postSamples;
+
+    //──────── Writer State (service() only) ────────
+    uint32_t seenGeneration;
+    uint8_t activeMode;
+    uint16_t activeSession;
+    uint32_t activePre;
+    uint32_t activePost;
+    uint32_t scanned;             // Ring index checked for triggers so far
+    uint32_t captureEnd;          // Ring index where the capture stops
+    bool capturing;
+    uint32_t overrunsWritten;     // overruns already reported in a page
+    uint8_t page[LOG_PAGE_SIZE];
+    uint8_t pageCount;
+    uint8_t pageFlags;
+    uint16_t pageLost;
+    uint16_t pageNumber;
+    uint32_t pagesWritten;
+    uint32_t writeErrors;
+
+    void addToPage(const LogRecord& record);
+    void writePage();
+
+  public:
+    // capacity is rounded up to a power of two; it must be larger than
+    // preSamples plus what arrives during the slowest flash write
+    SessionLogger(uint32_t capacity);
+    ~SessionLogger();
+
+    //━━━━━━━━━ Producer (loop) ━━━━━━━━━
+    // Never blocks. Returns false if the ring was full and the sample dropped.
+    bool record(uint32_t timeMicros, uint16_t raw, float ema, bool trigger);
+
+    //━━━━━━━━━ Control (loop) ━━━━━━━━━
+    void setPreTrigger(uint32_t samplesBefore, uint32_t samplesAfter);   // Before start()
+    void start(LogMode logMode, uint16_t sessionId);
+    void stop();                  // The writer flushes and closes the session
+    LogMode getMode();
+
+    //━━━━━━━━━ Consumer (writer task) ━━━━━━━━━
+    // Moves samples from the ring to pages. Returns true if it did work,
+    // false if there was nothing to do (the caller can sleep a little).
+    bool service();
+    void setSink(LogSink* destination);   // Before the writer runs
+
+    //━━━━━━━━━ Counters ━━━━━━━━━
+    uint32_t getOverruns();
+    uint32_t getPagesWritten();
+    uint32_t getWriteErrors();
+    uint32_t getQueued();         // Samples waiting in the ring
+
+#if defined(ESP32)
+    // Runs service() in its own low-priority task, forever
+    bool startWriterTask(int priority = 1, int core = 0);
+#endif
+};
+
+//━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+//                        DECODING (host and board)
+//━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+
+struct LogPageInfo {
+  uint16_t session;
+  uint16_t page;
+  uint8_t count;
+  uint8_t flags;
+  uint16_t lost;
+};
+
+// Checks magic and CRC. Returns false for torn or foreign pages.
+bool readLogPage(const uint8_t* page, LogPageInfo& info);
+void readLogRecord(const uint8_t* page, uint8_t index, LogRecord& record);
+
+//━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+//                     FILE SINK (LittleFS or SD, ESP32)
+//━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+
+#if defined(ESP32)
+class FileLogSink : public LogSink {
+  private:
+    fs::FS& filesystem;
+    const char* path;
+    fs::File file;
+    uint32_t pagesSinceSync;
+
+  public:
+    FileLogSink(fs::FS& fs, const char* filePath);
+    bool append(const uint8_t* page, size_t length);
+    void sync();
+};
+#endif
+
+#endif
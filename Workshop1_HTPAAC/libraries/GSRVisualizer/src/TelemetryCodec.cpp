@@ -0,0 +1,415 @@
+/*
+╔══════════════════════════════════════════════════════════════════════════╗
+║               BINARY TELEMETRY FRAME CODEC IMPLEMENTATION                 ║
+╚══════════════════════════════════════════════════════════════════════════╝
+*/
+
+#include "TelemetryCodec.h"
+#include <string.h>
+
+//━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+//                               CRC-16
+//━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+// CCITT polynomial 0x1021, bitwise: no table, frames are only ~25 bytes
+
+uint16_t crc16Ccitt(const uint8_t* data, size_t length, uint16_t crc) {
+    for (size_t i = 0; i < length; i++) {
+        crc ^= (uint16_t)data[i] << 8;
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+        }
+    }
+    return crc;
+}
+
+//━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+//                                 COBS
+//━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+// Consistent Overhead Byte Stuffing: each block starts with a code byte
+// giving the distance to the next zero, so the output contains no zeros.
+
+size_t cobsEncode(const uint8_t* in, size_t length, uint8_t* out) {
+    size_t write = 1;
+    size_t codeIndex = 0;
+    uint8_t code = 1;
+
+    for (size_t i = 0; i < length; i++) {
+        if (in[i] == 0) {
+            out[codeIndex] = code;
+            codeIndex = write++;
+            code = 1;
+        } else {
+            out[write++] = in[i];
+            code++;
+            if (code == 0xFF) {
+                out[codeIndex] = code;
+                codeIndex = write++;
+                code = 1;
+            }
+        }
+    }
+    out[codeIndex] = code;
+    return write;
+}
+
+size_t cobsDecode(const uint8_t* in, size_t length, uint8_t* out) {
+    size_t read = 0;
+    size_t write = 0;
+
+    while (read < length) {
+        uint8_t code = in[read++];
+        if (code == 0 || read + code - 1 > length) {
+            return 0;
+        }
+        for (uint8_t i = 1; i < code; i++) {
+            out[write++] = in[read++];
+        }
+        if (code < 0xFF && read < length) {
+            out[write++] = 0;
+        }
+    }
+    return write;
+}
+
+//━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+//                               FRAMES
+//━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+
+size_t encodeFrame(uint8_t type, const uint8_t* payload, size_t length, uint8_t* out) {
+    if (length > TELEMETRY_MAX_PAYLOAD) {
+        return 0;
+    }
+
+    uint8_t raw[TELEMETRY_MAX_PAYLOAD + 3];
+    raw[0] = type;
+    memcpy(raw + 1, payload, length);
+    uint16_t crc = crc16Ccitt(raw, length + 1);
+    raw[length + 1] = crc & 0xFF;
+    raw[length + 2] = crc >> 8;
+
+    size_t written = cobsEncode(raw, length + 3, out);
+    out[written++] = 0x00;
+    return written;
+}
+
+size_t decodeFrame(uint8_t* frame, size_t length) {
+    size_t decoded = cobsDecode(frame, length, frame);
+    if (decoded < 3) {
+        return 0;
+    }
+
+    size_t body = decoded - 2;
+    uint16_t crc = frame[body] | (frame[body + 1] << 8);
+    if (crc16Ccitt(frame, body) != crc) {
+        return 0;
+    }
+    return body;
+}
+
+//━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+//                            SAMPLE RECORD
+//━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+
+static uint8_t* putU16(uint8_t* p, uint16_t v) {
+    p[0] = v & 0xFF;
+    p[1] = v >> 8;
+    return p + 2;
+}
+
+static uint8_t* putU32(uint8_t* p, uint32_t v) {
+    for (int i = 0; i < 4; i++) {
+        p[i] = (v >> (8 * i)) & 0xFF;
+    }
+    return p + 4;
+}
+
+static uint8_t* putF32(uint8_t* p, float v) {
+    uint32_t bits;
+    memcpy(&bits, &v, sizeof(bits));
+    return putU32(p, bits);
+}
+
+static uint16_t getU16(const uint8_t* p) {
+    return p[0] | (p[1] << 8);
+}
+
+static uint32_t getU32(const uint8_t* p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static float getF32(const uint8_t* p) {
+    uint32_t bits = getU32(p);
+    float v;
+    memcpy(&v, &bits, sizeof(v));
+    return v;
+}
+
+size_t packSample(const TelemetrySample& sample, uint8_t* out) {
+    uint8_t* p = out;
+    p = putU16(p, sample.sequence);
+    p = putU32(p, sample.timeMicros);
+    p = putU16(p, sample.raw);
+    p = putF32(p, sample.ema);
+    p = putF32(p, sample.derivative);
+    p = putF32(p, sample.baseline);
+    return p - out;
+}
+
+bool unpackSample(const uint8_t* payload, size_t length, TelemetrySample& sample) {
+    if (length < TELEMETRY_SAMPLE_PAYLOAD) {
+        return false;
+    }
+    sample.sequence = getU16(payload);
+    sample.timeMicros = getU32(payload + 2);
+    sample.raw = getU16(payload + 6);
+    sample.ema = getF32(payload + 8);
+    sample.derivative = getF32(payload + 12);
+    sample.baseline = getF32(payload + 16);
+    return true;
+}
+
+size_t packSampleFields(const TelemetrySample& sample, uint8_t fields, uint8_t* out) {
+    uint8_t* p = out;
+    p = putU16(p, sample.sequence);
+    p = putU32(p, sample.timeMicros);
+    *p++ = fields & FIELDS_ALL;
+    if (fields & FIELD_RAW) {
+        p = putU16(p, sample.raw);
+    }
+    if (fields & FIELD_EMA) {
+        p = putF32(p, sample.ema);
+    }
+    if (fields & FIELD_DERIVATIVE) {
+        p = putF32(p, sample.derivative);
+    }
+    if (fields & FIELD_BASELINE) {
+        p = putF32(p, sample.baseline);
+    }
+    return p - out;
+}
+
+bool unpackSampleFields(const uint8_t* payload, size_t length, TelemetrySample& sample, uint8_t& fields) {
+    if (length < 7) {
+        return false;
+    }
+    fields = payload[6];
+    size_t expected = 7 + ((fields & FIELD_RAW) ? 2 : 0) + ((fields & FIELD_EMA) ? 4 : 0) +
+                      ((fields & FIELD_DERIVATIVE) ? 4 : 0) + ((fields & FIELD_BASELINE) ? 4 : 0);
+    if (length < expected) {
+        return false;
+    }
+
+    sample.sequence = getU16(payload);
+    sample.timeMicros = getU32(payload + 2);
+    const uint8_t* p = payload + 7;
+    if (fields & FIELD_RAW) {
+        sample.raw = getU16(p);
+        p += 2;
+    }
+    if (fields & FIELD_EMA) {
+        sample.ema = getF32(p);
+        p += 4;
+    }
+    if (fields & FIELD_DERIVATIVE) {
+        sample.derivative = getF32(p);
+        p += 4;
+    }
+    if (fields & FIELD_BASELINE) {
+        sample.baseline = getF32(p);
+    }
+    return true;
+}
+
+size_t packSyncReply(const SyncReply& reply, uint8_t* out) {
+    uint8_t* p = out;
+    p = putU32(p, (uint32_t)reply.hostTime);
+    p = putU32(p, (uint32_t)(reply.hostTime >> 32));
+    p = putU32(p, reply.deviceRxMicros);
+    p = putU32(p, reply.deviceTxMicros);
+    return p - out;
+}
+
+bool unpackSyncReply(const uint8_t* payload, size_t length, SyncReply& reply) {
+    if (length < TELEMETRY_SYNC_PAYLOAD) {
+        return false;
+    }
+    reply.hostTime = getU32(payload) | ((uint64_t)getU32(payload + 4) << 32);
+    reply.deviceRxMicros = getU32(payload + 8);
+    reply.deviceTxMicros = getU32(payload + 12);
+    return true;
+}
+
+size_t packStatsReport(const StatsReport& report, uint8_t* out) {
+    const uint32_t values[] = {
+        report.elapsedMillis, report.loops, report.loopMaxMicros, report.shows,
+        report.showMeanMicros, report.showMaxMicros, report.bytesIn, report.bytesOut,
+        report.droppedBytes, report.adcOverruns, report.freeHeap, report.largestFreeBlock
+    };
+    uint8_t* p = out;
+    for (size_t i = 0; i < sizeof(values) / sizeof(values[0]); i++) {
+        p = putU32(p, values[i]);
+    }
+    return p - out;
+}
+
+bool unpackStatsReport(const uint8_t* payload, size_t length, StatsReport& report) {
+    if (length < TELEMETRY_STATS_PAYLOAD) {
+        return false;
+    }
+    uint32_t* fields[] = {
+        &report.elapsedMillis, &report.loops, &report.loopMaxMicros, &report.shows,
+        &report.showMeanMicros, &report.showMaxMicros, &report.bytesIn, &report.bytesOut,
+        &report.droppedBytes, &report.adcOverruns, &report.freeHeap, &report.largestFreeBlock
+    };
+    for (size_t i = 0; i < sizeof(fields) / sizeof(fields[0]); i++) {
+        *fields[i] = getU32(payload + 4 * i);
+    }
+    return true;
+}
+
+uint8_t parseTelemetryFields(const char* list) {
+    static const struct { const char* name; uint8_t bit; } names[] = {
+        { "raw", FIELD_RAW }, { "ema", FIELD_EMA }, { "deriv", FIELD_DERIVATIVE },
+        { "baseline", FIELD_BASELINE }, { "all", FIELDS_ALL }
+    };
+
+    uint8_t fields = 0;
+    while (*list != '\0') {
+        size_t length = strcspn(list, ",");
+        uint8_t bit = 0;
+        for (size_t i = 0; i < sizeof(names) / sizeof(names[0]); i++) {
+            if (strlen(names[i].name) == length && strncmp(list, names[i].name, length) == 0) {
+                bit = names[i].bit;
+            }
+        }
+        if (bit == 0) {
+            return 0;
+        }
+        fields |= bit;
+        list += length;
+        if (*list == ',') {
+            list++;
+        }
+    }
+    return fields;
+}
+
+//━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+//                               VARINTS
+//━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+// 7 bits per byte, low bits first, high bit set on every byte but the last
+
+size_t putVarint(uint8_t* out, uint32_t value) {
+    size_t n = 0;
+    while (value >= 0x80) {
+        out[n++] = (value & 0x7F) | 0x80;
+        value >>= 7;
+    }
+    out[n++] = value;
+    return n;
+}
+
+size_t getVarint(const uint8_t* in, size_t length, uint32_t& value) {
+    value = 0;
+    for (size_t n = 0; n < length && n < 5; n++) {
+        value |= (uint32_t)(in[n] & 0x7F) << (7 * n);
+        if ((in[n] & 0x80) == 0) {
+            return n + 1;
+        }
+    }
+    return 0;
+}
+
+//━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+//                             BATCH FRAMES
+//━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+
+TelemetryBatch::TelemetryBatch() {
+    reset();
+}
+
+void TelemetryBatch::reset() {
+    length = 0;
+    firstTime = 0;
+    lastTime = 0;
+    lastStep = 0;
+    lastRaw = 0;
+}
+
+bool TelemetryBatch::add(uint16_t sequence, uint32_t timeMicros, uint16_t raw) {
+    if (length == 0) {
+        buffer[0] = 1;
+        putU16(buffer + 1, sequence);
+        putU32(buffer + 3, timeMicros);
+        putU16(buffer + 7, raw);
+        length = TELEMETRY_BATCH_HEADER;
+        firstTime = lastTime = timeMicros;
+        lastStep = 0;
+        lastRaw = raw;
+        return true;
+    }
+
+    // Always leave room for a worst-case sample so add() never overflows
+    if (buffer[0] == 255 || length + TELEMETRY_BATCH_MAX_STEP > TELEMETRY_MAX_PAYLOAD) {
+        return false;
+    }
+
+    int32_t step = (int32_t)(timeMicros - lastTime);
+    length += putVarint(buffer + length, zigzagEncode(step - lastStep));
+    length += putVarint(buffer + length, zigzagEncode((int32_t)raw - lastRaw));
+
+    lastTime = timeMicros;
+    lastStep = step;
+    lastRaw = raw;
+    buffer[0]++;
+    return true;
+}
+
+const uint8_t* TelemetryBatch::payload() const {
+    return buffer;
+}
+
+size_t TelemetryBatch::size() const {
+    return length;
+}
+
+uint8_t TelemetryBatch::count() const {
+    return length == 0 ? 0 : buffer[0];
+}
+
+uint32_t TelemetryBatch::age(uint32_t nowMicros) const {
+    return length == 0 ? 0 : nowMicros - firstTime;
+}
+
+size_t unpackBatch(const uint8_t* payload, size_t length, RawSample* out, size_t maxSamples) {
+    if (length < TELEMETRY_BATCH_HEADER || payload[0] == 0 || payload[0] > maxSamples) {
+        return 0;
+    }
+
+    size_t count = payload[0];
+    out[0].sequence = getU16(payload + 1);
+    out[0].timeMicros = getU32(payload + 3);
+    out[0].raw = getU16(payload + 7);
+
+    size_t read = TELEMETRY_BATCH_HEADER;
+    int32_t step = 0;
+    for (size_t i = 1; i < count; i++) {
+        uint32_t timeCode, rawCode;
+        size_t n = getVarint(payload + read, length - read, timeCode);
+        if (n == 0) {
+            return 0;
+        }
+        read += n;
+        n = getVarint(payload + read, length - read, rawCode);
+        if (n == 0) {
+            return 0;
+        }
+        read += n;
+
+        step += zigzagDecode(timeCode);
+        out[i].sequence = out[i - 1].sequence + 1;
+        out[i].timeMicros = out[i - 1].timeMicros + step;
+        out[i].raw = out[i - 1].raw + zigzagDecode(rawCode);
+    }
+    return read == length ? count : 0;
+}
@@ -0,0 +1,212 @@
+/*
+╔══════════════════════════════════════════════════════════════════════════╗
+║                    BINARY TELEMETRY FRAME CODEC                           ║
+║               COBS framing + CRC-16, shared by device and host            ║
+╚══════════════════════════════════════════════════════════════════════════╝
+
+ The JSON line {"ema":123.45} costs 16 bytes (with CRLF) and a
+ float-to-text conversion for a single value. Binary telemetry sends a
+ full sample record in 25 bytes on the wire, so 115200 baud carries ~460
+ records/s. Batch frames go further for raw capture: ~3.5 bytes/sample.
+
+ FRAME LAYOUT (before COBS):
+ --------------------------
+   [type:1] [payload:N] [crc16:2]     all multi-byte fields little-endian
+ The CRC (CCITT, init 0xFFFF) covers type + payload. The frame is then
+ COBS-encoded, which removes every 0x00 byte, and ends with a single 0x00.
+ A reader can therefore always resync by skipping to the next 0x00.
+
+ FRAME TYPES:
+ -----------
+   0x01 SAMPLE  seq:u16 time_us:u32 raw:u16 ema:f32 deriv:f32 baseline:f32
+   0x02 STATUS  UTF-8 text (same messages as {"status":"..."})
+   0x03 BATCH   count:u8 seq:u16 time_us:u32 raw:u16, then per extra sample
+                varint(zigzag(Δtime - previous Δtime)) varint(zigzag(Δraw))
+   0x04 FIELDS  seq:u16 time_us:u32 fields:u8, then only the fields whose
+                bit is set, in this order: raw:u16 ema:f32 deriv:f32 baseline:f32
+                (sent instead of SAMPLE after a FIELDS: command)
+   0x05 SYNC    host_time:u64 device_rx_us:u32 device_tx_us:u32
+                (reply to SYNC:<host_time>, see below)
+   0x06 STATS   12 × u32: elapsed_ms loops loop_max_us shows show_mean_us
+                show_max_us rx_bytes tx_bytes tx_dropped adc_overruns
+                heap_free heap_block (reply to STATS)
+
+ CLOCK SYNC:
+ ----------
+ Works like NTP. The host sends SYNC:<t1> with its own clock (any integer
+ unit, echoed back untouched). The device notes micros() when the line
+ arrived (t2) and when the reply is queued (t3). The host notes when the
+ reply arrives (t4). Then:
+   round trip  = (t4 - t1) - (t3 - t2)
+   offset      = ((t2 - t1) + (t3 - t4)) / 2      device clock - host clock
+ The exchange with the smallest round trip gives the best offset. With
+ it, every time_us in a telemetry frame converts to host time, so
+ "host now - sample time" is the real sensor-to-host latency.
+
+ BATCH ENCODING:
+ --------------
+ The first sample is absolute; the rest only store how much they changed.
+ At a steady 100 Hz the time step barely changes and raw moves a few
+ counts, so both usually fit in one or two varint bytes. Zigzag maps
+ signed changes to small unsigned numbers (0,-1,1,-2 → 0,1,2,3) so
+ negative steps stay short too. Sequence numbers are implicit (seq + i).
+
+ This file only uses the C standard library so host tools can build it
+ unchanged.
+*/
+
+#ifndef TELEMETRY_CODEC_H
+#define TELEMETRY_CODEC_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+//━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+//                          FRAME CONSTANTS
+//━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+
+enum TelemetryFrameType : uint8_t {
+  FRAME_SAMPLE = 0x01,
+  FRAME_STATUS = 0x02,
+  FRAME_BATCH  = 0x03,
+  FRAME_FIELDS = 0x04,
+  FRAME_SYNC   = 0x05,
+  FRAME_STATS  = 0x06
+};
+
+// Bits of the FIELDS frame and of the FIELDS: command
+enum TelemetryField : uint8_t {
+  FIELD_RAW        = 0x01,
+  FIELD_EMA        = 0x02,
+  FIELD_DERIVATIVE = 0x04,
+  FIELD_BASELINE   = 0x08,
+  FIELDS_ALL       = 0x0F
+};
+
+#define TELEMETRY_SAMPLE_PAYLOAD 20   // Sample payload bytes after the type
+#define TELEMETRY_SYNC_PAYLOAD   16   // SYNC reply payload bytes after the type
+#define TELEMETRY_STATS_PAYLOAD  48   // STATS payload bytes after the type
+#define TELEMETRY_MAX_PAYLOAD    96   // Largest payload a frame may carry
+#define TELEMETRY_BATCH_HEADER    9   // count + seq + time + raw of sample 0
+#define TELEMETRY_BATCH_MAX_STEP  8   // Worst case varint bytes per extra sample
+// Most samples a batch can hold (two 1-byte varints each); size decoder buffers with it
+#define TELEMETRY_BATCH_MAX_SAMPLES ((TELEMETRY_MAX_PAYLOAD - TELEMETRY_BATCH_HEADER) / 2 + 1)
+
+// Worst-case encoded size: type + payload + CRC, COBS overhead, delimiter
+#define TELEMETRY_MAX_FRAME(payload) ((payload) + 3 + ((payload) + 3) / 254 + 2)
+
+//━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+//                          SAMPLE RECORD
+//━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+
+struct TelemetrySample {
+  uint16_t sequence;     // Increments per sample, wraps at 65535
+  uint32_t timeMicros;   // Device micros() when the sample was read
+  uint16_t raw;          // analogRead value
+  float ema;             // Exponentially filtered value
+  float derivative;      // EMA change since the previous sample
+  float baseline;        // Calibration baseline
+};
+
+// One entry of a batch frame: raw signal only, for full-rate capture
+struct RawSample {
+  uint16_t sequence;
+  uint32_t timeMicros;
+  uint16_t raw;
+};
+
+// Reply to SYNC:<host_time>
+struct SyncReply {
+  uint64_t hostTime;        // t1, echoed from the command
+  uint32_t deviceRxMicros;  // t2, device micros() when SYNC arrived
+  uint32_t deviceTxMicros;  // t3, device micros() when the reply was sent
+};
+
+// Reply to STATS: counters since boot or the last STATS:RESET
+struct StatsReport {
+  uint32_t elapsedMillis;
+  uint32_t loops;
+  uint32_t loopMaxMicros;
+  uint32_t shows;           // strip.show() calls
+  uint32_t showMeanMicros;
+  uint32_t showMaxMicros;
+  uint32_t bytesIn;
+  uint32_t bytesOut;
+  uint32_t droppedBytes;    // Telemetry dropped by the TX queue
+  uint32_t adcOverruns;     // Sample slots missed
+  uint32_t freeHeap;
+  uint32_t largestFreeBlock;
+};
+
+//━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+//                          BATCH ENCODER
+//━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+
+class TelemetryBatch {
+  private:
+    uint8_t buffer[TELEMETRY_MAX_PAYLOAD];
+    size_t length;
+    uint32_t firstTime;
+    uint32_t lastTime;
+    int32_t lastStep;
+    uint16_t lastRaw;
+
+  public:
+    TelemetryBatch();
+
+    // Returns false when the batch is full: send payload(), reset(), add again
+    bool add(uint16_t sequence, uint32_t timeMicros, uint16_t raw);
+    void reset();
+
+    const uint8_t* payload() const;
+    size_t size() const;
+    uint8_t count() const;
+    uint32_t age(uint32_t nowMicros) const;   // Time since the first sample
+};
+
+//━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+//                          CODEC FUNCTIONS
+//━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+
+uint16_t crc16Ccitt(const uint8_t* data, size_t length, uint16_t crc = 0xFFFF);
+
+// out needs length + length / 254 + 1 bytes; returns bytes written
+size_t cobsEncode(const uint8_t* in, size_t length, uint8_t* out);
+// Works in place (out == in); returns decoded length or 0 if malformed
+size_t cobsDecode(const uint8_t* in, size_t length, uint8_t* out);
+
+// Builds a complete wire frame (COBS + trailing 0x00) into out, which needs
+// TELEMETRY_MAX_FRAME(length) bytes. Returns 0 if payload is too long.
+size_t encodeFrame(uint8_t type, const uint8_t* payload, size_t length, uint8_t* out);
+// Decodes one frame (without its 0x00) in place. Returns the type + payload
+// length (type at frame[0]) or 0 if the COBS or CRC check fails.
+size_t decodeFrame(uint8_t* frame, size_t length);
+
+size_t packSample(const TelemetrySample& sample, uint8_t* out);
+bool unpackSample(const uint8_t* payload, size_t length, TelemetrySample& sample);
+size_t packSampleFields(const TelemetrySample& sample, uint8_t fields, uint8_t* out);
+// Fields that are not in the frame are left untouched
+bool unpackSampleFields(const uint8_t* payload, size_t length, TelemetrySample& sample, uint8_t& fields);
+size_t packSyncReply(const SyncReply& reply, uint8_t* out);
+bool unpackSyncReply(const uint8_t* payload, size_t length, SyncReply& reply);
+size_t packStatsReport(const StatsReport& report, uint8_t* out);
+bool unpackStatsReport(const uint8_t* payload, size_t length, StatsReport& report);
+// "raw,ema,deriv,baseline" (any subset, or "all") → field bits; 0 if a name is unknown
+uint8_t parseTelemetryFields(const char* list);
+
+// Expands a batch payload into out; returns samples written or 0 if malformed
+size_t unpackBatch(const uint8_t* payload, size_t length, RawSample* out, size_t maxSamples);
+
+//──────── Varint Helpers ────────
+size_t putVarint(uint8_t* out, uint32_t value);
+size_t getVarint(const uint8_t* in, size_t length, uint32_t& value);   // 0 = truncated
+
+inline uint32_t zigzagEncode(int32_t value) {
+  return ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+}
+
+inline int32_t zigzagDecode(uint32_t value) {
+  return (int32_t)(value >> 1) ^ -(int32_t)(value & 1);
+}
+
+#endif
@@ -0,0 +1,553 @@
+/*
+╔══════════════════════════════════════════════════════════════════════════╗
+║                     WEB SERIAL LINK IMPLEMENTATION                        ║
+╚══════════════════════════════════════════════════════════════════════════╝
+*/
+
+#include "WebSerialLink.h"
+#include "GSRVisualizer.h"
+#include "CommandParser.h"
+
+WebSerialLink::WebSerialLink(GSRVisualizer& target, WebSerialStorage& storage)
+    : visualizer(target),
+      telemetryFormat(TELEMETRY_JSON), telemetrySequence(0), batchFlushMicros(200000),
+      telemetryFields(0), telemetryIntervalMicros(50000), jsonIntervalMicros(50000),
+      lastTelemetryMicros(0), creditMode(false), credits(0), creditSkipped(0),
+      txQueue(Serial, storage.txTelemetry, TX_TELEMETRY_BYTES, storage.txStatus, TX_STATUS_BYTES),
+      reportedDrops(0), lastDropReport(0),
+      bytesOutAtReset(0), droppedBytesAtReset(0), extensionCount(0) {
+}
+
+//━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+//                              OUTPUT
+//━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+
+// avr-libc's printf has no %f, so JSON numbers go out as fixed point:
+// 1 to 3 decimals, halves rounded away from zero; "null" for NaN or out
+// of range (JSON has no nan)
+static const char* formatFixed(float value, uint8_t decimals, char* text, size_t size) {
+    static const unsigned long kScale[] = { 1, 10, 100, 1000 };
+    unsigned long scale = kScale[decimals];
+    double scaled = (double)value * scale;   // Same as float on AVR
+    if (!(scaled > -2.0e9 && scaled < 2.0e9)) {   // NaN fails both
+        snprintf(text, size, "null");
+        return text;
+    }
+    long rounded = (long)(scaled < 0 ? scaled - 0.5 : scaled + 0.5);
+    unsigned long magnitude = rounded < 0 ? 0UL - (unsigned long)rounded : (unsigned long)rounded;
+    snprintf(text, size, "%s%lu.%0*lu", rounded < 0 ? "-" : "",
+             magnitude / scale, (int)decimals, magnitude % scale);
+    return text;
+}
+
+// Everything below only queues; serviceSerial() does the actual writing
+void WebSerialLink::sendDataToP5(float emaValue) {
+    char number[24];
+    char line[32];
+    int length = snprintf(line, sizeof(line), "{\"ema\":%s}\r\n",
+                          formatFixed(emaValue, 2, number, sizeof(number)));
+    queueTelemetry((const uint8_t*)line, min(length, (int)sizeof(line) - 1));
+}
+
+void WebSerialLink::sendStatus(const char* status) {
+    if (telemetryFormat != TELEMETRY_JSON) {
+        // Keep the stream pure binary: status text travels in its own frame
+        uint8_t frame[TELEMETRY_MAX_FRAME(TELEMETRY_MAX_PAYLOAD)];
+        size_t length = encodeFrame(FRAME_STATUS, (const uint8_t*)status,
+                                    min(strlen(status), (size_t)TELEMETRY_MAX_PAYLOAD), frame);
+        txQueue.sendStatus(frame, length);
+        return;
+    }
+
+    char line[TELEMETRY_MAX_PAYLOAD + 16];
+    int length = snprintf(line, sizeof(line), "{\"status\":\"%s\"}\r\n", status);
+    txQueue.sendStatus((const uint8_t*)line, min(length, (int)sizeof(line) - 1));
+}
+
+// Call once per sensor sample; RATE, FIELDS and CREDIT decide what is sent.
+// Binary: one full record is 25 bytes on the wire, so 115200 baud carries
+// ~460 records/s instead of ~20 text values/s.
+// Batch: raw only, queued into telemetryBatch and sent as one frame.
+void WebSerialLink::sendSample(uint32_t timeMicros, int raw, float emaValue, float emaDerivative, float baseline) {
+    if (telemetryIntervalMicros > 0 && timeMicros - lastTelemetryMicros < telemetryIntervalMicros) {
+        return;
+    }
+    lastTelemetryMicros = timeMicros;
+
+    if (telemetryFormat == TELEMETRY_BATCH) {
+        if (!telemetryBatch.add(telemetrySequence, timeMicros, raw)) {
+            flushBatch();
+            telemetryBatch.add(telemetrySequence, timeMicros, raw);
+        }
+        telemetrySequence++;
+        if (telemetryBatch.age(timeMicros) >= batchFlushMicros) {
+            flushBatch();
+        }
+        return;
+    }
+
+    TelemetrySample sample;
+    sample.sequence = telemetrySequence++;
+    sample.timeMicros = timeMicros;
+    sample.raw = raw;
+    sample.ema = emaValue;
+    sample.derivative = emaDerivative;
+    sample.baseline = baseline;
+
+    if (telemetryFormat == TELEMETRY_JSON) {
+        sendJsonSample(sample);
+        return;
+    }
+
+    // Full records keep the fixed SAMPLE layout; a FIELDS: subset is tagged
+    uint8_t fields = telemetryFields != 0 ? telemetryFields : (uint8_t)FIELDS_ALL;
+    uint8_t payload[TELEMETRY_SAMPLE_PAYLOAD + 1];
+    uint8_t frame[TELEMETRY_MAX_FRAME(TELEMETRY_SAMPLE_PAYLOAD + 1)];
+    size_t length;
+    if (fields == FIELDS_ALL) {
+        length = encodeFrame(FRAME_SAMPLE, payload, packSample(sample, payload), frame);
+    } else {
+        length = encodeFrame(FRAME_FIELDS, payload, packSampleFields(sample, fields, payload), frame);
+    }
+    queueTelemetry(frame, length);
+}
+
+void WebSerialLink::sendJsonSample(const TelemetrySample& sample) {
+    // Without FIELDS: only {"ema":...}, exactly what the p5.js sketch expects
+    if (telemetryFields == 0) {
+        sendDataToP5(sample.ema);
+        return;
+    }
+
+    char number[24];
+    char line[128];
+    // "t" is the device time of the sample, for latency after SYNC
+    int length = snprintf(line, sizeof(line), "{\"seq\":%u,\"t\":%lu",
+                          sample.sequence, (unsigned long)sample.timeMicros);
+    if (telemetryFields & FIELD_RAW) {
+        length += snprintf(line + length, sizeof(line) - length, ",\"raw\":%u", sample.raw);
+    }
+    if (telemetryFields & FIELD_EMA) {
+        length += snprintf(line + length, sizeof(line) - length, ",\"ema\":%s",
+                           formatFixed(sample.ema, 2, number, sizeof(number)));
+    }
+    if (telemetryFields & FIELD_DERIVATIVE) {
+        length += snprintf(line + length, sizeof(line) - length, ",\"deriv\":%s",
+                           formatFixed(sample.derivative, 3, number, sizeof(number)));
+    }
+    if (telemetryFields & FIELD_BASELINE) {
+        length += snprintf(line + length, sizeof(line) - length, ",\"baseline\":%s",
+                           formatFixed(sample.baseline, 2, number, sizeof(number)));
+    }
+    length += snprintf(line + length, sizeof(line) - length, "}\r\n");
+    queueTelemetry((const uint8_t*)line, min(length, (int)sizeof(line) - 1));
+}
+
+void WebSerialLink::flushBatch() {
+    if (telemetryBatch.count() == 0) {
+        return;
+    }
+    uint8_t frame[TELEMETRY_MAX_FRAME(TELEMETRY_MAX_PAYLOAD)];
+    size_t length = encodeFrame(FRAME_BATCH, telemetryBatch.payload(), telemetryBatch.size(), frame);
+    queueTelemetry(frame, length);
+    telemetryBatch.reset();
+}
+
+// With CREDIT flow control on, every telemetry message spends one credit;
+// without credit it is skipped here instead of piling up in the TX queue
+void WebSerialLink::queueTelemetry(const uint8_t* data, size_t length) {
+    if (creditMode) {
+        if (credits == 0) {
+            creditSkipped++;
+            return;
+        }
+        credits--;
+    }
+    txQueue.sendTelemetry(data, length);
+}
+
+// avr-libc's printf has no %llu, so 64-bit host times are written by hand
+static char* formatUint64(uint64_t value, char* end) {
+    *--end = '\0';
+    do {
+        *--end = '0' + (char)(value % 10);
+        value /= 10;
+    } while (value > 0);
+    return end;
+}
+
+// Goes through the status ring: it is sent ahead of queued telemetry and
+// never needs credit, so t3 stays close to the real send time
+void WebSerialLink::sendSyncReply(uint64_t hostTime, uint32_t receivedMicros) {
+    SyncReply reply;
+    reply.hostTime = hostTime;
+    reply.deviceRxMicros = receivedMicros;
+    reply.deviceTxMicros = micros();
+
+    if (telemetryFormat != TELEMETRY_JSON) {
+        uint8_t payload[TELEMETRY_SYNC_PAYLOAD];
+        uint8_t frame[TELEMETRY_MAX_FRAME(TELEMETRY_SYNC_PAYLOAD)];
+        size_t length = encodeFrame(FRAME_SYNC, payload, packSyncReply(reply, payload), frame);
+        txQueue.sendStatus(frame, length);
+        return;
+    }
+
+    char hostDigits[21];   // 2^64 - 1 has 20 digits
+    char line[80];
+    int length = snprintf(line, sizeof(line), "{\"sync\":[%s,%lu,%lu]}\r\n",
+                          formatUint64(reply.hostTime, hostDigits + sizeof(hostDigits)),
+                          (unsigned long)reply.deviceRxMicros, (unsigned long)reply.deviceTxMicros);
+    txQueue.sendStatus((const uint8_t*)line, min(length, (int)sizeof(line) - 1));
+}
+
+void WebSerialLink::sendStats() {
+    PipelineStats& pipelineStats = visualizer.getStats();
+    StatsReport report;
+    report.elapsedMillis = pipelineStats.getElapsedMillis();
+    report.loops = pipelineStats.getLoops();
+    report.loopMaxMicros = pipelineStats.getLoopMaxMicros();
+    report.shows = pipelineStats.getShows();
+    report.showMeanMicros = pipelineStats.getShowMeanMicros();
+    report.showMaxMicros = pipelineStats.getShowMaxMicros();
+    report.bytesIn = pipelineStats.getBytesIn();
+    report.bytesOut = txQueue.getBytesSent() - bytesOutAtReset;
+    report.droppedBytes = txQueue.getDroppedBytes() - droppedBytesAtReset;
+    report.adcOverruns = pipelineStats.getAdcOverruns();
+#ifdef ESP32
+    report.freeHeap = ESP.getFreeHeap();
+    report.largestFreeBlock = ESP.getMaxAllocHeap();
+#else
+    report.freeHeap = 0;
+    report.largestFreeBlock = 0;
+#endif
+
+    if (telemetryFormat != TELEMETRY_JSON) {
+        uint8_t payload[TELEMETRY_STATS_PAYLOAD];
+        uint8_t frame[TELEMETRY_MAX_FRAME(TELEMETRY_STATS_PAYLOAD)];
+        size_t length = encodeFrame(FRAME_STATS, payload, packStatsReport(report, payload), frame);
+        txQueue.sendStatus(frame, length);
+        return;
+    }
+
+    uint32_t seconds = max(report.elapsedMillis / 1000, (uint32_t)1);
+    char line[320];
+    int length = snprintf(line, sizeof(line),
+        "{\"stats\":{\"ms\":%lu,\"loops_per_s\":%lu,\"loop_mean_us\":%lu,\"loop_max_us\":%lu,"
+        "\"shows_per_s\":%lu,\"show_mean_us\":%lu,\"show_max_us\":%lu,"
+        "\"rx_bytes\":%lu,\"tx_bytes\":%lu,\"tx_dropped\":%lu,\"adc_overruns\":%lu,"
+        "\"heap_free\":%lu,\"heap_block\":%lu}}\r\n",
+        (unsigned long)report.elapsedMillis, (unsigned long)(report.loops / seconds),
+        (unsigned long)pipelineStats.getLoopMeanMicros(), (unsigned long)report.loopMaxMicros,
+        (unsigned long)(report.shows / seconds), (unsigned long)report.showMeanMicros,
+        (unsigned long)report.showMaxMicros, (unsigned long)report.bytesIn,
+        (unsigned long)report.bytesOut, (unsigned long)report.droppedBytes,
+        (unsigned long)report.adcOverruns, (unsigned long)report.freeHeap,
+        (unsigned long)report.largestFreeBlock);
+    txQueue.sendStatus((const uint8_t*)line, min(length, (int)sizeof(line) - 1));
+}
+
+void WebSerialLink::resetStats() {
+    visualizer.getStats().reset();
+    bytesOutAtReset = txQueue.getBytesSent();
+    droppedBytesAtReset = txQueue.getDroppedBytes();
+}
+
+void WebSerialLink::serviceSerial() {
+    txQueue.drain();
+
+    // Tell the host about dropped telemetry, at most once a second
+    uint32_t dropped = txQueue.getDroppedMessages();
+    if (dropped != reportedDrops && millis() - lastDropReport >= 1000) {
+        char status[32];
+        snprintf(status, sizeof(status), "TX_DROPPED_%lu", (unsigned long)dropped);
+        sendStatus(status);
+        reportedDrops = dropped;
+        lastDropReport = millis();
+    }
+}
+
+//━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+//                              COMMANDS
+//━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+
+// avr-libc has no strtoull; stops at the first non-digit, as strtoull does
+static uint64_t parseUint64(const char* text) {
+    uint64_t value = 0;
+    while (*text >= '0' && *text <= '9') {
+        value = value * 10 + (uint64_t)(*text - '0');
+        text++;
+    }
+    return value;
+}
+
+// Digits only, at most maxValue; false for a sign, other characters or
+// anything larger (strtoul would wrap "-1" to ULONG_MAX instead)
+static bool parseBounded(const char* text, unsigned long maxValue, unsigned long& value) {
+    value = 0;
+    if (*text == '\0') {
+        return false;
+    }
+    while (*text >= '0' && *text <= '9') {
+        value = value * 10 + (unsigned long)(*text - '0');
+        if (value > maxValue) {
+            return false;
+        }
+        text++;
+    }
+    return *text == '\0';
+}
+
+// Takes the line buffer itself and tokenizes it in place: no allocations
+void WebSerialLink::processCommand(char* line, float& emaValue, float& baseline) {
+    // Called right after the line arrived: this is SYNC's receive time
+    uint32_t receivedMicros = micros();
+
+    // JSON lines from p5.js belong to the simulation tier, if it is built
+    if (line[0] == '{') {
+        runExtension("{", line);
+        return;
+    }
+
+    ParsedCommand command = splitCommand(line);
+    const char* args = command.args != nullptr ? command.args : "";
+
+    // Case labels are hashed by the compiler; strcmp rules out a stray
+    // unknown command that happens to share a hash
+    uint32_t id = hashName(command.name);
+
+    switch (id) {
+        case commandHash("CALIBRATE"):
+            if (strcmp(command.name, "CALIBRATE") == 0) {
+                sendStatus("CALIBRATION_REQUESTED");
+            }
+            break;
+
+        case commandHash("RESET"):
+            if (strcmp(command.name, "RESET") == 0) {
+                baseline = emaValue;
+                visualizer.resetAdaptiveBaseline(emaValue);
+                sendStatus("RESET_COMPLETE");
+            }
+            break;
+
+        case commandHash("BRIGHTNESS"):
+            if (strcmp(command.name, "BRIGHTNESS") == 0) {
+                visualizer.setBrightness(constrain(atoi(args), 0, 255));
+            }
+            break;
+
+        case commandHash("DITHER"):
+            if (strcmp(command.name, "DITHER") == 0) {
+                visualizer.setDithering(atoi(args) != 0);
+            }
+            break;
+
+        case commandHash("POWER"):
+            if (strcmp(command.name, "POWER") == 0) {
+                int milliamps = constrain(atoi(args), 0, 65535);
+                visualizer.setPowerBudget(milliamps);
+                char status[24];
+                snprintf(status, sizeof(status), "POWER_BUDGET_%dMA", milliamps);
+                sendStatus(status);
+            }
+            break;
+
+        case commandHash("GROUP"):
+            if (strcmp(command.name, "GROUP") == 0) {
+                visualizer.setGroupNumber(constrain(atoi(args), 1, GROUP_COUNT));
+                char status[24];
+                snprintf(status, sizeof(status), "GROUP_CHANGED_TO_%d", visualizer.getGroupNumber());
+                sendStatus(status);
+            }
+            break;
+
+        case commandHash("TELEMETRY"):
+            if (strcmp(command.name, "TELEMETRY") == 0) {
+                // The ack goes out in the old format, then the stream switches:
+                // the host knows the next byte is already in the new format.
+                // Status is sent before queued telemetry, so setTelemetryFormat()
+                // discards the old-format telemetry instead of sending it late.
+                TelemetryFormat format;
+                if (strcmp(args, "BIN") == 0) {
+                    format = TELEMETRY_BINARY;
+                } else if (strcmp(args, "BATCH") == 0) {
+                    format = TELEMETRY_BATCH;
+                } else if (strcmp(args, "JSON") == 0) {
+                    format = TELEMETRY_JSON;
+                } else {
+                    break;
+                }
+
+                sendStatus(format == TELEMETRY_BINARY ? "TELEMETRY_BINARY" :
+                           format == TELEMETRY_BATCH ? "TELEMETRY_BATCH" : "TELEMETRY_JSON");
+                setTelemetryFormat(format);
+            }
+            break;
+
+        case commandHash("RATE"):
+            if (strcmp(command.name, "RATE") == 0) {
+                // Messages per second; 0 = every sample. Capped by the sample rate.
+                int hz = constrain(atoi(args), 0, 1000);
+                setTelemetryRate(hz);
+                char status[24];
+                snprintf(status, sizeof(status), "RATE_%d", hz);
+                sendStatus(status);
+            }
+            break;
+
+        case commandHash("FIELDS"):
+            if (strcmp(command.name, "FIELDS") == 0) {
+                uint8_t fields = parseTelemetryFields(args);
+                if (fields == 0) {
+                    sendStatus("FIELDS_UNKNOWN");
+                    break;
+                }
+                setTelemetryFields(fields);
+                char status[TELEMETRY_MAX_PAYLOAD];
+                snprintf(status, sizeof(status), "FIELDS_%s", args);
+                sendStatus(status);
+            }
+            break;
+
+        case commandHash("CREDIT"):
+            if (strcmp(command.name, "CREDIT") == 0) {
+                // "CREDIT:n" grants n more telemetry messages and turns flow
+                // control on; "CREDIT:OFF" goes back to sending freely.
+                // Not acknowledged: the host sends these continuously.
+                unsigned long granted;
+                if (strcmp(args, "OFF") == 0) {
+                    creditMode = false;
+                    credits = 0;
+                } else if (parseBounded(args, 65535UL, granted)) {
+                    creditMode = true;
+                    credits = min(credits + granted, 65535UL);
+                }
+            }
+            break;
+
+        case commandHash("SYNC"):
+            if (strcmp(command.name, "SYNC") == 0) {
+                sendSyncReply(parseUint64(args), receivedMicros);
+            }
+            break;
+
+        case commandHash("STATS"):
+            if (strcmp(command.name, "STATS") == 0) {
+                if (strcmp(args, "RESET") == 0) {
+                    resetStats();
+                    sendStatus("STATS_RESET");
+                } else {
+                    sendStats();
+                }
+            }
+            break;
+
+        case commandHash("PING"):
+            if (strcmp(command.name, "PING") == 0) {
+                sendStatus("PONG");
+            }
+            break;
+
+
+        default:
+            // "LED:", "sim", ... when their tier is built
+            runExtension(command.name, args);
+            break;
+    }
+}
+
+bool WebSerialLink::addCommand(const CommandExtension& extension) {
+    if (extensionCount >= MAX_COMMAND_EXTENSIONS) {
+        return false;
+    }
+    extensions[extensionCount++] = &extension;
+    return true;
+}
+
+bool WebSerialLink::runExtension(const char* name, const char* args) {
+    for (uint8_t i = 0; i < extensionCount; i++) {
+        if (strcmp(extensions[i]->name, name) == 0) {
+            extensions[i]->handle(*this, args);
+            return true;
+        }
+    }
+    return false;
+}
+
+//━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+//                         CONFIGURATION METHODS
+//━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+
+void WebSerialLink::setTelemetryFormat(TelemetryFormat format) {
+    if (format != telemetryFormat) {
+        // Binary formats default to every sample; JSON gets its rate back
+        if (telemetryFormat == TELEMETRY_JSON) {
+            jsonIntervalMicros = telemetryIntervalMicros;
+            telemetryIntervalMicros = 0;
+        } else if (format == TELEMETRY_JSON) {
+            telemetryIntervalMicros = jsonIntervalMicros;
+        }
+        telemetryBatch.reset();
+        txQueue.discardTelemetry();
+        telemetrySequence = 0;
+    }
+    telemetryFormat = format;
+}
+
+void WebSerialLink::setTelemetryRate(int hz) {
+    telemetryIntervalMicros = hz > 0 ? 1000000UL / hz : 0;
+}
+
+void WebSerialLink::setTelemetryFields(uint8_t fields) {
+    telemetryFields = fields & FIELDS_ALL;
+}
+
+void WebSerialLink::setBatchFlushInterval(unsigned long milliseconds) {
+    batchFlushMicros = milliseconds * 1000UL;
+}
+
+TelemetryFormat WebSerialLink::getTelemetryFormat() {
+    return telemetryFormat;
+}
+
+GSRVisualizer& WebSerialLink::getVisualizer() {
+    return visualizer;
+}
+
+//━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+//                          SIMULATION TIER
+//━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+// Only referenced by visualizers whose tier has simulation; everyone else
+// leaves these out at link time.
+
+static void toggleSimulation(WebSerialLink& link, const char*) {
+    GSRVisualizer& visualizer = link.getVisualizer();
+    visualizer.setSimulationMode(!visualizer.isSimulationMode());
+    if (visualizer.isSimulationMode()) {
+        visualizer.setLEDMode(MODE_GSR_DOWNSTREAM);
+        link.sendStatus("SIMULATION_ON");
+    } else {
+        visualizer.setLEDMode(MODE_GSR_VISUALIZATION);
+        link.sendStatus("SIMULATION_OFF");
+    }
+}
+
+// Simulated data from p5.js: {"ema":456.78}
+static void receiveSimulatedEma(WebSerialLink& link, const char* line) {
+    const char* start = strchr(line, ':');
+    if (start == nullptr || strchr(start, '}') == nullptr) {
+        return;
+    }
+    GSRVisualizer& visualizer = link.getVisualizer();
+    visualizer.setSimulatedEma(atof(start + 1));
+
+    if (visualizer.isSimulationMode()) {
+        visualizer.setLEDMode(MODE_GSR_DOWNSTREAM);
+    }
+}
+
+const CommandExtension kSimulationCommands[SIMULATION_COMMAND_COUNT] = {
+    { "sim", toggleSimulation },
+    { "{",   receiveSimulatedEma },
+};
+
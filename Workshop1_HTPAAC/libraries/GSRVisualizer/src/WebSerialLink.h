@@ -0,0 +1,160 @@
+/*
+╔══════════════════════════════════════════════════════════════════════════╗
+║                          WEB SERIAL LINK                                  ║
+║        Telemetry to p5.js / host tools and commands coming back           ║
+╚══════════════════════════════════════════════════════════════════════════╝
+
+ Everything the visualizer says over Serial and everything it understands
+ from it: JSON/binary/batch telemetry, status replies, SYNC and STATS, and
+ the command parser. It is the "web serial" feature tier: only visualizers
+ built with a tier that has webSerial (see FEATURE TIERS in GSRVisualizer.h)
+ contain one, so the starter sketch carries none of this code or its 1.5 KB
+ of transmit buffers.
+
+ The link drives a GSRVisualizer but the visualizer never refers back to
+ it. Commands of other tiers ("LED:", "sim", simulated {"ema":...} lines)
+ are not built in: their tier adds them with addCommand(), so a tier that
+ is off is never referenced and the linker drops its code.
+*/
+
+#ifndef WEB_SERIAL_LINK_H
+#define WEB_SERIAL_LINK_H
+
+#include <Arduino.h>
+#include "TelemetryCodec.h"
+#include "SerialQueue.h"
+
+class GSRVisualizer;
+class WebSerialLink;
+
+//━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+//                       TELEMETRY FORMATS
+//━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+
+enum TelemetryFormat {
+  TELEMETRY_JSON,            // {"ema":123.45} lines (default, easy to debug)
+  TELEMETRY_BINARY,          // COBS frames from TelemetryCodec.h
+  TELEMETRY_BATCH            // Raw samples packed into batch frames
+};
+
+//━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+//                            STORAGE
+//━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+
+// Serial queue rings. Each message also takes 2 length bytes in its ring.
+// The telemetry ring must hold one batch frame (101 bytes), the status ring
+// the longest status message: the JSON STATS reply, up to ~270 bytes. An
+// Uno has 2 KB of SRAM in all, so AVR gets just that. To change them, pass
+// -D for the whole build (library included), not a #define in the sketch.
+#ifndef TX_TELEMETRY_BYTES
+#if defined(__AVR__)
+#define TX_TELEMETRY_BYTES 128
+#else
+#define TX_TELEMETRY_BYTES 1024
+#endif
+#endif
+
+#ifndef TX_STATUS_BYTES
+#if defined(__AVR__)
+#define TX_STATUS_BYTES 288
+#else
+#define TX_STATUS_BYTES 512
+#endif
+#endif
+
+struct WebSerialStorage {
+  uint8_t txTelemetry[TX_TELEMETRY_BYTES];
+  uint8_t txStatus[TX_STATUS_BYTES];
+};
+
+//━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+//                       COMMAND EXTENSIONS
+//━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+// A command added by another tier. name "{" receives whole {"...":...}
+// lines as args; any other name receives the text after "NAME:".
+
+#define MAX_COMMAND_EXTENSIONS 4
+
+typedef void (*CommandHandlerFn)(WebSerialLink& link, const char* args);
+
+struct CommandExtension {
+  const char* name;
+  CommandHandlerFn handle;
+};
+
+//━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+//                        WEB SERIAL LINK
+//━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+
+class WebSerialLink {
+  private:
+    GSRVisualizer& visualizer;
+
+    //──────── Telemetry ────────
+    TelemetryFormat telemetryFormat;
+    uint16_t telemetrySequence;
+    TelemetryBatch telemetryBatch;
+    unsigned long batchFlushMicros;  // Send a batch at least this often
+
+    //──────── Rate, Fields & Flow Control (set by the host) ────────
+    uint8_t telemetryFields;               // FIELD_* bits, 0 = format default
+    unsigned long telemetryIntervalMicros; // 0 = every sample
+    unsigned long jsonIntervalMicros;      // Restored when going back to JSON
+    unsigned long lastTelemetryMicros;
+    bool creditMode;
+    unsigned long credits;                 // Messages the host still accepts
+    uint32_t creditSkipped;                // Messages not sent for lack of credit
+
+    //──────── Serial Output ────────
+    SerialQueue txQueue;          // TX_TELEMETRY_BYTES + TX_STATUS_BYTES, never blocks
+    uint32_t reportedDrops;
+    unsigned long lastDropReport;
+
+    //──────── Pipeline Statistics ────────
+    uint32_t bytesOutAtReset;       // TX counters are cumulative; STATS:RESET
+    uint32_t droppedBytesAtReset;   // subtracts these
+
+    //──────── Commands Added by Other Tiers ────────
+    const CommandExtension* extensions[MAX_COMMAND_EXTENSIONS];
+    uint8_t extensionCount;
+
+    void flushBatch();
+    void sendJsonSample(const TelemetrySample& sample);
+    void queueTelemetry(const uint8_t* data, size_t length);
+    void sendSyncReply(uint64_t hostTime, uint32_t receivedMicros);
+    void sendStats();
+    void resetStats();
+    bool runExtension(const char* name, const char* args);
+
+  public:
+    WebSerialLink(GSRVisualizer& target, WebSerialStorage& storage);
+
+    //━━━━━━━━━ Output ━━━━━━━━━
+    void serviceSerial();   // Call every loop(): sends queued output
+    void sendDataToP5(float emaValue);
+    void sendStatus(const char* status);
+    void sendSample(uint32_t timeMicros, int raw, float emaValue, float emaDerivative, float baseline);
+
+    //━━━━━━━━━ Input ━━━━━━━━━
+    void processCommand(char* line, float& emaValue, float& baseline);
+    bool addCommand(const CommandExtension& extension);   // false when full
+
+    //━━━━━━━━━ Configuration ━━━━━━━━━
+    void setTelemetryFormat(TelemetryFormat format);
+    void setBatchFlushInterval(unsigned long milliseconds);
+    void setTelemetryRate(int hz);
+    void setTelemetryFields(uint8_t fields);
+    TelemetryFormat getTelemetryFormat();
+    GSRVisualizer& getVisualizer();
+};
+
+//━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+//                       SIMULATION TIER
+//━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+// "sim" toggles simulation; {"ema":456.78} lines from p5.js drive the
+// downstream animation while it is on (WebSerialLink.cpp).
+
+#define SIMULATION_COMMAND_COUNT 2
+extern const CommandExtension kSimulationCommands[SIMULATION_COMMAND_COUNT];
+
+#endif
@@ -27,7 +27,8 @@ import websockets
 from mediapipe.framework.formats import landmark_pb2
 
 from utils.overlays import draw_hud
-from utils.stream_client import FrameRateTracker, MJPEGStream
+from utils.rtp_client import RTPJpegStream
+from utils.stream_client import FrameRateTracker, MJPEGStream, WebSocketStream
 
 LOGGER = logging.getLogger("gesture_bridge")
 
@@ -403,7 +404,7 @@ class GestureClassifier:
 
 def build_arg_parser() -> argparse.ArgumentParser:
     parser = argparse.ArgumentParser(description="Gesture bridge for the fireworks visual")
-    parser.add_argument("--source", default="http://192.168.4.1/stream", help="MJPEG stream URL (ignored if --webcam)")
+    parser.add_argument("--source", default="http://192.168.4.1/stream", help="MJPEG stream URL, ws://<device-ip>:81/ws for the WebSocket stream, or rtp://<device-ip>:5004 for RTP to local port 5004 (ignored if --webcam)")
     parser.add_argument("--webcam", action="store_true", help="Use local webcam instead of ESP32 stream")
     parser.add_argument("--camera-index", type=int, default=0, help="Webcam index to use when --webcam is set")
     parser.add_argument("--display", action="store_true", help="Show annotated OpenCV window")
@@ -503,6 +504,11 @@ def run_detection(
         if getattr(args, "webcam", False):
             from utils.stream_client import WebcamStream
             source_ctx = WebcamStream(index=args.camera_index)
+        elif args.source.startswith("ws://"):
+            source_ctx = WebSocketStream(args.source)
+        elif args.source.startswith("rtp://"):
+            camera, _, port = args.source[len("rtp://") :].partition(":")
+            source_ctx = RTPJpegStream(camera, port=int(port or 5004))
         else:
             source_ctx = MJPEGStream(args.source)
         with source_ctx as stream:
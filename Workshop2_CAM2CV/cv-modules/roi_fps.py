@@ -0,0 +1,104 @@
+"""Measures the camera's frame rate for a range of ROI sizes.
+
+Sets each region of interest through the firmware's /roi endpoint while a
+/stream viewer runs, lets it settle, and reads the camera's own numbers from
+/stats. Prints a Markdown table (ROI, sensor readout, output size, capture
+FPS, delivered FPS, frame size) to paste into notes or the firmware README.
+
+    python roi_fps.py --camera 192.168.4.1 --seconds 5
+"""
+
+from __future__ import annotations
+
+import argparse
+import threading
+import time
+
+import requests
+
+from utils.stream_client import MJPEGStream, UserAgent
+
+# Centred squares, full-sensor pixels (the OV2640 array is 1600x1200)
+DEFAULT_SIZES = [1200, 800, 600, 400, 256, 128]
+
+
+def build_arg_parser() -> argparse.ArgumentParser:
+    parser = argparse.ArgumentParser(description="ROI frame rate sweep for the ESP32 camera")
+    parser.add_argument("--camera", default="192.168.4.1", help="Camera address")
+    parser.add_argument("--sizes", type=int, nargs="+", default=DEFAULT_SIZES, help="ROI sides to test, full-sensor pixels")
+    parser.add_argument("--scale", type=int, choices=[0, 1, 2, 4], default=0, help="Force a sensor readout (1 UXGA, 2 SVGA, 4 CIF; 0 = firmware picks)")
+    parser.add_argument("--seconds", type=float, default=5.0, help="Measuring time per ROI")
+    parser.add_argument("--settle", type=float, default=2.0, help="Time to let the sensor and stream settle after each change")
+    return parser
+
+
+def get_json(url: str) -> dict:
+    response = requests.get(url, timeout=5, headers={"User-Agent": UserAgent})
+    response.raise_for_status()
+    return response.json()
+
+
+def measure(camera: str, roi: str, seconds: float, settle: float) -> tuple[dict, dict]:
+    state = get_json(f"http://{camera}/roi?roi={roi}")
+    time.sleep(settle)
+    # fps in /stats is per second: average a few readings
+    readings = []
+    end = time.monotonic() + seconds
+    while time.monotonic() < end:
+        time.sleep(1.0)
+        readings.append(get_json(f"http://{camera}/stats"))
+    return state, readings
+
+
+def summarise(label: str, state: dict, readings: list[dict]) -> str:
+    capture_fps = sum(r["capture"]["fps"] for r in readings) / len(readings)
+    viewers = [r["clients"][0] for r in readings if r["clients"]]
+    viewer_fps = sum(v["fps"] for v in viewers) / len(viewers) if viewers else 0.0
+    kbps = sum(v["kbps"] for v in viewers) / len(viewers) if viewers else 0.0
+    frame_kb = kbps / 8 / viewer_fps if viewer_fps else 0.0
+    if state.get("active"):
+        mode = state["mode"]
+        output = "x".join(str(v) for v in state["output"])
+    else:
+        mode, output = "frame size", "-"
+    return f"| {label} | {mode} | {output} | {capture_fps:.1f} | {viewer_fps:.1f} | {frame_kb:.1f} |"
+
+
+def main() -> None:
+    args = build_arg_parser().parse_args()
+    stop = threading.Event()
+
+    # A viewer keeps the capture pipeline running and shows up under "clients"
+    def viewer() -> None:
+        with MJPEGStream(f"http://{args.camera}:81/stream?fps=0") as stream:
+            for _ in stream.frames():
+                if stop.is_set():
+                    break
+
+    thread = threading.Thread(target=viewer, daemon=True)
+    thread.start()
+    rows = ["| ROI | Readout | Output | Capture FPS | Delivered FPS | Frame kB |", "|-----|---------|--------|-------------|---------------|----------|"]
+    try:
+        state, readings = measure(args.camera, "off", args.seconds, args.settle)
+        rows.append(summarise("full frame", state, readings))
+        print(rows[-1])
+        for size in args.sizes:
+            w, h = min(size, 1600), min(size, 1200)
+            roi = f"{(1600 - w) // 2},{(1200 - h) // 2},{w},{h}"
+            if args.scale:
+                roi += f",{args.scale}"
+            state, readings = measure(args.camera, roi, args.seconds, args.settle)
+            rows.append(summarise(f"{w}x{h}", state, readings))
+            print(rows[-1])
+    except KeyboardInterrupt:
+        pass
+    finally:
+        get_json(f"http://{args.camera}/roi?roi=off")
+        stop.set()
+
+    print()
+    print("\n".join(rows))
+
+
+if __name__ == "__main__":
+    main()
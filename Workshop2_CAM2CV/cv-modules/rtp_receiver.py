@@ -0,0 +1,61 @@
+"""Host-side receiver for the ESP32's RTP/JPEG low-latency mode.
+
+Asks the camera to stream RTP (RFC 2435) to this machine, reassembles and
+decodes the frames, and prints frame rate, dropped frames, packet loss and
+jitter once per second. Every second it also sends an RTCP receiver report
+back, so the camera's /stats shows the same loss. Use it to check the mode
+end to end, or as a template for feeding a CV pipeline from RTP.
+
+    python rtp_receiver.py --camera 192.168.4.1 --port 5004 --display
+"""
+
+from __future__ import annotations
+
+import argparse
+import time
+
+from utils.rtp_client import RTP_CLOCK_HZ, RTPJpegStream
+from utils.stream_client import FrameRateTracker
+
+
+def build_arg_parser() -> argparse.ArgumentParser:
+    parser = argparse.ArgumentParser(description="RTP/JPEG receiver for the ESP32 camera")
+    parser.add_argument("--camera", default="192.168.4.1", help="Camera address (its HTTP server starts and stops the stream)")
+    parser.add_argument("--port", type=int, default=5004, help="Local UDP port to receive on")
+    parser.add_argument("--fps", type=int, default=None, help="Frame rate to request (0 = every frame; default: firmware setting)")
+    parser.add_argument("--display", action="store_true", help="Show the frames in an OpenCV window")
+    return parser
+
+
+def main() -> None:
+    args = build_arg_parser().parse_args()
+    tracker = FrameRateTracker()
+    last_print = time.monotonic()
+
+    with RTPJpegStream(args.camera, port=args.port, fps=args.fps) as stream:
+        print(f"Receiving RTP from {args.camera} on UDP port {args.port} (Ctrl+C to stop)")
+        try:
+            for frame in stream.frames():
+                fps = tracker.update()
+                if args.display:
+                    import cv2
+
+                    cv2.imshow("RTP", frame)
+                    if cv2.waitKey(1) & 0xFF == ord("q"):
+                        break
+                now = time.monotonic()
+                if now - last_print >= 1.0:
+                    last_print = now
+                    stats = stream.stats
+                    loss = 100.0 * stats.lost / stats.expected if stats.expected else 0.0
+                    print(
+                        f"{fps:5.1f} fps  {frame.shape[1]}x{frame.shape[0]}  frames {stream.frames_received} "
+                        f"(dropped {stream.frames_dropped})  packets lost {stats.lost} ({loss:.2f}%)  "
+                        f"jitter {stats.jitter * 1000 / RTP_CLOCK_HZ:.1f} ms"
+                    )
+        except KeyboardInterrupt:
+            pass
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,264 @@
+"""Receiver for the ESP32's RTP/JPEG (RFC 2435) low-latency mode."""
+import random
+import socket
+import struct
+import time
+from typing import Generator, Optional
+
+import cv2
+import numpy as np
+import requests
+
+from .stream_client import UserAgent
+
+# Standard Huffman tables (JPEG Annex K.3); RFC 2435 assumes them
+LUM_DC_CODELENS = bytes([0, 1, 5, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0, 0, 0])
+LUM_DC_SYMBOLS = bytes(range(12))
+LUM_AC_CODELENS = bytes([0, 2, 1, 3, 3, 2, 4, 3, 5, 5, 4, 4, 0, 0, 1, 0x7D])
+LUM_AC_SYMBOLS = bytes([
+    0x01, 0x02, 0x03, 0x00, 0x04, 0x11, 0x05, 0x12, 0x21, 0x31, 0x41, 0x06, 0x13, 0x51, 0x61, 0x07,
+    0x22, 0x71, 0x14, 0x32, 0x81, 0x91, 0xA1, 0x08, 0x23, 0x42, 0xB1, 0xC1, 0x15, 0x52, 0xD1, 0xF0,
+    0x24, 0x33, 0x62, 0x72, 0x82, 0x09, 0x0A, 0x16, 0x17, 0x18, 0x19, 0x1A, 0x25, 0x26, 0x27, 0x28,
+    0x29, 0x2A, 0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3A, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48, 0x49,
+    0x4A, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x59, 0x5A, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68, 0x69,
+    0x6A, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7A, 0x83, 0x84, 0x85, 0x86, 0x87, 0x88, 0x89,
+    0x8A, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9A, 0xA2, 0xA3, 0xA4, 0xA5, 0xA6, 0xA7,
+    0xA8, 0xA9, 0xAA, 0xB2, 0xB3, 0xB4, 0xB5, 0xB6, 0xB7, 0xB8, 0xB9, 0xBA, 0xC2, 0xC3, 0xC4, 0xC5,
+    0xC6, 0xC7, 0xC8, 0xC9, 0xCA, 0xD2, 0xD3, 0xD4, 0xD5, 0xD6, 0xD7, 0xD8, 0xD9, 0xDA, 0xE1, 0xE2,
+    0xE3, 0xE4, 0xE5, 0xE6, 0xE7, 0xE8, 0xE9, 0xEA, 0xF1, 0xF2, 0xF3, 0xF4, 0xF5, 0xF6, 0xF7, 0xF8,
+    0xF9, 0xFA,
+])
+CHM_DC_CODELENS = bytes([0, 3, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0])
+CHM_DC_SYMBOLS = bytes(range(12))
+CHM_AC_CODELENS = bytes([0, 2, 1, 2, 4, 4, 3, 4, 7, 5, 4, 4, 0, 1, 2, 0x77])
+CHM_AC_SYMBOLS = bytes([
+    0x00, 0x01, 0x02, 0x03, 0x11, 0x04, 0x05, 0x21, 0x31, 0x06, 0x12, 0x41, 0x51, 0x07, 0x61, 0x71,
+    0x13, 0x22, 0x32, 0x81, 0x08, 0x14, 0x42, 0x91, 0xA1, 0xB1, 0xC1, 0x09, 0x23, 0x33, 0x52, 0xF0,
+    0x15, 0x62, 0x72, 0xD1, 0x0A, 0x16, 0x24, 0x34, 0xE1, 0x25, 0xF1, 0x17, 0x18, 0x19, 0x1A, 0x26,
+    0x27, 0x28, 0x29, 0x2A, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3A, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48,
+    0x49, 0x4A, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x59, 0x5A, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68,
+    0x69, 0x6A, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7A, 0x82, 0x83, 0x84, 0x85, 0x86, 0x87,
+    0x88, 0x89, 0x8A, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9A, 0xA2, 0xA3, 0xA4, 0xA5,
+    0xA6, 0xA7, 0xA8, 0xA9, 0xAA, 0xB2, 0xB3, 0xB4, 0xB5, 0xB6, 0xB7, 0xB8, 0xB9, 0xBA, 0xC2, 0xC3,
+    0xC4, 0xC5, 0xC6, 0xC7, 0xC8, 0xC9, 0xCA, 0xD2, 0xD3, 0xD4, 0xD5, 0xD6, 0xD7, 0xD8, 0xD9, 0xDA,
+    0xE2, 0xE3, 0xE4, 0xE5, 0xE6, 0xE7, 0xE8, 0xE9, 0xEA, 0xF2, 0xF3, 0xF4, 0xF5, 0xF6, 0xF7, 0xF8,
+    0xF9, 0xFA,
+])
+
+RTP_JPEG_PAYLOAD_TYPE = 26
+RTP_CLOCK_HZ = 90000
+RTCP_RR = 201
+
+
+def _huffman_segment(table_class: int, table_id: int, codelens: bytes, symbols: bytes) -> bytes:
+    return b"\xff\xc4" + struct.pack(">HB", 3 + len(codelens) + len(symbols), (table_class << 4) | table_id) + codelens + symbols
+
+
+def jpeg_headers(jpeg_type: int, width: int, height: int, qtables: list, restart_interval: int = 0) -> bytes:
+    """JFIF headers for an RFC 2435 frame (its Appendix B, with in-band tables)."""
+    out = bytearray(b"\xff\xd8")
+    for table_id, table in enumerate(qtables):
+        out += b"\xff\xdb" + struct.pack(">HB", 67, table_id) + table
+    if restart_interval:
+        out += b"\xff\xdd" + struct.pack(">HH", 4, restart_interval)
+    chroma_table = 1 if len(qtables) > 1 else 0
+    luma_sampling = 0x21 if (jpeg_type & 0x3F) == 0 else 0x22
+    out += b"\xff\xc0" + struct.pack(">HBHHB", 17, 8, height, width, 3)
+    out += bytes([1, luma_sampling, 0, 2, 0x11, chroma_table, 3, 0x11, chroma_table])
+    out += _huffman_segment(0, 0, LUM_DC_CODELENS, LUM_DC_SYMBOLS)
+    out += _huffman_segment(1, 0, LUM_AC_CODELENS, LUM_AC_SYMBOLS)
+    out += _huffman_segment(0, 1, CHM_DC_CODELENS, CHM_DC_SYMBOLS)
+    out += _huffman_segment(1, 1, CHM_AC_CODELENS, CHM_AC_SYMBOLS)
+    out += b"\xff\xda" + struct.pack(">HB", 12, 3) + bytes([1, 0x00, 2, 0x11, 3, 0x11, 0, 63, 0])
+    return bytes(out)
+
+
+class LossStats:
+    """Packet loss and interarrival jitter as defined by RFC 3550 (A.3, A.8)."""
+
+    def __init__(self) -> None:
+        self.base_seq: Optional[int] = None
+        self.max_seq = 0  # Extended with the wrap-around count
+        self.received = 0
+        self.expected_prior = 0
+        self.received_prior = 0
+        self.jitter = 0.0
+        self._transit: Optional[int] = None
+
+    def update(self, seq: int, timestamp: int, arrival: float) -> None:
+        if self.base_seq is None:
+            self.base_seq = seq
+            self.max_seq = seq
+        else:
+            cycles = self.max_seq & ~0xFFFF
+            candidate = cycles | seq
+            # Pick the wrap that lands closest to the highest sequence so far
+            if candidate < self.max_seq - 0x8000:
+                candidate += 0x10000
+            elif candidate > self.max_seq + 0x8000:
+                candidate -= 0x10000
+            self.max_seq = max(self.max_seq, candidate)
+        self.received += 1
+        transit = int(arrival * RTP_CLOCK_HZ) - timestamp
+        if self._transit is not None:
+            self.jitter += (abs(transit - self._transit) - self.jitter) / 16
+        self._transit = transit
+
+    @property
+    def expected(self) -> int:
+        return 0 if self.base_seq is None else self.max_seq - self.base_seq + 1
+
+    @property
+    def lost(self) -> int:
+        return self.expected - self.received
+
+    def interval_fraction_lost(self) -> int:
+        """Fraction lost since the previous call, in 1/256 as carried by RTCP."""
+        expected = self.expected - self.expected_prior
+        received = self.received - self.received_prior
+        self.expected_prior = self.expected
+        self.received_prior = self.received
+        lost = expected - received
+        return 0 if expected <= 0 or lost <= 0 else min(255, (lost << 8) // expected)
+
+
+class RTPJpegStream:
+    """Receives the ESP32's /rtp stream with the MJPEGStream API.
+
+    open() asks the camera (http://<camera>/rtp?port=N) to send to this
+    machine; frames() reassembles the packets, drops any frame with a missing
+    packet instead of waiting for it, and sends an RTCP receiver report back
+    every second so the camera's /stats shows the loss it causes.
+    """
+
+    def __init__(self, camera: str, port: int = 5004, fps: Optional[int] = None, timeout: float = 2.0) -> None:
+        self.camera = camera
+        self.port = port
+        self.fps = fps
+        self.timeout = timeout
+        self.stats = LossStats()
+        self.frames_received = 0
+        self.frames_dropped = 0  # Incomplete: a packet went missing
+        self.last_timestamp = 0
+        self._sock: Optional[socket.socket] = None
+        self._ssrc = random.getrandbits(32)
+        self._sender_ssrc = 0
+        self._last_report = 0.0
+
+    def __enter__(self) -> "RTPJpegStream":
+        self.open()
+        return self
+
+    def __exit__(self, exc_type, exc_value, traceback) -> None:
+        self.close()
+
+    def _control(self, query: str) -> dict:
+        response = requests.get(f"http://{self.camera}/rtp?{query}", timeout=self.timeout, headers={"User-Agent": UserAgent})
+        response.raise_for_status()
+        return response.json()
+
+    def open(self) -> None:
+        if self._sock is not None:
+            return
+        sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+        sock.setsockopt(socket.SOL_SOCKET, socket.SO_RCVBUF, 1 << 20)
+        sock.bind(("", self.port))
+        sock.settimeout(self.timeout)
+        self._sock = sock
+        query = f"port={self.port}" + (f"&fps={self.fps}" if self.fps is not None else "")
+        self._control(query)
+
+    def close(self) -> None:
+        if self._sock is not None:
+            try:
+                self._control("stop=1")
+            except Exception:
+                pass
+            self._sock.close()
+            self._sock = None
+
+    def _send_report(self, sender: tuple) -> None:
+        lost = max(-0x800000, min(0x7FFFFF, self.stats.lost)) & 0xFFFFFF
+        block = struct.pack(
+            ">IIIIII",
+            self._sender_ssrc,
+            (self.stats.interval_fraction_lost() << 24) | lost,
+            self.stats.max_seq & 0xFFFFFFFF,
+            int(self.stats.jitter),
+            0,
+            0,
+        )
+        header = struct.pack(">BBHI", 0x81, RTCP_RR, 7, self._ssrc)
+        assert self._sock is not None
+        self._sock.sendto(header + block, sender)
+
+    def jpegs(self) -> Generator[bytes, None, None]:
+        """Complete JPEG files, in arrival order."""
+        if self._sock is None:
+            self.open()
+        assert self._sock is not None
+        frame_ts: Optional[int] = None
+        data = bytearray()
+        headers = b""
+        intact = False
+
+        while True:
+            try:
+                packet, sender = self._sock.recvfrom(2048)
+            except socket.timeout:
+                continue
+            arrival = time.monotonic()
+            if len(packet) < 20 or packet[0] >> 6 != 2 or packet[1] & 0x7F != RTP_JPEG_PAYLOAD_TYPE:
+                continue
+            marker = packet[1] & 0x80
+            seq, timestamp, ssrc = struct.unpack_from(">HII", packet, 2)
+            self._sender_ssrc = ssrc
+            self.stats.update(seq, timestamp, arrival)
+            if arrival - self._last_report >= 1.0:
+                self._last_report = arrival
+                self._send_report(sender)
+
+            pos = 12 + 4 * (packet[0] & 0x0F)
+            if packet[0] & 0x10:  # Header extension
+                pos += 4 + 4 * struct.unpack_from(">H", packet, pos + 2)[0]
+            offset = int.from_bytes(packet[pos + 1 : pos + 4], "big")
+            jpeg_type, q, width8, height8 = packet[pos + 4 : pos + 8]
+            pos += 8
+            restart_interval = 0
+            if jpeg_type >= 64:
+                restart_interval = struct.unpack_from(">H", packet, pos)[0]
+                pos += 4
+
+            if timestamp != frame_ts:
+                if frame_ts is not None:
+                    self.frames_dropped += 1  # The previous frame never saw its marker
+                frame_ts = timestamp
+                data = bytearray()
+                intact = offset == 0
+            if offset == 0:
+                if q < 128:
+                    intact = False  # Tables derived from Q are not produced by the firmware
+                else:
+                    length = struct.unpack_from(">H", packet, pos + 2)[0]
+                    tables = packet[pos + 4 : pos + 4 + length]
+                    pos += 4 + length
+                    qtables = [tables[i : i + 64] for i in range(0, length, 64)]
+                    headers = jpeg_headers(jpeg_type, width8 * 8, height8 * 8, qtables, restart_interval)
+            if offset != len(data):
+                intact = False
+            data += packet[pos:]
+
+            if marker:
+                frame_ts = None
+                if intact:
+                    self.frames_received += 1
+                    self.last_timestamp = timestamp
+                    yield headers + bytes(data) + b"\xff\xd9"
+                else:
+                    self.frames_dropped += 1
+
+    def frames(self) -> Generator[np.ndarray, None, None]:
+        for jpg in self.jpegs():
+            frame = cv2.imdecode(np.frombuffer(jpg, dtype=np.uint8), cv2.IMREAD_COLOR)
+            if frame is not None:
+                yield frame
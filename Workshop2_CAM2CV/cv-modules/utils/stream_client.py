@@ -1,5 +1,6 @@
 """Utility helpers for reading the ESP32 MJPEG stream during the MASS60 workshop."""
 import contextlib
+import struct
 import time
 from typing import Generator, Iterable, Optional
 
@@ -85,6 +86,79 @@ class MJPEGStream:
                     continue
 
 
+class WebSocketStream:
+    """Reader for the firmware's /ws endpoint (port 81) with the MJPEGStream API.
+
+    Every binary message is one frame: a 16-byte little-endian header (seq,
+    timestamp_us, width, height) followed by the JPEG. Text messages are the
+    replies to commands sent with send(), e.g. "fps=15", "pause", "stats" or
+    "quality=20".
+    """
+
+    HEADER = struct.Struct("<IQHH")
+
+    def __init__(self, url: str, timeout: float = 10.0) -> None:
+        self.url = url
+        self.timeout = timeout
+        self.last_seq = 0
+        self.last_timestamp_us = 0
+        self.last_reply: Optional[str] = None
+        self._ws = None
+
+    def __enter__(self) -> "WebSocketStream":
+        self.open()
+        return self
+
+    def __exit__(self, exc_type, exc_value, traceback) -> None:
+        self.close()
+
+    def open(self) -> None:
+        if self._ws is not None:
+            return
+        from websockets.sync.client import connect
+
+        self._ws = connect(self.url, open_timeout=self.timeout, max_size=None, user_agent_header=UserAgent)
+
+    def close(self) -> None:
+        if self._ws is not None:
+            self._ws.close()
+            self._ws = None
+
+    def send(self, command: str) -> None:
+        if self._ws is None:
+            self.open()
+        self._ws.send(command)
+
+    def frames(self) -> Generator[np.ndarray, None, None]:
+        if self._ws is None:
+            self.open()
+
+        while True:
+            try:
+                assert self._ws is not None
+                message = self._ws.recv()
+                if isinstance(message, str):
+                    self.last_reply = message
+                    continue
+                if len(message) <= self.HEADER.size:
+                    continue
+                seq, timestamp_us, _width, _height = self.HEADER.unpack_from(message)
+                frame = cv2.imdecode(np.frombuffer(message, dtype=np.uint8, offset=self.HEADER.size), cv2.IMREAD_COLOR)
+                if frame is None:
+                    continue
+                self.last_seq = seq
+                self.last_timestamp_us = timestamp_us
+                yield frame
+            except Exception:
+                # Same policy as MJPEGStream: reconnect quickly on any error
+                self.close()
+                time.sleep(0.3)
+                try:
+                    self.open()
+                except Exception:
+                    time.sleep(0.7)
+
+
 class WebcamStream:
     """OpenCV VideoCapture wrapper that mimics MJPEGStream API."""
 
@@ -58,10 +58,12 @@ constexpr StreamSettings kStream{
     /* auto_white_balance */ true,
     /* auto_gain_control  */ true,
     /* auto_exposure      */ true,
-    /* stream_delay_ms    */ 33                // ~30 FPS target
+    /* stream_delay_ms    */ 33                // ~30 FPS per viewer; /stream?fps=N overrides, 0 = unpaced
 };
 
 constexpr uint16_t kWebServerPort = 80;
+constexpr uint8_t kMaxStreamClients = 4;  // Concurrent /stream viewers sharing one capture
+constexpr uint8_t kMaxWsClients = 2;      // Concurrent /ws viewers, on top of the /stream ones
 constexpr bool kEnableStatusLed = true;
 constexpr uint8_t kStatusLedPin = 21;  // Onboard LED for the XIAO ESP32S3 Sense carrier
 
@@ -0,0 +1,6 @@
+#pragma once
+// Host stand-in for the Arduino core's logging macros (-Iesp)
+#include <stdio.h>
+
+#define log_i(format, ...) fprintf(stderr, "[I] " format "\n", ##__VA_ARGS__)
+#define log_e(format, ...) fprintf(stderr, "[E] " format "\n", ##__VA_ARGS__)
@@ -0,0 +1,9 @@
+#pragma once
+// Host stand-in for the camera driver's img_converters.h: only the JPEG
+// decoder the motion gate uses, implemented by the check itself (-Iesp)
+#include <stddef.h>
+#include <stdint.h>
+
+typedef enum { JPG_SCALE_NONE, JPG_SCALE_2X, JPG_SCALE_4X, JPG_SCALE_8X } jpg_scale_t;
+
+bool jpg2rgb565(const uint8_t *src, size_t src_len, uint8_t *out, jpg_scale_t scale);
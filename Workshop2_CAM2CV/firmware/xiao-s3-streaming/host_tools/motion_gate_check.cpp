@@ -0,0 +1,207 @@
+/*
+╔══════════════════════════════════════════════════════════════════════════╗
+║                          MOTION GATE CHECK                                ║
+║          Runs the firmware's motion_gate.cpp on a computer                ║
+╚══════════════════════════════════════════════════════════════════════════╝
+
+ Feeds the gate scripted frames and checks which ones it lets through:
+ threshold and per-block delta, keepalive, slow drift measured against the
+ last frame sent, and a fresh reference after the frame size changes (a new
+ framesize or ROI). The JPEG decoder and clock are stand-ins (esp/): a
+ "JPEG" here is its block grid with one luma value per 8x8 block, which is
+ what the gate gets from decoding at 1/8 scale.
+
+ USAGE:
+ -----
+   motion_gate_check          (exits non-zero on any failure)
+*/
+
+#include "motion_gate.h"
+
+#include "esp_timer.h"
+#include "img_converters.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_BLOCKS (200 * 150)  // UXGA at 1/8
+
+typedef struct {
+  uint16_t blocks_w;
+  uint16_t blocks_h;
+  bool corrupt;  // jpg2rgb565 fails on it
+  uint8_t luma[MAX_BLOCKS];
+} test_frame_t;
+
+static int64_t now_us = 10 * 1000000LL;
+static int failures = 0;
+
+int64_t esp_timer_get_time() {
+  return now_us;
+}
+
+// Grey RGB565, big-endian like the real decoder's output, one pixel per block.
+// The gate's luma comes back exact for multiples of 8, so the checks use those.
+bool jpg2rgb565(const uint8_t *src, size_t src_len, uint8_t *out, jpg_scale_t scale) {
+  const test_frame_t *f = (const test_frame_t *)src;
+  if (src_len != sizeof(*f) || scale != JPG_SCALE_8X || f->corrupt) {
+    return false;
+  }
+  for (uint32_t i = 0; i < (uint32_t)f->blocks_w * f->blocks_h; i++) {
+    uint8_t y = f->luma[i];
+    uint16_t px = ((y >> 3) << 11) | ((y >> 2) << 5) | (y >> 3);
+    out[i * 2] = px >> 8;
+    out[i * 2 + 1] = px;
+  }
+  return true;
+}
+
+static test_frame_t frame;
+
+static void fill(uint16_t width, uint16_t height, uint8_t luma) {
+  frame.blocks_w = width / 8;
+  frame.blocks_h = height / 8;
+  frame.corrupt = false;
+  memset(frame.luma, luma, sizeof(frame.luma));
+}
+
+// Sends the current frame through the gate, time steps by ms first
+static bool check(uint32_t ms) {
+  now_us += ms * 1000LL;
+  return motion_gate_check((const uint8_t *)&frame, sizeof(frame), frame.blocks_w * 8, frame.blocks_h * 8);
+}
+
+static unsigned stat(const char *key) {
+  char json[512];
+  char pattern[40];
+  motion_gate_status_json(json, sizeof(json));
+  snprintf(pattern, sizeof(pattern), "\"%s\":", key);
+  const char *p = strstr(json, pattern);
+  return p ? strtoul(p + strlen(pattern), NULL, 10) : 0;
+}
+
+static void expect(bool ok, const char *what) {
+  printf("%s %s\n", ok ? "ok  " : "FAIL", what);
+  if (!ok) {
+    failures++;
+  }
+}
+
+// Gate off, then on with a fresh reference and the given settings
+static void restart(int threshold, int keepalive_s) {
+  motion_gate_set_enabled(0);
+  motion_gate_set_threshold(threshold);
+  motion_gate_set_keepalive(keepalive_s);
+  motion_gate_set_enabled(1);
+}
+
+static void thresholdCheck() {
+  // VGA: 80x60 = 4800 blocks, 2% = 96
+  restart(2, 60);
+  fill(640, 480, 96);
+  expect(check(100), "threshold: first frame after enabling goes out");
+  expect(!check(100), "threshold: identical frame is held");
+
+  memset(frame.luma, 96 + 8, 200);
+  expect(!check(100), "threshold: a change of 8 (below 12) does not count");
+  memset(frame.luma, 96 + 16, 95);
+  expect(!check(100), "threshold: 95 changed blocks (1.98%) are held");
+  memset(frame.luma, 96 - 16, 96);
+  expect(check(100), "threshold: 96 changed blocks (2%) go out");
+  expect(!check(100), "threshold: and become the reference");
+
+  motion_gate_set_threshold(0);
+  expect(check(100), "threshold: 0% sends identical frames");
+  motion_gate_set_threshold(100);
+  memset(frame.luma, 200, 4799);
+  expect(!check(100), "threshold: 100% holds a frame with one block unchanged");
+}
+
+static void keepaliveCheck() {
+  restart(2, 2);
+  fill(640, 480, 48);
+  expect(check(100), "keepalive: first frame goes out");
+  unsigned before = stat("motion_keepalives");
+  int sent = 0;
+  for (int i = 0; i < 19; i++) {
+    sent += check(100);  // Up to 1.9 s after the last one sent
+  }
+  expect(sent == 0, "keepalive: still frames held for 1.9 s");
+  expect(motion_gate_held_within(50 * 1000), "keepalive: held_within sees the last skip");
+  expect(check(100), "keepalive: a still frame goes out after 2 s");
+  expect(stat("motion_keepalives") == before + 1, "keepalive: counted as a keepalive");
+  expect(!check(100), "keepalive: the period restarts from it");
+  expect(motion_gate_hold_us() == 2 * 1000000LL, "keepalive: hold_us is the period");
+}
+
+static void driftCheck() {
+  // +8 per frame: never more than 12 from the previous frame, but it adds
+  // up against the last frame sent
+  restart(2, 60);
+  fill(640, 480, 80);
+  expect(check(100), "drift: reference frame goes out");
+  memset(frame.luma, 80 + 8, sizeof(frame.luma));
+  expect(!check(100), "drift: +8 against the last sent frame is held");
+  memset(frame.luma, 80 + 16, sizeof(frame.luma));
+  expect(check(100), "drift: +16 against it goes out, though only +8 from the previous frame");
+  memset(frame.luma, 80 + 24, sizeof(frame.luma));
+  expect(!check(100), "drift: +24 is only +8 against the new reference");
+  memset(frame.luma, 80 + 32, sizeof(frame.luma));
+  expect(check(100), "drift: +32 goes out");
+}
+
+static void resizeCheck() {
+  restart(2, 60);
+  fill(640, 480, 120);
+  check(100);
+  expect(!check(100), "resize: VGA reference held");
+
+  // Same picture at a new framesize: the old reference cannot be compared
+  fill(320, 240, 120);
+  expect(check(100), "resize: first QVGA frame goes out");
+  expect(!check(100), "resize: identical QVGA frame is held");
+  frame.luma[0] = 200;
+  expect(!check(100), "resize: one changed block of 1200 is held");
+
+  // An ROI gives an output size no framesize has: 50x38 blocks
+  fill(400, 304, 120);
+  expect(check(100), "resize: first frame after an ROI change goes out");
+  frame.luma[0] = 200;
+  expect(!check(100), "resize: one changed block of 1900 is held");
+  memset(frame.luma + 50 * 37, 160, 50);
+  expect(check(100), "resize: 51 changed blocks (2.7%) go out");
+  expect(!check(100), "resize: and is the new reference");
+
+  fill(640, 480, 120);
+  expect(check(100), "resize: back to VGA goes out");
+  expect(!check(100), "resize: and is the new reference");
+}
+
+static void edgeCheck() {
+  restart(2, 60);
+  fill(640, 480, 30);
+  check(100);
+  unsigned skipped = stat("motion_skipped");
+  frame.corrupt = true;
+  expect(check(100), "edge: a frame that does not decode goes out");
+  expect(stat("motion_skipped") == skipped, "edge: and is not counted as skipped");
+
+  motion_gate_set_enabled(0);
+  fill(640, 480, 30);
+  expect(check(100) && check(100), "edge: every frame goes out when disabled");
+  expect(motion_gate_hold_us() == 0 && !motion_gate_held_within(60 * 1000000LL), "edge: nothing held when disabled");
+
+  expect(!motion_gate_set_threshold(101) && !motion_gate_set_keepalive(0) && !motion_gate_set_keepalive(61) && !motion_gate_set_enabled(2),
+         "edge: out-of-range settings are refused");
+}
+
+int main() {
+  thresholdCheck();
+  keepaliveCheck();
+  driftCheck();
+  resizeCheck();
+  edgeCheck();
+  printf(failures ? "%d check(s) failed\n" : "all checks passed\n", failures);
+  return failures ? 1 : 0;
+}
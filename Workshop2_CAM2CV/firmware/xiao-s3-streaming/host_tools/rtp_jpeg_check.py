@@ -0,0 +1,167 @@
+"""Round-trip check for the firmware's RFC 2435 packetiser (src/rtp_jpeg.cpp).
+
+Encodes test JPEGs the way the OV2640 makes them (baseline, standard Huffman
+tables, 4:2:0 or 4:2:2, with and without restart markers), splits each into
+packets with rtp_jpeg_pack (the firmware's own code, built for this machine),
+rebuilds the JPEG from the packets with cv-modules' jpeg_headers(), and
+checks that it decodes to exactly the same pixels as the original. It also
+checks the RTP headers (sequence, marker, fragment offsets) and that JPEGs
+RFC 2435 cannot carry are refused. Exits non-zero on any failure.
+
+    g++ -std=c++11 -O2 -I../src rtp_jpeg_pack.cpp ../src/rtp_jpeg.cpp -o rtp_jpeg_pack
+    python rtp_jpeg_check.py ./rtp_jpeg_pack
+"""
+
+from __future__ import annotations
+
+import os
+import struct
+import subprocess
+import sys
+import tempfile
+
+import cv2
+import numpy as np
+
+sys.path.insert(0, os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "..", "..", "cv-modules"))
+from utils.rtp_client import RTP_JPEG_PAYLOAD_TYPE, jpeg_headers  # noqa: E402
+
+
+def test_image(width: int, height: int) -> np.ndarray:
+    """Gradients plus noise: every block has coefficients to code."""
+    rng = np.random.default_rng(2435)
+    y, x = np.mgrid[0:height, 0:width]
+    image = np.stack([x * 255 // width, y * 255 // height, (x + y) * 255 // (width + height)], axis=2)
+    image = image + rng.integers(-40, 40, image.shape)
+    return np.clip(image, 0, 255).astype(np.uint8)
+
+
+def encode(image: np.ndarray, sampling: int, restart: int = 0, progressive: bool = False) -> bytes:
+    params = [cv2.IMWRITE_JPEG_QUALITY, 80, cv2.IMWRITE_JPEG_SAMPLING_FACTOR, sampling, cv2.IMWRITE_JPEG_RST_INTERVAL, restart]
+    if progressive:
+        params += [cv2.IMWRITE_JPEG_PROGRESSIVE, 1]
+    ok, jpg = cv2.imencode(".jpg", image, params)
+    assert ok
+    return jpg.tobytes()
+
+
+def pack(packer: str, jpg: bytes, packet_size: int) -> tuple[int, list]:
+    with tempfile.NamedTemporaryFile(suffix=".jpg", delete=False) as f:
+        f.write(jpg)
+    try:
+        result = subprocess.run([packer, f.name, str(packet_size)], capture_output=True)
+    finally:
+        os.unlink(f.name)
+    packets = []
+    pos = 0
+    while pos < len(result.stdout):
+        length = struct.unpack_from(">H", result.stdout, pos)[0]
+        packets.append(result.stdout[pos + 2 : pos + 2 + length])
+        pos += 2 + length
+    return result.returncode, packets
+
+
+def scan_of(jpg: bytes) -> bytes:
+    """Entropy-coded data between the SOS header and the last EOI."""
+    sos = jpg.index(b"\xff\xda")
+    start = sos + 2 + struct.unpack_from(">H", jpg, sos + 2)[0]
+    return jpg[start : jpg.rindex(b"\xff\xd9")]
+
+
+def rebuild(packets: list, packet_size: int) -> tuple[bytes, bytes, int, int]:
+    """Reassembles one frame as rtp_client.RTPJpegStream.jpegs() does: the JPEG, its scan, type and restart interval."""
+    data = bytearray()
+    headers = b""
+    first_seq = struct.unpack_from(">H", packets[0], 2)[0]
+    first_ts = struct.unpack_from(">I", packets[0], 4)[0]
+    for i, packet in enumerate(packets):
+        assert len(packet) <= packet_size, f"packet {i} is {len(packet)} bytes"
+        assert packet[0] == 0x80 and packet[1] & 0x7F == RTP_JPEG_PAYLOAD_TYPE, f"packet {i}: bad RTP header"
+        assert bool(packet[1] & 0x80) == (i == len(packets) - 1), f"packet {i}: marker bit"
+        seq, timestamp = struct.unpack_from(">HI", packet, 2)
+        assert seq == (first_seq + i) & 0xFFFF and timestamp == first_ts, f"packet {i}: sequence or timestamp"
+
+        pos = 12
+        offset = int.from_bytes(packet[pos + 1 : pos + 4], "big")
+        jpeg_type, q, width8, height8 = packet[pos + 4 : pos + 8]
+        pos += 8
+        restart_interval = 0
+        if jpeg_type >= 64:
+            restart_interval, flags = struct.unpack_from(">HH", packet, pos)
+            assert flags == 0xFFFF, f"packet {i}: restart F/L/count"
+            pos += 4
+        if offset == 0:
+            assert i == 0 and q == 255, "tables must come in-band with the first packet"
+            length = struct.unpack_from(">H", packet, pos + 2)[0]
+            tables = packet[pos + 4 : pos + 4 + length]
+            pos += 4 + length
+            qtables = [tables[j : j + 64] for j in range(0, length, 64)]
+            headers = jpeg_headers(jpeg_type, width8 * 8, height8 * 8, qtables, restart_interval)
+        assert offset == len(data), f"packet {i}: offset {offset}, expected {len(data)}"
+        data += packet[pos:]
+    return headers + bytes(data) + b"\xff\xd9", bytes(data), jpeg_type, restart_interval
+
+
+def decode(jpg: bytes) -> np.ndarray:
+    image = cv2.imdecode(np.frombuffer(jpg, dtype=np.uint8), cv2.IMREAD_COLOR)
+    assert image is not None, "does not decode"
+    return image
+
+
+def roundtrip(packer: str, name: str, jpg: bytes, packet_size: int, expect_type: int, expect_restart: bool) -> bool:
+    code, packets = pack(packer, jpg, packet_size)
+    try:
+        assert code == 0, f"rtp_jpeg_pack exited {code}"
+        rebuilt, scan, jpeg_type, restart_interval = rebuild(packets, packet_size)
+        assert jpeg_type == expect_type, f"type {jpeg_type}, expected {expect_type}"
+        assert (restart_interval > 0) == expect_restart, f"restart interval {restart_interval}"
+        # Decoders forgive a stray EOI or lost tail bytes; the scan itself must match
+        assert scan == scan_of(jpg), f"scan is {len(scan)} bytes, expected {len(scan_of(jpg))}"
+        if expect_restart:
+            assert b"\xff\xd0" in scan, "no RST markers in the scan"
+        original = decode(jpg)
+        assert np.array_equal(decode(rebuilt), original), "decodes differently from the original"
+    except AssertionError as e:
+        print(f"FAIL {name}: {e}")
+        return False
+    print(f"ok   {name}: {len(jpg)} bytes, {len(packets)} packets, type {jpeg_type}")
+    return True
+
+
+def refused(packer: str, name: str, jpg: bytes) -> bool:
+    code, packets = pack(packer, jpg, 1400)
+    if code != 2 or packets:
+        print(f"FAIL {name}: expected rtp_jpeg_pack to refuse it (exit {code}, {len(packets)} packets)")
+        return False
+    print(f"ok   {name}: refused")
+    return True
+
+
+def main() -> int:
+    if len(sys.argv) != 2:
+        print(f"usage: {sys.argv[0]} path/to/rtp_jpeg_pack")
+        return 1
+    packer = sys.argv[1]
+    s420 = cv2.IMWRITE_JPEG_SAMPLING_FACTOR_420
+    s422 = cv2.IMWRITE_JPEG_SAMPLING_FACTOR_422
+    vga = test_image(640, 480)
+    qvga = test_image(320, 240)
+
+    passed = [
+        roundtrip(packer, "4:2:0", encode(vga, s420), 1400, 1, False),
+        roundtrip(packer, "4:2:2", encode(vga, s422), 1400, 0, False),
+        roundtrip(packer, "4:2:0 + restart markers", encode(vga, s420, restart=4), 1400, 65, True),
+        roundtrip(packer, "4:2:2 + restart markers, 200-byte packets", encode(qvga, s422, restart=1), 200, 64, True),
+        # The sensor's buffer runs past EOI; the scan must still end at the last FFD9
+        roundtrip(packer, "4:2:0 + padding after EOI", encode(qvga, s420) + bytes(300), 1400, 1, False),
+        refused(packer, "progressive", encode(qvga, s420, progressive=True)),
+        refused(packer, "4:4:4", encode(qvga, cv2.IMWRITE_JPEG_SAMPLING_FACTOR_444)),
+        refused(packer, "truncated", encode(qvga, s420)[:300]),
+    ]
+    failed = passed.count(False)
+    print(f"{len(passed) - failed}/{len(passed)} passed")
+    return 1 if failed else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,68 @@
+/*
+╔══════════════════════════════════════════════════════════════════════════╗
+║                         RTP/JPEG PACKETISER                               ║
+║        Runs the firmware's rtp_jpeg.cpp on a JPEG file, on a computer     ║
+╚══════════════════════════════════════════════════════════════════════════╝
+
+ Splits a JPEG into the same RFC 2435 packets the camera sends, so a
+ receiver can be checked without the board. rtp_jpeg_check.py uses it.
+
+ USAGE:
+ -----
+   rtp_jpeg_pack frame.jpg > packets.bin
+   rtp_jpeg_pack frame.jpg 600 > packets.bin     (packet size, default 1400)
+
+ Output: for each packet a 2-byte big-endian length, then the packet
+ (RTP header included). Exits 2 when rtp_jpeg_parse() rejects the JPEG.
+*/
+
+#include "rtp_jpeg.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define DEFAULT_PACKET_SIZE 1400  // RTP_PACKET_SIZE in rtp_stream.cpp
+#define MAX_JPEG_BYTES (4 * 1024 * 1024)
+
+int main(int argc, char **argv) {
+  if (argc < 2 || argc > 3) {
+    fprintf(stderr, "usage: %s frame.jpg [packet_size]\n", argv[0]);
+    return 1;
+  }
+  size_t packet_size = argc == 3 ? strtoul(argv[2], NULL, 10) : DEFAULT_PACKET_SIZE;
+  // The first packet carries the headers and both quantisation tables
+  if (packet_size < 12 + 8 + 4 + 4 + 128 + 1 || packet_size > 65535) {
+    fprintf(stderr, "packet size must be 157..65535\n");
+    return 1;
+  }
+
+  FILE *in = fopen(argv[1], "rb");
+  if (!in) {
+    perror(argv[1]);
+    return 1;
+  }
+  static uint8_t jpg[MAX_JPEG_BYTES];
+  size_t len = fread(jpg, 1, sizeof(jpg), in);
+  fclose(in);
+
+  rtp_jpeg_t jpeg;
+  if (!rtp_jpeg_parse(jpg, len, &jpeg)) {
+    fprintf(stderr, "%s: not a JPEG RFC 2435 can carry\n", argv[1]);
+    return 2;
+  }
+
+  static uint8_t pkt[65535];
+  size_t offset = 0;
+  size_t len_out;
+  uint16_t seq = 0xFFFE;  // Wraps after two packets, as it will on the board
+  int packets = 0;
+  while ((len_out = rtp_jpeg_packet(&jpeg, &offset, seq++, 90000, 0x12345678, pkt, packet_size)) > 0) {
+    uint8_t prefix[2] = {(uint8_t)(len_out >> 8), (uint8_t)len_out};
+    fwrite(prefix, 1, 2, stdout);
+    fwrite(pkt, 1, len_out, stdout);
+    packets++;
+  }
+  fprintf(stderr, "%ux%u type %u, restart interval %u, %u tables, scan %u bytes, %d packets\n", jpeg.width, jpeg.height, jpeg.type, jpeg.restart_interval,
+          jpeg.qtable_count, (unsigned)jpeg.scan_len, packets);
+  return 0;
+}
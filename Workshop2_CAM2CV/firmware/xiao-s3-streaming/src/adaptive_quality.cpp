@@ -0,0 +1,241 @@
+// adaptive_quality.cpp
+// Hysteresis controller that trades JPEG quality and frame size for frame rate.
+#include "adaptive_quality.h"
+
+#include <stdio.h>
+#include "esp_camera.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+
+#include "frame_hub.h"
+#include "motion_gate.h"
+#include "sensor_roi.h"
+
+#if defined(ARDUINO_ARCH_ESP32) && defined(CONFIG_ARDUHAL_ESP_LOG)
+#include "esp32-hal-log.h"
+#endif
+
+#define ADAPTIVE_WINDOW_US         1000000
+#define ADAPTIVE_BUSY_HIGH         0.85f   // A viewer sending this much of the time: the link is full
+#define ADAPTIVE_BUSY_LOW          0.40f   // ...this little: there is room for bigger frames
+#define ADAPTIVE_FPS_MISS          0.80f   // Achieved/target FPS below this is congestion too
+#define ADAPTIVE_MAX_SEND_US       150000  // One frame taking longer than this to send shows as lag
+#define ADAPTIVE_CALM_WINDOWS      5       // Quiet windows in a row before stepping up again
+#define ADAPTIVE_CALM_WINDOWS_MAX  80      // ...doubling up to this after each step up that had to be undone
+#define ADAPTIVE_TRUST_WINDOWS     30      // A step up that held this long resets the doubling
+#define ADAPTIVE_HOLD_WINDOWS      2       // Windows to let a change settle before judging it
+#define ADAPTIVE_QUALITY_STEP_DOWN 4       // Quality numbers: higher = smaller JPEG
+#define ADAPTIVE_QUALITY_STEP_UP   2
+#define ADAPTIVE_QUALITY_WORST     40
+
+// Frame sizes the controller steps through below the one the user chose
+static const framesize_t kFramesizeLadder[] = {
+  FRAMESIZE_QQVGA, FRAMESIZE_QVGA, FRAMESIZE_CIF, FRAMESIZE_VGA, FRAMESIZE_SVGA, FRAMESIZE_XGA, FRAMESIZE_HD, FRAMESIZE_SXGA, FRAMESIZE_UXGA,
+};
+#define LADDER_SIZE (sizeof(kFramesizeLadder) / sizeof(kFramesizeLadder[0]))
+
+static portMUX_TYPE adaptive_lock = portMUX_INITIALIZER_UNLOCKED;
+static adaptive_mode_t mode = ADAPTIVE_OFF;
+
+// Worst viewer of the current window (filled by adaptive_report)
+static uint8_t reports = 0;
+static float worst_busy = 0;
+static float worst_fps_ratio = 1;
+static uint32_t worst_send_us = 0;
+static uint32_t min_kbps = 0;
+static int64_t window_start = 0;
+
+// Where the controller may go (the user's settings are the top) and where it is
+static int best_quality = 12;
+static framesize_t best_framesize = FRAMESIZE_QVGA;
+static int best_rung = 0;  // Rungs 0..best_rung-1 are kFramesizeLadder, best_rung is best_framesize
+static int quality = 12;
+static int rung = 0;
+
+static uint8_t calm_windows = 0;
+static uint8_t calm_needed = ADAPTIVE_CALM_WINDOWS;
+static uint8_t hold_windows = 0;
+static uint8_t windows_since_up = 255;
+static uint32_t changes = 0;
+static float last_busy = 0;
+static uint32_t last_kbps = 0;
+static char last_decision[64] = "off";
+
+static framesize_t rung_framesize(int r) {
+  return r == best_rung ? best_framesize : kFramesizeLadder[r];
+}
+
+static void apply(sensor_t *s, int new_quality, int new_rung, const char *why) {
+  if (new_rung != rung) {
+    s->set_framesize(s, rung_framesize(new_rung));
+    sensor_roi_refresh();  // A smaller frame size caps the ROI's output too
+  }
+  if (new_quality != quality) {
+    s->set_quality(s, new_quality);
+  }
+  snprintf(last_decision, sizeof(last_decision), "q%d fs%d -> q%d fs%d (%s)", quality, rung_framesize(rung), new_quality, rung_framesize(new_rung), why);
+  log_i("Adaptive: %s", last_decision);
+  quality = new_quality;
+  rung = new_rung;
+  changes++;
+  hold_windows = ADAPTIVE_HOLD_WINDOWS;
+}
+
+// Quality first; frame size only once quality is as low as it goes
+static void step_down(sensor_t *s, const char *why) {
+  if (windows_since_up <= ADAPTIVE_HOLD_WINDOWS + 2) {
+    // The last step up did not fit: wait longer before trying it again,
+    // or the stream flips between two settings every few seconds
+    calm_needed = calm_needed * 2 < ADAPTIVE_CALM_WINDOWS_MAX ? calm_needed * 2 : ADAPTIVE_CALM_WINDOWS_MAX;
+    windows_since_up = 255;
+  }
+  if (quality < ADAPTIVE_QUALITY_WORST) {
+    int q = quality + ADAPTIVE_QUALITY_STEP_DOWN;
+    apply(s, q < ADAPTIVE_QUALITY_WORST ? q : ADAPTIVE_QUALITY_WORST, rung, why);
+  } else if (mode == ADAPTIVE_FRAMESIZE && rung > 0 && s->pixformat == PIXFORMAT_JPEG) {
+    apply(s, quality, rung - 1, why);
+  }
+}
+
+// The same ladder in reverse: frame size back first, then quality
+static void step_up(sensor_t *s) {
+  windows_since_up = 0;
+  if (rung < best_rung) {
+    apply(s, quality, rung + 1, "link has room");
+  } else if (quality > best_quality) {
+    int q = quality - ADAPTIVE_QUALITY_STEP_UP;
+    apply(s, q > best_quality ? q : best_quality, rung, "link has room");
+  }
+}
+
+void adaptive_set_mode(adaptive_mode_t new_mode) {
+  sensor_t *s = esp_camera_sensor_get();
+  if (!s) {
+    return;
+  }
+  if (new_mode == ADAPTIVE_OFF && mode != ADAPTIVE_OFF) {
+    // Hand the user's own settings back
+    if (rung != best_rung) {
+      s->set_framesize(s, best_framesize);
+      sensor_roi_refresh();
+    }
+    if (quality != best_quality) {
+      s->set_quality(s, best_quality);
+    }
+  }
+
+  taskENTER_CRITICAL(&adaptive_lock);
+  mode = new_mode;
+  best_quality = s->status.quality;
+  best_framesize = s->status.framesize;
+  best_rung = 0;
+  while (best_rung < (int)LADDER_SIZE && kFramesizeLadder[best_rung] < best_framesize) {
+    best_rung++;
+  }
+  quality = best_quality;
+  rung = best_rung;
+  calm_windows = 0;
+  calm_needed = ADAPTIVE_CALM_WINDOWS;
+  hold_windows = 0;
+  windows_since_up = 255;
+  reports = 0;
+  taskEXIT_CRITICAL(&adaptive_lock);
+
+  snprintf(last_decision, sizeof(last_decision), new_mode ? "limits q%d fs%d" : "off", best_quality, best_framesize);
+}
+
+adaptive_mode_t adaptive_get_mode() {
+  return mode;
+}
+
+void adaptive_report(const adaptive_sample_t *sample) {
+  // No viewer can beat the publish rate: a camera slower than the pacer
+  // (long exposure, large frames) is not a congested link
+  float target_fps = sample->target_fps;
+  frame_hub_stats_t hub;
+  frame_hub_get_stats(&hub);
+  if (target_fps > 0 && hub.fps > 0 && hub.fps < target_fps) {
+    target_fps = hub.fps;
+  }
+  // Frames the motion gate holds back are never published, and the publish
+  // rate above lags a second behind the scene: no FPS verdict while gating.
+  // Two windows: the viewer's and the one the hub rate was measured over.
+  if (motion_gate_held_within(2 * ADAPTIVE_WINDOW_US)) {
+    target_fps = 0;
+  }
+  float fps_ratio = target_fps > 0 ? sample->fps / target_fps : 1;
+
+  taskENTER_CRITICAL(&adaptive_lock);
+  if (reports == 0 || sample->busy > worst_busy) {
+    worst_busy = sample->busy;
+  }
+  if (reports == 0 || fps_ratio < worst_fps_ratio) {
+    worst_fps_ratio = fps_ratio;
+  }
+  if (reports == 0 || sample->send_max_us > worst_send_us) {
+    worst_send_us = sample->send_max_us;
+  }
+  if (sample->sending_kbps && (reports == 0 || min_kbps == 0 || sample->sending_kbps < min_kbps)) {
+    min_kbps = sample->sending_kbps;
+  }
+  reports++;
+  taskEXIT_CRITICAL(&adaptive_lock);
+}
+
+void adaptive_step() {
+  if (mode == ADAPTIVE_OFF) {
+    return;
+  }
+  int64_t now = esp_timer_get_time();
+  if (now - window_start < ADAPTIVE_WINDOW_US) {
+    return;
+  }
+  window_start = now;
+
+  taskENTER_CRITICAL(&adaptive_lock);
+  uint8_t n = reports;
+  float busy = worst_busy;
+  float fps_ratio = worst_fps_ratio;
+  uint32_t send_us = worst_send_us;
+  uint32_t kbps = min_kbps;
+  reports = 0;
+  min_kbps = 0;
+  taskEXIT_CRITICAL(&adaptive_lock);
+
+  if (n == 0) {
+    return;  // Nobody watching
+  }
+  last_busy = busy;
+  last_kbps = kbps;
+  if (windows_since_up < 255 && ++windows_since_up == ADAPTIVE_TRUST_WINDOWS) {
+    calm_needed = ADAPTIVE_CALM_WINDOWS;
+  }
+  if (hold_windows > 0) {
+    hold_windows--;
+    return;
+  }
+
+  sensor_t *s = esp_camera_sensor_get();
+  if (busy > ADAPTIVE_BUSY_HIGH) {
+    calm_windows = 0;
+    step_down(s, "link full");
+  } else if (fps_ratio < ADAPTIVE_FPS_MISS) {
+    calm_windows = 0;
+    step_down(s, "fps below target");
+  } else if (send_us > ADAPTIVE_MAX_SEND_US) {
+    calm_windows = 0;
+    step_down(s, "send latency");
+  } else if (busy < ADAPTIVE_BUSY_LOW && fps_ratio > 0.95f) {
+    if (++calm_windows >= calm_needed) {
+      calm_windows = 0;
+      step_up(s);
+    }
+  } else {
+    calm_windows = 0;  // In the dead band: stay put
+  }
+}
+
+int adaptive_status_json(char *p, size_t size) {
+  return snprintf(p, size, ",\"adaptive\":%u,\"adaptive_quality\":%d,\"adaptive_framesize\":%u,\"adaptive_busy\":%.2f,\"adaptive_bw_kbps\":%u,\"adaptive_changes\":%u,\"adaptive_last\":\"%s\"",
+                  mode, quality, rung_framesize(rung), last_busy, last_kbps, changes, last_decision);
+}
@@ -0,0 +1,41 @@
+#pragma once
+// adaptive_quality.h
+// Closed-loop JPEG quality / frame size control for the stream. Every second
+// each viewer reports how long its sends took; when the slowest viewer spends
+// most of its time sending (or falls short of its target FPS, or of the rate
+// frames are published at if the camera is slower) the controller lowers
+// JPEG quality, then frame size, and raises them again only after the link has
+// had room to spare for a while. Enabled from /control?var=adaptive&val=1
+// (quality only) or val=2 (quality and frame size); decisions show in /status.
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct {
+  float busy;             // Fraction of the window the viewer spent in send()
+  float fps;
+  float target_fps;       // Pacer target, 0 = unpaced (capped at the publish rate)
+  uint32_t sending_kbps;  // Throughput while sending: what the link accepted
+  uint32_t frame_bytes;   // Average frame size
+  uint32_t send_max_us;
+} adaptive_sample_t;
+
+typedef enum {
+  ADAPTIVE_OFF = 0,
+  ADAPTIVE_QUALITY = 1,    // set_quality only
+  ADAPTIVE_FRAMESIZE = 2,  // set_quality, then set_framesize
+} adaptive_mode_t;
+
+// Enabling (or calling again after a manual quality/framesize change) takes
+// the sensor's current settings as the best the controller may go back to.
+void adaptive_set_mode(adaptive_mode_t mode);
+adaptive_mode_t adaptive_get_mode();
+
+// Stream senders, once per statistics window.
+void adaptive_report(const adaptive_sample_t *sample);
+
+// Capture task, between frames: decides at most once per second.
+void adaptive_step();
+
+// ,"adaptive":...,... fields appended to /status; returns their length.
+int adaptive_status_json(char *p, size_t size);
@@ -19,8 +19,16 @@
 #include "img_converters.h"
 #include "fb_gfx.h"
 #include "esp32-hal-ledc.h"
+#include "freertos/queue.h"
 #include "sdkconfig.h"
 #include "camera_index.h"
+#include "adaptive_quality.h"
+#include "frame_hub.h"
+#include "motion_gate.h"
+#include "rtp_stream.h"
+#include "sensor_roi.h"
+#include "stream_clients.h"
+#include "ws_stream.h"
 
 #if defined(ARDUINO_ARCH_ESP32) && defined(CONFIG_ARDUHAL_ESP_LOG)
 #include "esp32-hal-log.h"
@@ -68,10 +76,11 @@ typedef struct {
   size_t len;
 } jpg_chunking_t;
 
-#define PART_BOUNDARY "123456789000000000000987654321"
-static const char *_STREAM_CONTENT_TYPE = "multipart/x-mixed-replace;boundary=" PART_BOUNDARY;
-static const char *_STREAM_BOUNDARY = "\r\n--" PART_BOUNDARY "\r\n";
-static const char *_STREAM_PART = "Content-Type: image/jpeg\r\nContent-Length: %u\r\nX-Timestamp: %d.%06d\r\n\r\n";
+#if CONFIG_ESP_FACE_DETECT_ENABLED
+#define STREAM_PROCESS_STACK 8192
+#else
+#define STREAM_PROCESS_STACK 4096
+#endif
 
 httpd_handle_t stream_httpd = NULL;
 httpd_handle_t camera_httpd = NULL;
@@ -254,18 +263,67 @@ void enable_led(bool en) {  // Turn LED On or Off
 }
 #endif
 
+// While the stream pipeline runs, snapshots come from the frame hub's ring of
+// recent frames: no waiting for a new frame, and no second esp_camera_fb_get()
+// taking a sensor buffer away from the stream. ?seq=N returns a frame seen
+// earlier (X-Frame-Seq of a stream part or snapshot) while it is still held.
+#define SNAPSHOT_MAX_AGE_US 500000  // An older newest frame means the pipeline is idle: capture one
+
+// ESP_OK with *frame NULL: nothing recent, capture a frame. ESP_FAIL: already answered.
+static esp_err_t snapshot_acquire(httpd_req_t *req, hub_frame_t **frame) {
+  char query[32];
+  char value[12];
+
+  *frame = NULL;
+  if (httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK && httpd_query_key_value(query, "seq", value, sizeof(value)) == ESP_OK) {
+    *frame = frame_hub_acquire_seq(strtoul(value, NULL, 10));
+    if (!*frame) {
+      httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, "Frame no longer held");
+      return ESP_FAIL;
+    }
+    return ESP_OK;
+  }
+  // With motion gating a still scene publishes nothing new: the newest frame is still current
+  *frame = frame_hub_acquire_latest(SNAPSHOT_MAX_AGE_US + motion_gate_hold_us());
+  return ESP_OK;
+}
+
 static esp_err_t bmp_handler(httpd_req_t *req) {
   camera_fb_t *fb = NULL;
+  camera_fb_t ring_fb;
+  hub_frame_t *frame = NULL;
   esp_err_t res = ESP_OK;
 #if ARDUHAL_LOG_LEVEL >= ARDUHAL_LOG_LEVEL_INFO
   uint64_t fr_start = esp_timer_get_time();
 #endif
-  fb = esp_camera_fb_get();
+  if (snapshot_acquire(req, &frame) != ESP_OK) {
+    return ESP_FAIL;
+  }
+  if (frame) {
+    // frame2bmp() decodes JPEG too; describe the ring frame as a frame buffer
+    memset(&ring_fb, 0, sizeof(ring_fb));
+    ring_fb.buf = frame->buf;
+    ring_fb.len = frame->len;
+    ring_fb.width = frame->width;
+    ring_fb.height = frame->height;
+    ring_fb.format = PIXFORMAT_JPEG;
+    ring_fb.timestamp = frame->timestamp;
+    fb = &ring_fb;
+  } else {
+    fb = esp_camera_fb_get();
+  }
   if (!fb) {
     log_e("Camera capture failed");
     httpd_resp_send_500(req);
     return ESP_FAIL;
   }
+  if (!frame) {
+    // With an ROI the driver's width and height are those of the frame size
+    uint16_t width, height;
+    sensor_roi_frame_size(fb, &width, &height);
+    fb->width = width;
+    fb->height = height;
+  }
 
   httpd_resp_set_type(req, "image/x-windows-bmp");
   httpd_resp_set_hdr(req, "Content-Disposition", "inline; filename=capture.bmp");
@@ -274,11 +332,20 @@ static esp_err_t bmp_handler(httpd_req_t *req) {
   char ts[32];
   snprintf(ts, 32, "%lld.%06ld", fb->timestamp.tv_sec, fb->timestamp.tv_usec);
   httpd_resp_set_hdr(req, "X-Timestamp", (const char *)ts);
+  char seq[12];
+  if (frame) {
+    snprintf(seq, sizeof(seq), "%u", frame->seq);
+    httpd_resp_set_hdr(req, "X-Frame-Seq", (const char *)seq);
+  }
 
   uint8_t *buf = NULL;
   size_t buf_len = 0;
   bool converted = frame2bmp(fb, &buf, &buf_len);
-  esp_camera_fb_return(fb);
+  if (frame) {
+    frame_hub_release(frame);
+  } else {
+    esp_camera_fb_return(fb);
+  }
   if (!converted) {
     log_e("BMP Conversion failed");
     httpd_resp_send_500(req);
@@ -312,6 +379,30 @@ static esp_err_t capture_handler(httpd_req_t *req) {
   int64_t fr_start = esp_timer_get_time();
 #endif
 
+  hub_frame_t *frame = NULL;
+  if (snapshot_acquire(req, &frame) != ESP_OK) {
+    return ESP_FAIL;
+  }
+  if (frame) {
+    // Already JPEG, and annotated when face detection is on
+    httpd_resp_set_type(req, "image/jpeg");
+    httpd_resp_set_hdr(req, "Content-Disposition", "inline; filename=capture.jpg");
+    httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
+    char ts[32];
+    snprintf(ts, 32, "%lld.%06ld", frame->timestamp.tv_sec, frame->timestamp.tv_usec);
+    httpd_resp_set_hdr(req, "X-Timestamp", (const char *)ts);
+    char seq[12];
+    snprintf(seq, sizeof(seq), "%u", frame->seq);
+    httpd_resp_set_hdr(req, "X-Frame-Seq", (const char *)seq);
+    res = httpd_resp_send(req, (const char *)frame->buf, frame->len);
+#if ARDUHAL_LOG_LEVEL >= ARDUHAL_LOG_LEVEL_INFO
+    int64_t fr_end = esp_timer_get_time();
+#endif
+    log_i("JPG: %uB %ums (frame %u)", (uint32_t)(frame->len), (uint32_t)((fr_end - fr_start) / 1000), frame->seq);
+    frame_hub_release(frame);
+    return res;
+  }
+
 #if CONFIG_LED_ILLUMINATOR_ENABLED
   enable_led(true);
   vTaskDelay(150 / portTICK_PERIOD_MS);  // The LED needs to be turned on ~150ms before the call to esp_camera_fb_get()
@@ -465,257 +556,397 @@ static esp_err_t capture_handler(httpd_req_t *req) {
 #endif
 }
 
-static esp_err_t stream_handler(httpd_req_t *req) {
-  camera_fb_t *fb = NULL;
-  struct timeval _timestamp;
-  esp_err_t res = ESP_OK;
-  size_t _jpg_buf_len = 0;
-  uint8_t *_jpg_buf = NULL;
-  char *part_buf[128];
+// The stream pipeline: every frame is captured, processed (face detection,
+// when enabled) and encoded once for all viewers by three tasks joined by
+// bounded queues, so frame N+1 is being captured and annotated while frame N
+// is encoded and the viewers' sender tasks (stream_clients.cpp) send frame
+// N-1. The frame rate is then set by the slowest stage instead of the sum of
+// all of them. Wi-Fi and lwIP run on core 0, so the detector gets core 1 to
+// itself and encoding shares core 0 with the network.
+#define PIPELINE_CAPTURE_CORE 1
+#define PIPELINE_PROCESS_CORE 1
+#define PIPELINE_ENCODE_CORE  0
+#define PIPELINE_STAGE_STACK  4096
+// One frame waiting for the detector is enough: with the default two frame
+// buffers a deeper queue would only hold older frames. Frames waiting for
+// the encoder may already be RGB copies, so two of them are allowed.
+#define PIPELINE_PROCESS_QUEUE 1
+#define PIPELINE_ENCODE_QUEUE  2
+
+typedef struct {
+  camera_fb_t *fb;  // Sensor buffer, until a stage gives it back
+  uint8_t *rgb;     // Annotated RGB888 copy to encode instead of fb (malloc'd)
+  uint16_t width;
+  uint16_t height;
+  struct timeval timestamp;
+  int64_t queued;  // When it entered the current queue
 #if CONFIG_ESP_FACE_DETECT_ENABLED
-#if ARDUHAL_LOG_LEVEL >= ARDUHAL_LOG_LEVEL_INFO
-  bool detected = false;
-  int64_t fr_ready = 0;
-  int64_t fr_recognize = 0;
-  int64_t fr_encode = 0;
-  int64_t fr_face = 0;
-  int64_t fr_start = 0;
-#endif
-  int face_id = 0;
-  size_t out_len = 0, out_width = 0, out_height = 0;
-  uint8_t *out_buf = NULL;
-  bool s = false;
-#if TWO_STAGE
-  HumanFaceDetectMSR01 s1(0.1F, 0.5F, 10, 0.2F);
-  HumanFaceDetectMNP01 s2(0.5F, 0.3F, 5);
-#else
-  HumanFaceDetectMSR01 s1(0.3F, 0.5F, 10, 0.2F);
-#endif
+  bool detected;
+  int face_id;
 #endif
+} pipeline_frame_t;
+
+typedef enum {
+  STAGE_CAPTURE,
+  STAGE_PROCESS,
+  STAGE_ENCODE,
+  STAGE_COUNT
+} pipeline_stage_t;
 
-  static int64_t last_frame = 0;
-  if (!last_frame) {
-    last_frame = esp_timer_get_time();
+// Written only by the stage's own task; /stats reads whole words.
+typedef struct {
+  int64_t window_start;
+  int64_t busy_us;
+  uint32_t frames;
+  uint32_t window_max_us;
+  uint32_t avg_us;  // Per frame, over the last full second
+  uint32_t max_us;
+  uint32_t wait_us;  // Average time frames spent queued in front of the stage
+  uint32_t window_wait_us;
+  uint8_t load;  // Percent of the last second the stage was busy
+} stage_stats_t;
+
+static const char *const kStageNames[STAGE_COUNT] = {"capture", "process", "encode"};
+static stage_stats_t stage_stats[STAGE_COUNT];
+static QueueHandle_t process_queue = NULL;
+static QueueHandle_t encode_queue = NULL;
+static uint8_t process_queue_peak = 0;  // Deepest since the last /stats
+static uint8_t encode_queue_peak = 0;
+static uint32_t pipeline_dropped = 0;
+
+static void stage_done(pipeline_stage_t stage, int64_t start, int64_t queued) {
+  stage_stats_t *st = &stage_stats[stage];
+  int64_t now = esp_timer_get_time();
+  uint32_t took = now - start;
+  st->busy_us += took;
+  st->window_wait_us += queued ? start - queued : 0;
+  st->frames++;
+  if (took > st->window_max_us) {
+    st->window_max_us = took;
   }
+  if (now - st->window_start >= 1000000) {
+    st->avg_us = st->busy_us / st->frames;
+    st->wait_us = st->window_wait_us / st->frames;
+    st->max_us = st->window_max_us;
+    int64_t load = st->busy_us * 100 / (now - st->window_start);
+    st->load = load > 100 ? 100 : load;
+    st->window_start = now;
+    st->busy_us = 0;
+    st->window_wait_us = 0;
+    st->window_max_us = 0;
+    st->frames = 0;
+  }
+}
 
-  res = httpd_resp_set_type(req, _STREAM_CONTENT_TYPE);
-  if (res != ESP_OK) {
-    return res;
+static void pipeline_push(QueueHandle_t queue, uint8_t *peak, pipeline_frame_t *frame) {
+  frame->queued = esp_timer_get_time();
+  xQueueSend(queue, frame, portMAX_DELAY);  // Full: the next stage is the bottleneck, wait for it
+  uint8_t depth = uxQueueMessagesWaiting(queue);
+  if (depth > *peak) {
+    *peak = depth;
   }
+}
 
-  httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
-  httpd_resp_set_hdr(req, "X-Framerate", "60");
+static void pipeline_drop(pipeline_frame_t *frame) {
+  if (frame->fb) {
+    esp_camera_fb_return(frame->fb);
+  }
+  free(frame->rgb);
+  pipeline_dropped++;
+}
 
-#if CONFIG_LED_ILLUMINATOR_ENABLED
-  isStreaming = true;
-  enable_led(true);
-#endif
+// Grabs frames while anybody watches; sleeps otherwise.
+static void capture_stage_task(void *arg) {
+  bool streaming = false;
+  pipeline_frame_t frame;
 
   while (true) {
-#if CONFIG_ESP_FACE_DETECT_ENABLED
-#if ARDUHAL_LOG_LEVEL >= ARDUHAL_LOG_LEVEL_INFO
-    detected = false;
+    if (!frame_hub_wait_for_consumers(streaming ? 0 : portMAX_DELAY)) {
+      streaming = false;
+#if CONFIG_LED_ILLUMINATOR_ENABLED
+      isStreaming = false;
+      enable_led(false);
 #endif
-    face_id = 0;
+      continue;
+    }
+    if (!streaming) {
+      streaming = true;
+#if CONFIG_LED_ILLUMINATOR_ENABLED
+      isStreaming = true;
+      enable_led(true);
 #endif
+    }
+    adaptive_step();  // Sensor changes land between frames
 
-    fb = esp_camera_fb_get();
-    if (!fb) {
+    int64_t start = esp_timer_get_time();
+    memset(&frame, 0, sizeof(frame));
+    frame.fb = esp_camera_fb_get();
+    if (!frame.fb) {
       log_e("Camera capture failed");
-      res = ESP_FAIL;
-    } else {
-      _timestamp.tv_sec = fb->timestamp.tv_sec;
-      _timestamp.tv_usec = fb->timestamp.tv_usec;
-#if CONFIG_ESP_FACE_DETECT_ENABLED
-#if ARDUHAL_LOG_LEVEL >= ARDUHAL_LOG_LEVEL_INFO
-      fr_start = esp_timer_get_time();
-      fr_ready = fr_start;
-      fr_encode = fr_start;
-      fr_recognize = fr_start;
-      fr_face = fr_start;
-#endif
-      if (!detection_enabled || fb->width > 400) {
-#endif
-        if (fb->format != PIXFORMAT_JPEG) {
-          bool jpeg_converted = frame2jpg(fb, 80, &_jpg_buf, &_jpg_buf_len);
-          esp_camera_fb_return(fb);
-          fb = NULL;
-          if (!jpeg_converted) {
-            log_e("JPEG compression failed");
-            res = ESP_FAIL;
-          }
-        } else {
-          _jpg_buf_len = fb->len;
-          _jpg_buf = fb->buf;
-        }
+      vTaskDelay(pdMS_TO_TICKS(10));  // Don't spin on a failing sensor
+      continue;
+    }
+    sensor_roi_frame_size(frame.fb, &frame.width, &frame.height);
+    frame.timestamp.tv_sec = frame.fb->timestamp.tv_sec;
+    frame.timestamp.tv_usec = frame.fb->timestamp.tv_usec;
+    stage_done(STAGE_CAPTURE, start, 0);
+    pipeline_push(process_queue, &process_queue_peak, &frame);
+  }
+}
+
+// Face detection and boxes; frames pass straight through when it is off.
+static void process_stage_task(void *arg) {
+  pipeline_frame_t frame;
 #if CONFIG_ESP_FACE_DETECT_ENABLED
-      } else {
-        if (fb->format == PIXFORMAT_RGB565
-#if CONFIG_ESP_FACE_RECOGNITION_ENABLED
-            && !recognition_enabled
-#endif
-        ) {
-#if ARDUHAL_LOG_LEVEL >= ARDUHAL_LOG_LEVEL_INFO
-          fr_ready = esp_timer_get_time();
-#endif
 #if TWO_STAGE
-          std::list<dl::detect::result_t> &candidates = s1.infer((uint16_t *)fb->buf, {(int)fb->height, (int)fb->width, 3});
-          std::list<dl::detect::result_t> &results = s2.infer((uint16_t *)fb->buf, {(int)fb->height, (int)fb->width, 3}, candidates);
+  HumanFaceDetectMSR01 s1(0.1F, 0.5F, 10, 0.2F);
+  HumanFaceDetectMNP01 s2(0.5F, 0.3F, 5);
 #else
-          std::list<dl::detect::result_t> &results = s1.infer((uint16_t *)fb->buf, {(int)fb->height, (int)fb->width, 3});
-#endif
-#if CONFIG_ESP_FACE_DETECT_ENABLED && ARDUHAL_LOG_LEVEL >= ARDUHAL_LOG_LEVEL_INFO
-          fr_face = esp_timer_get_time();
-          fr_recognize = fr_face;
-#endif
-          if (results.size() > 0) {
-            fb_data_t rfb;
-            rfb.width = fb->width;
-            rfb.height = fb->height;
-            rfb.data = fb->buf;
-            rfb.bytes_per_pixel = 2;
-            rfb.format = FB_RGB565;
-#if ARDUHAL_LOG_LEVEL >= ARDUHAL_LOG_LEVEL_INFO
-            detected = true;
+  HumanFaceDetectMSR01 s1(0.3F, 0.5F, 10, 0.2F);
 #endif
-            draw_face_boxes(&rfb, &results, face_id);
-          }
-          s = fmt2jpg(fb->buf, fb->len, fb->width, fb->height, PIXFORMAT_RGB565, 80, &_jpg_buf, &_jpg_buf_len);
-          esp_camera_fb_return(fb);
-          fb = NULL;
-          if (!s) {
-            log_e("fmt2jpg failed");
-            res = ESP_FAIL;
-          }
-#if CONFIG_ESP_FACE_DETECT_ENABLED && ARDUHAL_LOG_LEVEL >= ARDUHAL_LOG_LEVEL_INFO
-          fr_encode = esp_timer_get_time();
-#endif
-        } else {
-          out_len = fb->width * fb->height * 3;
-          out_width = fb->width;
-          out_height = fb->height;
-          out_buf = (uint8_t *)malloc(out_len);
-          if (!out_buf) {
-            log_e("out_buf malloc failed");
-            res = ESP_FAIL;
-          } else {
-            s = fmt2rgb888(fb->buf, fb->len, fb->format, out_buf);
-            esp_camera_fb_return(fb);
-            fb = NULL;
-            if (!s) {
-              free(out_buf);
-              log_e("To rgb888 failed");
-              res = ESP_FAIL;
-            } else {
-#if ARDUHAL_LOG_LEVEL >= ARDUHAL_LOG_LEVEL_INFO
-              fr_ready = esp_timer_get_time();
 #endif
 
-              fb_data_t rfb;
-              rfb.width = out_width;
-              rfb.height = out_height;
-              rfb.data = out_buf;
-              rfb.bytes_per_pixel = 3;
-              rfb.format = FB_BGR888;
-
+  while (true) {
+    xQueueReceive(process_queue, &frame, portMAX_DELAY);
+    int64_t start = esp_timer_get_time();
+#if CONFIG_ESP_FACE_DETECT_ENABLED
+    if (detection_enabled && frame.width <= 400) {
+      camera_fb_t *fb = frame.fb;
+      if (fb->format == PIXFORMAT_RGB565
+#if CONFIG_ESP_FACE_RECOGNITION_ENABLED
+          && !recognition_enabled
+#endif
+      ) {
+        // Boxes are drawn into the sensor buffer; the encoder compresses it
 #if TWO_STAGE
-              std::list<dl::detect::result_t> &candidates = s1.infer((uint8_t *)out_buf, {(int)out_height, (int)out_width, 3});
-              std::list<dl::detect::result_t> &results = s2.infer((uint8_t *)out_buf, {(int)out_height, (int)out_width, 3}, candidates);
+        std::list<dl::detect::result_t> &candidates = s1.infer((uint16_t *)fb->buf, {(int)fb->height, (int)fb->width, 3});
+        std::list<dl::detect::result_t> &results = s2.infer((uint16_t *)fb->buf, {(int)fb->height, (int)fb->width, 3}, candidates);
 #else
-              std::list<dl::detect::result_t> &results = s1.infer((uint8_t *)out_buf, {(int)out_height, (int)out_width, 3});
-#endif
+        std::list<dl::detect::result_t> &results = s1.infer((uint16_t *)fb->buf, {(int)fb->height, (int)fb->width, 3});
+#endif
+        if (results.size() > 0) {
+          fb_data_t rfb;
+          rfb.width = fb->width;
+          rfb.height = fb->height;
+          rfb.data = fb->buf;
+          rfb.bytes_per_pixel = 2;
+          rfb.format = FB_RGB565;
+          frame.detected = true;
+          draw_face_boxes(&rfb, &results, frame.face_id);
+        }
+      } else {
+        // Convert once, give the sensor buffer back for the next capture
+        size_t out_len = fb->width * fb->height * 3;
+        frame.rgb = (uint8_t *)malloc(out_len);
+        if (!frame.rgb) {
+          log_e("out_buf malloc failed");
+          pipeline_drop(&frame);
+          continue;
+        }
+        bool s = fmt2rgb888(fb->buf, fb->len, fb->format, frame.rgb);
+        esp_camera_fb_return(fb);
+        frame.fb = NULL;
+        if (!s) {
+          log_e("To rgb888 failed");
+          pipeline_drop(&frame);
+          continue;
+        }
 
-#if CONFIG_ESP_FACE_DETECT_ENABLED && ARDUHAL_LOG_LEVEL >= ARDUHAL_LOG_LEVEL_INFO
-              fr_face = esp_timer_get_time();
-              fr_recognize = fr_face;
-#endif
+        fb_data_t rfb;
+        rfb.width = frame.width;
+        rfb.height = frame.height;
+        rfb.data = frame.rgb;
+        rfb.bytes_per_pixel = 3;
+        rfb.format = FB_BGR888;
 
-              if (results.size() > 0) {
-#if ARDUHAL_LOG_LEVEL >= ARDUHAL_LOG_LEVEL_INFO
-                detected = true;
+#if TWO_STAGE
+        std::list<dl::detect::result_t> &candidates = s1.infer((uint8_t *)frame.rgb, {(int)frame.height, (int)frame.width, 3});
+        std::list<dl::detect::result_t> &results = s2.infer((uint8_t *)frame.rgb, {(int)frame.height, (int)frame.width, 3}, candidates);
+#else
+        std::list<dl::detect::result_t> &results = s1.infer((uint8_t *)frame.rgb, {(int)frame.height, (int)frame.width, 3});
 #endif
+        if (results.size() > 0) {
+          frame.detected = true;
 #if CONFIG_ESP_FACE_RECOGNITION_ENABLED
-                if (recognition_enabled) {
-                  face_id = run_face_recognition(&rfb, &results);
-#if ARDUHAL_LOG_LEVEL >= ARDUHAL_LOG_LEVEL_INFO
-                  fr_recognize = esp_timer_get_time();
-#endif
-                }
-#endif
-                draw_face_boxes(&rfb, &results, face_id);
-              }
-              s = fmt2jpg(out_buf, out_len, out_width, out_height, PIXFORMAT_RGB888, 90, &_jpg_buf, &_jpg_buf_len);
-              free(out_buf);
-              if (!s) {
-                log_e("fmt2jpg failed");
-                res = ESP_FAIL;
-              }
-#if CONFIG_ESP_FACE_DETECT_ENABLED && ARDUHAL_LOG_LEVEL >= ARDUHAL_LOG_LEVEL_INFO
-              fr_encode = esp_timer_get_time();
-#endif
-            }
+          if (recognition_enabled) {
+            frame.face_id = run_face_recognition(&rfb, &results);
           }
+#endif
+          draw_face_boxes(&rfb, &results, frame.face_id);
         }
       }
-#endif
     }
-    if (res == ESP_OK) {
-      res = httpd_resp_send_chunk(req, _STREAM_BOUNDARY, strlen(_STREAM_BOUNDARY));
-    }
-    if (res == ESP_OK) {
-      size_t hlen = snprintf((char *)part_buf, 128, _STREAM_PART, _jpg_buf_len, _timestamp.tv_sec, _timestamp.tv_usec);
-      res = httpd_resp_send_chunk(req, (const char *)part_buf, hlen);
+#endif
+    stage_done(STAGE_PROCESS, start, frame.queued);
+    pipeline_push(encode_queue, &encode_queue_peak, &frame);
+  }
+}
+
+// JPEG encoding where needed, then one copy into the frame hub.
+static void encode_stage_task(void *arg) {
+  pipeline_frame_t frame;
+  int64_t last_frame = esp_timer_get_time();
+
+  while (true) {
+    xQueueReceive(encode_queue, &frame, portMAX_DELAY);
+    int64_t start = esp_timer_get_time();
+    uint8_t *_jpg_buf = NULL;
+    size_t _jpg_buf_len = 0;
+    bool s = true;
+
+    if (frame.rgb) {
+      s = fmt2jpg(frame.rgb, frame.width * frame.height * 3, frame.width, frame.height, PIXFORMAT_RGB888, 90, &_jpg_buf, &_jpg_buf_len);
+      free(frame.rgb);
+      frame.rgb = NULL;
+    } else if (frame.fb->format != PIXFORMAT_JPEG) {
+      s = frame2jpg(frame.fb, 80, &_jpg_buf, &_jpg_buf_len);
+      esp_camera_fb_return(frame.fb);
+      frame.fb = NULL;
+    } else {
+      _jpg_buf = frame.fb->buf;
+      _jpg_buf_len = frame.fb->len;
     }
-    if (res == ESP_OK) {
-      res = httpd_resp_send_chunk(req, (const char *)_jpg_buf, _jpg_buf_len);
+    if (s) {
+      if (motion_gate_check(_jpg_buf, _jpg_buf_len, frame.width, frame.height)) {
+        frame_hub_publish(_jpg_buf, _jpg_buf_len, frame.width, frame.height, &frame.timestamp);
+      }
+    } else {
+      log_e("JPEG compression failed");
+      pipeline_dropped++;
     }
-    if (fb) {
-      esp_camera_fb_return(fb);
-      fb = NULL;
-      _jpg_buf = NULL;
-    } else if (_jpg_buf) {
+    if (frame.fb) {
+      esp_camera_fb_return(frame.fb);
+    } else {
       free(_jpg_buf);
-      _jpg_buf = NULL;
     }
-    if (res != ESP_OK) {
-      log_e("Send frame failed");
-      break;
+    stage_done(STAGE_ENCODE, start, frame.queued);
+    if (!s) {
+      continue;
     }
-    int64_t fr_end = esp_timer_get_time();
-
-#if CONFIG_ESP_FACE_DETECT_ENABLED && ARDUHAL_LOG_LEVEL >= ARDUHAL_LOG_LEVEL_INFO
-    int64_t ready_time = (fr_ready - fr_start) / 1000;
-    int64_t face_time = (fr_face - fr_ready) / 1000;
-    int64_t recognize_time = (fr_recognize - fr_face) / 1000;
-    int64_t encode_time = (fr_encode - fr_recognize) / 1000;
-    int64_t process_time = (fr_encode - fr_start) / 1000;
-#endif
 
+    int64_t fr_end = esp_timer_get_time();
     int64_t frame_time = fr_end - last_frame;
+    last_frame = fr_end;
     frame_time /= 1000;
 #if ARDUHAL_LOG_LEVEL >= ARDUHAL_LOG_LEVEL_INFO
     uint32_t avg_frame_time = ra_filter_run(&ra_filter, frame_time);
 #endif
     log_i(
-      "MJPG: %uB %ums (%.1ffps), AVG: %ums (%.1ffps)"
+      "MJPG: %uB %ums (%.1ffps), AVG: %ums (%.1ffps), %u/%u/%ums"
 #if CONFIG_ESP_FACE_DETECT_ENABLED
-      ", %u+%u+%u+%u=%u %s%d"
+      " %s%d"
 #endif
       ,
-      (uint32_t)(_jpg_buf_len), (uint32_t)frame_time, 1000.0 / (uint32_t)frame_time, avg_frame_time, 1000.0 / avg_frame_time
+      (uint32_t)(_jpg_buf_len), (uint32_t)frame_time, 1000.0 / (uint32_t)frame_time, avg_frame_time, 1000.0 / avg_frame_time,
+      stage_stats[STAGE_CAPTURE].avg_us / 1000, stage_stats[STAGE_PROCESS].avg_us / 1000, stage_stats[STAGE_ENCODE].avg_us / 1000
 #if CONFIG_ESP_FACE_DETECT_ENABLED
       ,
-      (uint32_t)ready_time, (uint32_t)face_time, (uint32_t)recognize_time, (uint32_t)encode_time, (uint32_t)process_time, (detected) ? "DETECTED " : "", face_id
+      (frame.detected) ? "DETECTED " : "", frame.face_id
 #endif
     );
   }
+}
 
-#if CONFIG_LED_ILLUMINATOR_ENABLED
-  isStreaming = false;
-  enable_led(false);
+static bool pipeline_start() {
+  process_queue = xQueueCreate(PIPELINE_PROCESS_QUEUE, sizeof(pipeline_frame_t));
+  encode_queue = xQueueCreate(PIPELINE_ENCODE_QUEUE, sizeof(pipeline_frame_t));
+  if (!process_queue || !encode_queue) {
+    return false;
+  }
+  // Capture above the other stages so the sensor is never left waiting for a buffer request
+  return xTaskCreatePinnedToCore(capture_stage_task, "capture", PIPELINE_STAGE_STACK, NULL, tskIDLE_PRIORITY + 6, NULL, PIPELINE_CAPTURE_CORE) == pdPASS
+         && xTaskCreatePinnedToCore(process_stage_task, "process", STREAM_PROCESS_STACK, NULL, tskIDLE_PRIORITY + 5, NULL, PIPELINE_PROCESS_CORE) == pdPASS
+         && xTaskCreatePinnedToCore(encode_stage_task, "encode", PIPELINE_STAGE_STACK, NULL, tskIDLE_PRIORITY + 5, NULL, PIPELINE_ENCODE_CORE) == pdPASS;
+}
+
+static int pipeline_stats_json(char *p, size_t size) {
+  char *start = p;
+  char *end = p + size;
+  p += snprintf(p, end - p, "{");
+  for (int i = 0; i < STAGE_COUNT && p < end; i++) {
+    const stage_stats_t *st = &stage_stats[i];
+    p += snprintf(p, end - p, "\"%s\":{\"avg_ms\":%.1f,\"max_ms\":%.1f,\"wait_ms\":%.1f,\"load\":%u},", kStageNames[i], st->avg_us / 1000.0, st->max_us / 1000.0, st->wait_us / 1000.0, st->load);
+  }
+  if (p < end) {
+    p += snprintf(
+      p, end - p, "\"process_queue\":{\"depth\":%u,\"peak\":%u,\"size\":%u},\"encode_queue\":{\"depth\":%u,\"peak\":%u,\"size\":%u},\"dropped\":%u}",
+      (unsigned)uxQueueMessagesWaiting(process_queue), process_queue_peak, PIPELINE_PROCESS_QUEUE, (unsigned)uxQueueMessagesWaiting(encode_queue), encode_queue_peak,
+      PIPELINE_ENCODE_QUEUE, pipeline_dropped
+    );
+  }
+  process_queue_peak = 0;
+  encode_queue_peak = 0;
+  return p < end ? p - start : size - 1;
+}
+
+// ?roi=x,y,w,h (or off) on /roi and /stream. ESP_FAIL: already answered with an error.
+static esp_err_t roi_from_query(httpd_req_t *req) {
+  char query[64];
+  char value[32];
+
+  if (httpd_req_get_url_query_str(req, query, sizeof(query)) != ESP_OK || httpd_query_key_value(query, "roi", value, sizeof(value)) != ESP_OK) {
+    return ESP_OK;
+  }
+  esp_err_t err = sensor_roi_set_str(value);
+  if (err == ESP_OK) {
+    return ESP_OK;
+  }
+  httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
+  // The send itself returns ESP_OK: the caller must still stop here
+  if (err == ESP_ERR_NOT_SUPPORTED) {
+    httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "ROI needs an OV2640 streaming JPEG");
+  } else if (err == ESP_ERR_INVALID_ARG) {
+    httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "ROI is x,y,w,h within 1600x1200, sides of 64 or more");
+  } else {
+    httpd_resp_send_500(req);
+  }
+  return ESP_FAIL;
+}
+
+static esp_err_t stream_handler(httpd_req_t *req) {
+  if (roi_from_query(req) != ESP_OK) {
+    return ESP_FAIL;
+  }
+  return stream_clients_attach(req);
+}
+
+// /stream and /ws viewers both outlive their handler; stop their senders first
+static void stream_close_fn(httpd_handle_t hd, int sockfd) {
+#ifdef CONFIG_HTTPD_WS_SUPPORT
+  ws_stream_close_fn(hd, sockfd);
 #endif
+  stream_clients_close_fn(hd, sockfd);  // Closes the socket
+}
 
-  return res;
+static esp_err_t stats_handler(httpd_req_t *req) {
+  static char json_response[3072];
+
+  frame_hub_stats_t hub;
+  frame_hub_get_stats(&hub);
+
+  char *p = json_response;
+  char *end = json_response + sizeof(json_response) - 2;
+  p += sprintf(
+    p, "{\"capture\":{\"fps\":%.1f,\"frames\":%u,\"dropped\":%u,\"viewers\":%u,\"oldest_seq\":%u,\"newest_seq\":%u},", hub.fps, hub.published, hub.dropped,
+    hub.consumers, hub.oldest_seq, hub.newest_seq
+  );
+  p += sprintf(p, "\"pipeline\":");
+  p += pipeline_stats_json(p, end - p);
+  p += sprintf(p, ",\"clients\":");
+  p += stream_clients_stats_json(p, end - p);
+#ifdef CONFIG_HTTPD_WS_SUPPORT
+  p += snprintf(p, end - p, ",\"ws\":");
+  p += ws_stream_stats_json(p, end - p);
+#endif
+  p += snprintf(p, end - p, ",\"rtp\":");
+  p += rtp_stream_stats_json(p, end - p);
+  p += snprintf(p, end - p, ",\"roi\":");
+  p += sensor_roi_json(p, end - p);
+  *p++ = '}';
+  *p++ = 0;
+  httpd_resp_set_type(req, "application/json");
+  httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
+  return httpd_resp_send(req, json_response, strlen(json_response));
 }
 
 static esp_err_t parse_get(httpd_req_t *req, char **obuf) {
@@ -739,22 +970,8 @@ static esp_err_t parse_get(httpd_req_t *req, char **obuf) {
   return ESP_FAIL;
 }
 
-static esp_err_t cmd_handler(httpd_req_t *req) {
-  char *buf = NULL;
-  char variable[32];
-  char value[32];
-
-  if (parse_get(req, &buf) != ESP_OK) {
-    return ESP_FAIL;
-  }
-  if (httpd_query_key_value(buf, "var", variable, sizeof(variable)) != ESP_OK || httpd_query_key_value(buf, "val", value, sizeof(value)) != ESP_OK) {
-    free(buf);
-    httpd_resp_send_404(req);
-    return ESP_FAIL;
-  }
-  free(buf);
-
-  int val = atoi(value);
+// One /control variable; also applied by /ws control messages. Negative on failure.
+static int set_control(const char *variable, int val) {
   log_i("%s = %d", variable, val);
   sensor_t *s = esp_camera_sensor_get();
   int res = 0;
@@ -762,9 +979,24 @@ static esp_err_t cmd_handler(httpd_req_t *req) {
   if (!strcmp(variable, "framesize")) {
     if (s->pixformat == PIXFORMAT_JPEG) {
       res = s->set_framesize(s, (framesize_t)val);
+      sensor_roi_refresh();
+      adaptive_set_mode(adaptive_get_mode());  // The new size is the controller's ceiling
     }
   } else if (!strcmp(variable, "quality")) {
     res = s->set_quality(s, val);
+    adaptive_set_mode(adaptive_get_mode());
+  } else if (!strcmp(variable, "adaptive")) {
+    if (val < ADAPTIVE_OFF || val > ADAPTIVE_FRAMESIZE) {
+      res = -1;
+    } else {
+      adaptive_set_mode((adaptive_mode_t)val);
+    }
+  } else if (!strcmp(variable, "motion")) {
+    res = motion_gate_set_enabled(val) ? 0 : -1;
+  } else if (!strcmp(variable, "motion_threshold")) {
+    res = motion_gate_set_threshold(val) ? 0 : -1;
+  } else if (!strcmp(variable, "motion_keepalive")) {
+    res = motion_gate_set_keepalive(val) ? 0 : -1;
   } else if (!strcmp(variable, "contrast")) {
     res = s->set_contrast(s, val);
   } else if (!strcmp(variable, "brightness")) {
@@ -844,7 +1076,25 @@ static esp_err_t cmd_handler(httpd_req_t *req) {
     log_i("Unknown command: %s", variable);
     res = -1;
   }
+  return res;
+}
+
+static esp_err_t cmd_handler(httpd_req_t *req) {
+  char *buf = NULL;
+  char variable[32];
+  char value[32];
+
+  if (parse_get(req, &buf) != ESP_OK) {
+    return ESP_FAIL;
+  }
+  if (httpd_query_key_value(buf, "var", variable, sizeof(variable)) != ESP_OK || httpd_query_key_value(buf, "val", value, sizeof(value)) != ESP_OK) {
+    free(buf);
+    httpd_resp_send_404(req);
+    return ESP_FAIL;
+  }
+  free(buf);
 
+  int res = set_control(variable, atoi(value));
   if (res < 0) {
     return httpd_resp_send_500(req);
   }
@@ -858,7 +1108,7 @@ static int print_reg(char *p, sensor_t *s, uint16_t reg, uint32_t mask) {
 }
 
 static esp_err_t status_handler(httpd_req_t *req) {
-  static char json_response[1024];
+  static char json_response[1536];
 
   sensor_t *s = esp_camera_sensor_get();
   char *p = json_response;
@@ -924,6 +1174,8 @@ static esp_err_t status_handler(httpd_req_t *req) {
 #else
   p += sprintf(p, ",\"led_intensity\":%d", -1);
 #endif
+  p += adaptive_status_json(p, json_response + sizeof(json_response) - 2 - p);
+  p += motion_gate_status_json(p, json_response + sizeof(json_response) - 2 - p);
 #if CONFIG_ESP_FACE_DETECT_ENABLED
   p += sprintf(p, ",\"face_detect\":%u", detection_enabled);
 #if CONFIG_ESP_FACE_RECOGNITION_ENABLED
@@ -1098,6 +1350,21 @@ static esp_err_t win_handler(httpd_req_t *req) {
   return httpd_resp_send(req, NULL, 0);
 }
 
+// /resolution for streaming: /roi?roi=x,y,w,h moves the window while viewers
+// stay connected, /roi?roi=off restores the full frame, and /roi alone
+// reports the current window.
+static esp_err_t roi_handler(httpd_req_t *req) {
+  char json_response[192];
+
+  if (roi_from_query(req) != ESP_OK) {
+    return ESP_FAIL;
+  }
+  sensor_roi_json(json_response, sizeof(json_response));
+  httpd_resp_set_type(req, "application/json");
+  httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
+  return httpd_resp_sendstr(req, json_response);
+}
+
 static esp_err_t index_handler(httpd_req_t *req) {
   httpd_resp_set_type(req, "text/html");
   httpd_resp_set_hdr(req, "Content-Encoding", "gzip");
@@ -1185,6 +1452,57 @@ void startCameraServer() {
 #endif
   };
 
+#ifdef CONFIG_HTTPD_WS_SUPPORT
+  httpd_uri_t ws_uri = {
+    .uri = "/ws",
+    .method = HTTP_GET,
+    .handler = ws_stream_handler,
+    .user_ctx = NULL,
+    .is_websocket = true,
+    .handle_ws_control_frames = false,
+    .supported_subprotocol = NULL
+  };
+#endif
+
+  httpd_uri_t rtp_uri = {
+    .uri = "/rtp",
+    .method = HTTP_GET,
+    .handler = rtp_stream_handler,
+    .user_ctx = NULL
+#ifdef CONFIG_HTTPD_WS_SUPPORT
+    ,
+    .is_websocket = true,
+    .handle_ws_control_frames = false,
+    .supported_subprotocol = NULL
+#endif
+  };
+
+  httpd_uri_t roi_uri = {
+    .uri = "/roi",
+    .method = HTTP_GET,
+    .handler = roi_handler,
+    .user_ctx = NULL
+#ifdef CONFIG_HTTPD_WS_SUPPORT
+    ,
+    .is_websocket = true,
+    .handle_ws_control_frames = false,
+    .supported_subprotocol = NULL
+#endif
+  };
+
+  httpd_uri_t stats_uri = {
+    .uri = "/stats",
+    .method = HTTP_GET,
+    .handler = stats_handler,
+    .user_ctx = NULL
+#ifdef CONFIG_HTTPD_WS_SUPPORT
+    ,
+    .is_websocket = true,
+    .handle_ws_control_frames = false,
+    .supported_subprotocol = NULL
+#endif
+  };
+
   httpd_uri_t bmp_uri = {
     .uri = "/bmp",
     .method = HTTP_GET,
@@ -1271,6 +1589,12 @@ void startCameraServer() {
   // load ids from flash partition
   recognizer.set_ids_from_flash();
 #endif
+  // Before the servers: /capture and /bmp read the frame hub as well
+  if (!frame_hub_init() || !rtp_stream_init() || !pipeline_start()) {
+    log_e("Stream pipeline failed to start");
+    return;
+  }
+
   log_i("Starting web server on port: '%d'", config.server_port);
   if (httpd_start(&camera_httpd, &config) == ESP_OK) {
     httpd_register_uri_handler(camera_httpd, &index_uri);
@@ -1284,13 +1608,27 @@ void startCameraServer() {
     httpd_register_uri_handler(camera_httpd, &greg_uri);
     httpd_register_uri_handler(camera_httpd, &pll_uri);
     httpd_register_uri_handler(camera_httpd, &win_uri);
+    httpd_register_uri_handler(camera_httpd, &stats_uri);
+    httpd_register_uri_handler(camera_httpd, &rtp_uri);
+    httpd_register_uri_handler(camera_httpd, &roi_uri);
   }
 
+  // Viewers keep their sockets after the handler returns (stream_clients.cpp, ws_stream.cpp)
   config.server_port += 1;
   config.ctrl_port += 1;
+  config.max_open_sockets = workshop::kMaxStreamClients + 1;  // +1 to answer 503
+#ifdef CONFIG_HTTPD_WS_SUPPORT
+  config.max_open_sockets += workshop::kMaxWsClients;
+#endif
+  config.close_fn = stream_close_fn;
   log_i("Starting stream server on port: '%d'", config.server_port);
   if (httpd_start(&stream_httpd, &config) == ESP_OK) {
+    stream_clients_init(stream_httpd);
     httpd_register_uri_handler(stream_httpd, &stream_uri);
+#ifdef CONFIG_HTTPD_WS_SUPPORT
+    ws_stream_init(stream_httpd, set_control);
+    httpd_register_uri_handler(stream_httpd, &ws_uri);
+#endif
   }
 }
 
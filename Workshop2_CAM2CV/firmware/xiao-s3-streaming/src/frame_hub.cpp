@@ -0,0 +1,234 @@
+// frame_hub.cpp
+// Reference-counted frame slots shared by the capture task and the stream clients.
+#include "frame_hub.h"
+
+#include <string.h>
+#include "esp_heap_caps.h"
+#include "esp_timer.h"
+#include "freertos/event_groups.h"
+#include "freertos/semphr.h"
+
+#if defined(ARDUINO_ARCH_ESP32) && defined(CONFIG_ARDUHAL_ESP_LOG)
+#include "esp32-hal-log.h"
+#endif
+
+#define HUB_CONSUMERS_BIT BIT0
+#define HUB_SLOT_GROW     16384  // Slots grow in steps so a changing JPEG size rarely reallocates
+
+static hub_frame_t slots[FRAME_HUB_SLOTS];
+static hub_frame_t *latest = NULL;
+static uint32_t next_seq = 1;
+static TaskHandle_t consumers[FRAME_HUB_MAX_CONSUMERS];
+static uint8_t consumer_count = 0;
+
+static frame_prefix_fn prefix_fn = NULL;
+
+static SemaphoreHandle_t hub_lock = NULL;
+static EventGroupHandle_t hub_events = NULL;
+
+static frame_hub_stats_t hub_stats;
+static int64_t rate_start = 0;
+static uint32_t rate_frames = 0;
+
+bool frame_hub_init() {
+  hub_lock = xSemaphoreCreateMutex();
+  hub_events = xEventGroupCreate();
+  return hub_lock && hub_events;
+}
+
+void frame_hub_set_prefix(frame_prefix_fn fn) {
+  prefix_fn = fn;
+}
+
+bool frame_hub_publish(const uint8_t *jpg, size_t len, uint16_t width, uint16_t height, const struct timeval *timestamp) {
+  hub_frame_t *slot = NULL;
+
+  xSemaphoreTake(hub_lock, portMAX_DELAY);
+  // The oldest free slot (never used ones have seq 0): the newer ones are the history
+  for (int i = 0; i < FRAME_HUB_SLOTS; i++) {
+    if (slots[i].refs == 0 && &slots[i] != latest && (!slot || slots[i].seq < slot->seq)) {
+      slot = &slots[i];
+    }
+  }
+  if (slot) {
+    slot->refs = 1;  // The writer's reference keeps readers out until published
+    slot->seq = next_seq++;
+  } else {
+    hub_stats.dropped++;
+  }
+  xSemaphoreGive(hub_lock);
+  if (!slot) {
+    return false;
+  }
+
+  if (slot->capacity < len) {
+    size_t capacity = (len + HUB_SLOT_GROW - 1) / HUB_SLOT_GROW * HUB_SLOT_GROW;
+    uint8_t *mem = (uint8_t *)heap_caps_realloc(slot->mem, FRAME_HUB_HEADROOM + capacity, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (!mem) {
+      log_e("Frame slot allocation failed (%uB)", capacity);
+      xSemaphoreTake(hub_lock, portMAX_DELAY);
+      slot->refs = 0;
+      slot->seq = 0;  // Its old contents are gone; reuse it first
+      hub_stats.dropped++;
+      xSemaphoreGive(hub_lock);
+      return false;
+    }
+    slot->mem = mem;
+    slot->buf = mem + FRAME_HUB_HEADROOM;
+    slot->capacity = capacity;
+  }
+  memcpy(slot->buf, jpg, len);
+  slot->len = len;
+  slot->width = width;
+  slot->height = height;
+  slot->timestamp = *timestamp;
+  slot->prefix_len = 0;
+  if (prefix_fn) {
+    char prefix[FRAME_HUB_HEADROOM];
+    size_t n = prefix_fn(prefix, sizeof(prefix), slot);
+    if (n < sizeof(prefix)) {
+      memcpy(slot->buf - n, prefix, n);
+      slot->prefix_len = n;
+    }
+  }
+
+  int64_t now = esp_timer_get_time();
+  xSemaphoreTake(hub_lock, portMAX_DELAY);
+  slot->published_us = now;
+  slot->refs--;
+  latest = slot;
+  hub_stats.published++;
+  // Notified under the lock so a consumer cannot detach and exit in between
+  for (int i = 0; i < FRAME_HUB_MAX_CONSUMERS; i++) {
+    if (consumers[i]) {
+      xTaskNotifyGive(consumers[i]);
+    }
+  }
+  xSemaphoreGive(hub_lock);
+
+  rate_frames++;
+  if (now - rate_start >= 1000000) {
+    hub_stats.fps = rate_start ? rate_frames * 1000000.0f / (now - rate_start) : 0;
+    rate_start = now;
+    rate_frames = 0;
+  }
+  return true;
+}
+
+bool frame_hub_wait_for_consumers(TickType_t wait) {
+  EventBits_t bits = xEventGroupWaitBits(hub_events, HUB_CONSUMERS_BIT, pdFALSE, pdTRUE, wait);
+  return (bits & HUB_CONSUMERS_BIT) != 0;
+}
+
+bool frame_hub_attach() {
+  TaskHandle_t self = xTaskGetCurrentTaskHandle();
+  bool attached = false;
+
+  xSemaphoreTake(hub_lock, portMAX_DELAY);
+  for (int i = 0; i < FRAME_HUB_MAX_CONSUMERS; i++) {
+    if (!consumers[i]) {
+      consumers[i] = self;
+      consumer_count++;
+      attached = true;
+      break;
+    }
+  }
+  if (consumer_count == 1 && attached) {
+    xEventGroupSetBits(hub_events, HUB_CONSUMERS_BIT);
+  }
+  xSemaphoreGive(hub_lock);
+  return attached;
+}
+
+void frame_hub_detach() {
+  TaskHandle_t self = xTaskGetCurrentTaskHandle();
+
+  xSemaphoreTake(hub_lock, portMAX_DELAY);
+  for (int i = 0; i < FRAME_HUB_MAX_CONSUMERS; i++) {
+    if (consumers[i] == self) {
+      consumers[i] = NULL;
+      consumer_count--;
+      break;
+    }
+  }
+  if (consumer_count == 0) {
+    xEventGroupClearBits(hub_events, HUB_CONSUMERS_BIT);
+  }
+  xSemaphoreGive(hub_lock);
+}
+
+hub_frame_t *frame_hub_acquire(uint32_t after_seq, TickType_t wait) {
+  TickType_t start = xTaskGetTickCount();
+
+  while (true) {
+    hub_frame_t *frame = NULL;
+    xSemaphoreTake(hub_lock, portMAX_DELAY);
+    if (latest && latest->seq > after_seq) {
+      frame = latest;
+      frame->refs++;
+    }
+    xSemaphoreGive(hub_lock);
+    if (frame) {
+      return frame;
+    }
+
+    // A publish between the check and here leaves the notification pending
+    TickType_t waited = xTaskGetTickCount() - start;
+    if (waited >= wait) {
+      return NULL;
+    }
+    ulTaskNotifyTake(pdTRUE, wait - waited);
+  }
+}
+
+hub_frame_t *frame_hub_acquire_latest(int64_t max_age_us) {
+  hub_frame_t *frame = NULL;
+  int64_t now = esp_timer_get_time();
+
+  xSemaphoreTake(hub_lock, portMAX_DELAY);
+  if (latest && now - latest->published_us <= max_age_us) {
+    frame = latest;
+    frame->refs++;
+  }
+  xSemaphoreGive(hub_lock);
+  return frame;
+}
+
+hub_frame_t *frame_hub_acquire_seq(uint32_t seq) {
+  hub_frame_t *frame = NULL;
+
+  xSemaphoreTake(hub_lock, portMAX_DELAY);
+  // Frames newer than latest are still being written
+  for (int i = 0; seq && latest && seq <= latest->seq && i < FRAME_HUB_SLOTS; i++) {
+    if (slots[i].seq == seq) {
+      frame = &slots[i];
+      frame->refs++;
+      break;
+    }
+  }
+  xSemaphoreGive(hub_lock);
+  return frame;
+}
+
+void frame_hub_release(hub_frame_t *frame) {
+  xSemaphoreTake(hub_lock, portMAX_DELAY);
+  frame->refs--;
+  xSemaphoreGive(hub_lock);
+}
+
+void frame_hub_get_stats(frame_hub_stats_t *stats) {
+  xSemaphoreTake(hub_lock, portMAX_DELAY);
+  *stats = hub_stats;
+  stats->consumers = consumer_count;
+  stats->newest_seq = latest ? latest->seq : 0;
+  stats->oldest_seq = stats->newest_seq;
+  for (int i = 0; i < FRAME_HUB_SLOTS; i++) {
+    if (slots[i].seq && slots[i].seq < stats->oldest_seq) {
+      stats->oldest_seq = slots[i].seq;
+    }
+  }
+  xSemaphoreGive(hub_lock);
+  if (esp_timer_get_time() - rate_start > 2000000) {
+    stats->fps = 0;  // Nothing published lately (no viewers)
+  }
+}
@@ -0,0 +1,75 @@
+#pragma once
+// frame_hub.h
+// One capture, many viewers. The capture task in app_httpd.cpp publishes each
+// JPEG here once; every stream client takes a reference to the newest frame,
+// sends it at its own pace and releases it. A slot is only rewritten once no
+// client holds it, so a slow client skips frames instead of stalling the camera.
+// Free slots are reused oldest first, so the last few frames stay in PSRAM as
+// a ring that /capture and /bmp serve from without grabbing a frame of their own.
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/time.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "config.h"
+
+#define FRAME_HUB_MAX_CONSUMERS (workshop::kMaxStreamClients + workshop::kMaxWsClients + 1)  // +1: the RTP sender
+// Recent frames kept for snapshots and ?seq= (the newest included)
+#define FRAME_HUB_HISTORY 3
+// Every consumer holds at most one frame, the snapshot handlers one more,
+// plus the history and the frame being written: with this many slots the
+// publisher always finds a free one without touching the history.
+#define FRAME_HUB_SLOTS (FRAME_HUB_MAX_CONSUMERS + 1 + FRAME_HUB_HISTORY + 1)
+// Room in front of every JPEG for a transport header, so the header and the
+// frame leave in one write without copying the JPEG again.
+#define FRAME_HUB_HEADROOM 160
+
+typedef struct {
+  uint8_t *mem;  // Allocation: FRAME_HUB_HEADROOM bytes, then the JPEG (PSRAM)
+  uint8_t *buf;  // JPEG data
+  size_t len;
+  size_t capacity;
+  size_t prefix_len;  // Bytes of the prefix written right before buf
+  uint16_t width;
+  uint16_t height;
+  struct timeval timestamp;
+  uint32_t seq;  // 1, 2, 3... in publish order; already set while the prefix is written
+  int64_t published_us;  // esp_timer time of publication
+  uint8_t refs;
+} hub_frame_t;
+
+typedef struct {
+  uint32_t published;
+  uint32_t dropped;  // captured but not published (no free slot / no memory)
+  uint8_t consumers;
+  uint32_t oldest_seq;  // Range of frames frame_hub_acquire_seq() can still return
+  uint32_t newest_seq;
+  float fps;  // publish rate over the last second
+} frame_hub_stats_t;
+
+// Formats the prefix of a frame (its metadata is filled in); returns its length.
+typedef size_t (*frame_prefix_fn)(char *dst, size_t size, const hub_frame_t *frame);
+
+bool frame_hub_init();
+void frame_hub_set_prefix(frame_prefix_fn fn);
+
+// Capture side: copies the JPEG into a free slot and wakes every consumer.
+bool frame_hub_publish(const uint8_t *jpg, size_t len, uint16_t width, uint16_t height, const struct timeval *timestamp);
+// Blocks until at least one consumer is attached; false on timeout.
+bool frame_hub_wait_for_consumers(TickType_t wait);
+
+// Consumer side. The calling task is woken by task notification on publish.
+bool frame_hub_attach();
+void frame_hub_detach();
+// The newest frame with seq > after_seq, referenced; NULL on timeout.
+hub_frame_t *frame_hub_acquire(uint32_t after_seq, TickType_t wait);
+// Snapshots, without waiting: the newest frame if it is at most max_age_us
+// old (NULL when the stream pipeline is idle), or frame seq if still held.
+hub_frame_t *frame_hub_acquire_latest(int64_t max_age_us);
+hub_frame_t *frame_hub_acquire_seq(uint32_t seq);
+void frame_hub_release(hub_frame_t *frame);
+
+void frame_hub_get_stats(frame_hub_stats_t *stats);
@@ -0,0 +1,158 @@
+// motion_gate.cpp
+// Block-luma change detector that keeps unchanged frames off the network.
+#include "motion_gate.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "esp_timer.h"
+#include "img_converters.h"
+
+#if defined(ARDUINO_ARCH_ESP32) && defined(CONFIG_ARDUHAL_ESP_LOG)
+#include "esp32-hal-log.h"
+#endif
+
+#define MOTION_BLOCK_DELTA        12  // Luma change (0-255) for an 8x8 block to count as changed
+#define MOTION_DEFAULT_THRESHOLD  2   // Percent of blocks
+#define MOTION_DEFAULT_KEEPALIVE  2   // Seconds
+#define MOTION_MAX_KEEPALIVE      60
+
+static volatile bool enabled = false;
+static volatile bool reset = true;  // Next frame goes out and becomes the reference
+static volatile uint8_t threshold = MOTION_DEFAULT_THRESHOLD;
+static volatile uint8_t keepalive_s = MOTION_DEFAULT_KEEPALIVE;
+
+// Encode stage only
+static uint8_t *decoded = NULL;    // RGB565, one pixel per block
+static uint8_t *reference = NULL;  // Block luma of the last frame sent
+static uint16_t blocks_w = 0;
+static uint16_t blocks_h = 0;
+static int64_t last_sent_us = 0;
+
+static uint32_t sent = 0;
+static uint32_t skipped = 0;
+static uint32_t keepalives = 0;
+static float last_score = 0;  // Percent of blocks changed in the last frame checked
+static uint32_t last_check_us = 0;
+static volatile uint32_t last_skip_ms = 0;  // 32 bits: read by the stream senders without a lock
+
+bool motion_gate_set_enabled(int val) {
+  if (val < 0 || val > 1) {
+    return false;
+  }
+  enabled = val;
+  reset = true;
+  return true;
+}
+
+bool motion_gate_set_threshold(int percent) {
+  if (percent < 0 || percent > 100) {
+    return false;
+  }
+  threshold = percent;
+  return true;
+}
+
+bool motion_gate_set_keepalive(int seconds) {
+  if (seconds < 1 || seconds > MOTION_MAX_KEEPALIVE) {
+    return false;
+  }
+  keepalive_s = seconds;
+  return true;
+}
+
+// Buffers for a new frame size; the next frame is sent unconditionally
+static bool resize(uint16_t w, uint16_t h) {
+  free(decoded);
+  free(reference);
+  decoded = (uint8_t *)malloc(w * h * 2);
+  reference = (uint8_t *)malloc(w * h);
+  if (!decoded || !reference) {
+    free(decoded);
+    free(reference);
+    decoded = reference = NULL;
+    blocks_w = blocks_h = 0;
+    return false;
+  }
+  blocks_w = w;
+  blocks_h = h;
+  return true;
+}
+
+// Big-endian RGB565 from jpg2rgb565; BT.601 weights in 8-bit fixed point
+static inline uint8_t block_luma(uint32_t i) {
+  uint16_t px = (decoded[i * 2] << 8) | decoded[i * 2 + 1];
+  return ((px >> 11) * 616 + ((px >> 5) & 0x3f) * 600 + (px & 0x1f) * 232) >> 8;
+}
+
+bool motion_gate_check(const uint8_t *jpg, size_t len, uint16_t width, uint16_t height) {
+  if (!enabled) {
+    return true;
+  }
+  int64_t start = esp_timer_get_time();
+  uint16_t w = width / 8;
+  uint16_t h = height / 8;
+  bool fresh = reset;
+  reset = false;
+
+  if (w != blocks_w || h != blocks_h) {
+    fresh = true;
+    if (!resize(w, h)) {
+      log_e("Motion gate: no memory for %ux%u blocks", w, h);
+      return true;
+    }
+  }
+  if (!jpg2rgb565(jpg, len, decoded, JPG_SCALE_8X)) {
+    return true;  // Not for us to drop a frame we cannot read
+  }
+
+  uint32_t changed = 0;
+  uint32_t count = (uint32_t)w * h;
+  for (uint32_t i = 0; i < count; i++) {
+    int y = block_luma(i);
+    if (fresh) {
+      reference[i] = y;
+    } else if (abs(y - reference[i]) > MOTION_BLOCK_DELTA) {
+      changed++;
+    }
+  }
+  last_score = count ? changed * 100.0f / count : 0;
+
+  bool moved = fresh || last_score >= threshold;
+  bool keepalive = !moved && start - last_sent_us >= keepalive_s * 1000000LL;
+  if (moved || keepalive) {
+    // Compare later frames with this one, not the previous one, so a slow
+    // change still adds up to enough to go through
+    if (!fresh) {
+      for (uint32_t i = 0; i < count; i++) {
+        reference[i] = block_luma(i);
+      }
+    }
+    last_sent_us = start;
+    sent++;
+    if (keepalive) {
+      keepalives++;
+    }
+  } else {
+    skipped++;
+    last_skip_ms = (uint32_t)(start / 1000);
+  }
+  last_check_us = esp_timer_get_time() - start;
+  return moved || keepalive;
+}
+
+int64_t motion_gate_hold_us() {
+  return enabled ? keepalive_s * 1000000LL : 0;
+}
+
+bool motion_gate_held_within(int64_t us) {
+  if (!enabled || skipped == 0) {
+    return false;
+  }
+  uint32_t now_ms = (uint32_t)(esp_timer_get_time() / 1000);
+  return now_ms - last_skip_ms <= us / 1000;
+}
+
+int motion_gate_status_json(char *p, size_t size) {
+  return snprintf(p, size, ",\"motion\":%u,\"motion_threshold\":%u,\"motion_keepalive\":%u,\"motion_score\":%.1f,\"motion_sent\":%u,\"motion_skipped\":%u,\"motion_keepalives\":%u,\"motion_ms\":%.1f",
+                  enabled, threshold, keepalive_s, last_score, sent, skipped, keepalives, last_check_us / 1000.0f);
+}
@@ -0,0 +1,33 @@
+#pragma once
+// motion_gate.h
+// Skips frames that look like the last one sent. Each JPEG is decoded at 1/8
+// scale (only the DC coefficient of each 8x8 block is needed for that), turned
+// into one luma value per block and compared with the frame last published;
+// frames where fewer blocks changed than the threshold never reach the frame
+// hub, so no viewer (/stream, /ws, RTP) gets them. One frame still goes out
+// every keepalive period. Enabled from /control?var=motion&val=1; threshold,
+// keepalive and the skip count show in /status.
+
+#include <stddef.h>
+#include <stdint.h>
+
+// /control variables: motion (0/1), motion_threshold (percent of blocks that
+// must change), motion_keepalive (seconds). False for a value out of range.
+bool motion_gate_set_enabled(int enabled);
+bool motion_gate_set_threshold(int percent);
+bool motion_gate_set_keepalive(int seconds);
+
+// Encode stage, before publishing: true if the frame should go out.
+// Frame dimensions are those of the JPEG (multiples of 8, as all framesizes are).
+bool motion_gate_check(const uint8_t *jpg, size_t len, uint16_t width, uint16_t height);
+
+// How old the newest published frame may be while the scene is still: the
+// keepalive period when gating, otherwise 0.
+int64_t motion_gate_hold_us();
+
+// True if the gate held a frame back in the last us: viewers then send fewer
+// frames than the camera takes, which says nothing about the link.
+bool motion_gate_held_within(int64_t us);
+
+// ,"motion":...,... fields appended to /status; returns their length.
+int motion_gate_status_json(char *p, size_t size);
@@ -0,0 +1,169 @@
+// rtp_jpeg.cpp
+// RFC 2435 JPEG parsing and packetisation, no I/O.
+#include "rtp_jpeg.h"
+
+#include <string.h>
+
+#define JPEG_SOF0 0xC0
+#define JPEG_DHT  0xC4
+#define JPEG_SOI  0xD8
+#define JPEG_EOI  0xD9
+#define JPEG_SOS  0xDA
+#define JPEG_DQT  0xDB
+#define JPEG_DRI  0xDD
+
+#define RTP_HEADER_LEN     12
+#define RTP_JPEG_HEADER    8
+#define RTP_RESTART_HEADER 4
+#define RTP_QTABLE_HEADER  4
+#define RTP_JPEG_Q_INBAND  255  // Q >= 128: tables follow in the first packet
+
+static uint16_t be16(const uint8_t *p) {
+  return (p[0] << 8) | p[1];
+}
+
+static uint8_t *put16(uint8_t *p, uint16_t v) {
+  p[0] = v >> 8;
+  p[1] = v;
+  return p + 2;
+}
+
+static uint8_t *put32(uint8_t *p, uint32_t v) {
+  p = put16(p, v >> 16);
+  return put16(p, v);
+}
+
+bool rtp_jpeg_parse(const uint8_t *jpg, size_t len, rtp_jpeg_t *jpeg) {
+  memset(jpeg, 0, sizeof(*jpeg));
+  if (len < 4 || jpg[0] != 0xFF || jpg[1] != JPEG_SOI) {
+    return false;
+  }
+  bool have_sof = false;
+  size_t pos = 2;
+  while (pos + 4 <= len) {
+    if (jpg[pos] != 0xFF) {
+      return false;
+    }
+    uint8_t marker = jpg[pos + 1];
+    if (marker == 0xFF) {
+      pos++;  // Fill byte
+      continue;
+    }
+    size_t seg_len = be16(jpg + pos + 2);
+    if (seg_len < 2 || pos + 2 + seg_len > len) {
+      return false;
+    }
+    const uint8_t *seg = jpg + pos + 4;
+    size_t body_len = seg_len - 2;
+
+    switch (marker) {
+      case JPEG_DQT:
+        for (size_t i = 0; i + 65 <= body_len; i += 65) {
+          uint8_t precision = seg[i] >> 4;
+          uint8_t id = seg[i] & 0x0F;
+          if (precision != 0 || id > 1) {
+            return false;
+          }
+          jpeg->qtables[id] = seg + i + 1;
+          if (id + 1 > jpeg->qtable_count) {
+            jpeg->qtable_count = id + 1;
+          }
+        }
+        break;
+      case JPEG_SOF0:
+        // 8-bit, three components: Y at 2x1 (4:2:2) or 2x2 (4:2:0), Cb and Cr at 1x1
+        if (body_len < 15 || seg[0] != 8 || seg[5] != 3 || seg[10] != 0x11 || seg[13] != 0x11) {
+          return false;
+        }
+        jpeg->height = be16(seg + 1);
+        jpeg->width = be16(seg + 3);
+        if (seg[7] == 0x21) {
+          jpeg->type = 0;
+        } else if (seg[7] == 0x22) {
+          jpeg->type = 1;
+        } else {
+          return false;
+        }
+        if (!jpeg->width || !jpeg->height || jpeg->width > 2040 || jpeg->height > 2040) {
+          return false;
+        }
+        have_sof = true;
+        break;
+      case JPEG_DRI:
+        if (body_len >= 2) {
+          jpeg->restart_interval = be16(seg);
+        }
+        break;
+      case JPEG_SOS: {
+        if (!have_sof || !jpeg->qtables[0]) {
+          return false;
+        }
+        size_t start = pos + 2 + seg_len;
+        size_t end = len;
+        // The sensor pads the buffer after EOI; the scan ends at the last FFD9
+        while (end >= start + 2 && !(jpg[end - 2] == 0xFF && jpg[end - 1] == JPEG_EOI)) {
+          end--;
+        }
+        if (end < start + 2) {
+          return false;
+        }
+        jpeg->scan = jpg + start;
+        jpeg->scan_len = end - 2 - start;
+        if (jpeg->restart_interval) {
+          jpeg->type += 64;
+        }
+        return true;
+      }
+      default:
+        if ((marker & 0xF0) == 0xC0 && marker != JPEG_DHT) {
+          return false;  // SOF1..SOF15: not baseline
+        }
+        break;  // APPn, COM, DHT (assumed to be the standard tables): not sent
+    }
+    pos += 2 + seg_len;
+  }
+  return false;
+}
+
+size_t rtp_jpeg_packet(const rtp_jpeg_t *jpeg, size_t *offset, uint16_t seq, uint32_t timestamp, uint32_t ssrc, uint8_t *pkt, size_t size) {
+  if (*offset >= jpeg->scan_len) {
+    return 0;
+  }
+  uint8_t *p = pkt + RTP_HEADER_LEN;
+
+  // JPEG header: type-specific, fragment offset, type, Q, width / 8, height / 8
+  *p++ = 0;
+  *p++ = *offset >> 16;
+  p = put16(p, *offset);
+  *p++ = jpeg->type;
+  *p++ = RTP_JPEG_Q_INBAND;
+  *p++ = (jpeg->width + 7) / 8;
+  *p++ = (jpeg->height + 7) / 8;
+  if (jpeg->restart_interval) {
+    p = put16(p, jpeg->restart_interval);
+    p = put16(p, 0xFFFF);  // F = L = 1, count 0x3FFF: packets do not start on restart boundaries
+  }
+  if (*offset == 0) {
+    *p++ = 0;  // MBZ
+    *p++ = 0;  // 8-bit tables
+    p = put16(p, jpeg->qtable_count * 64);
+    for (int i = 0; i < jpeg->qtable_count; i++) {
+      memcpy(p, jpeg->qtables[i] ? jpeg->qtables[i] : jpeg->qtables[0], 64);
+      p += 64;
+    }
+  }
+
+  size_t room = size - (p - pkt);
+  size_t chunk = jpeg->scan_len - *offset < room ? jpeg->scan_len - *offset : room;
+  memcpy(p, jpeg->scan + *offset, chunk);
+  p += chunk;
+  *offset += chunk;
+
+  bool last = *offset >= jpeg->scan_len;
+  pkt[0] = 0x80;  // Version 2
+  pkt[1] = (last ? 0x80 : 0) | RTP_JPEG_PAYLOAD_TYPE;
+  put16(pkt + 2, seq);
+  put32(pkt + 4, timestamp);
+  put32(pkt + 8, ssrc);
+  return p - pkt;
+}
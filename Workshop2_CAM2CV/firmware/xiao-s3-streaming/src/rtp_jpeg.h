@@ -0,0 +1,33 @@
+#pragma once
+// rtp_jpeg.h
+// RTP payload format for JPEG (RFC 2435). A baseline JPEG as the OV2640 makes
+// it (standard Huffman tables, 8-bit quantisation tables, 4:2:2 or 4:2:0) is
+// reduced to its entropy-coded scan plus an 8-byte header per packet; the
+// quantisation tables travel in-band (Q = 255) with the first packet of each
+// frame, and the receiver rebuilds the JPEG headers from them.
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define RTP_JPEG_PAYLOAD_TYPE 26
+#define RTP_JPEG_CLOCK_HZ     90000
+
+typedef struct {
+  const uint8_t *scan;  // Entropy-coded data after SOS, without EOI
+  size_t scan_len;
+  const uint8_t *qtables[2];  // 64 bytes each, zig-zag order as in DQT
+  uint8_t qtable_count;
+  uint8_t type;  // 0 = 4:2:2, 1 = 4:2:0; +64 with restart markers
+  uint16_t width;
+  uint16_t height;
+  uint16_t restart_interval;
+} rtp_jpeg_t;
+
+// False for JPEGs RFC 2435 cannot carry: progressive, 16-bit tables, other
+// subsampling, or larger than 2040x2040.
+bool rtp_jpeg_parse(const uint8_t *jpg, size_t len, rtp_jpeg_t *jpeg);
+
+// Writes the packet starting at *offset into the scan (RTP header included,
+// at most size bytes) and advances *offset; the last one carries the marker
+// bit. Returns the packet length, 0 once the whole scan has been sent.
+size_t rtp_jpeg_packet(const rtp_jpeg_t *jpeg, size_t *offset, uint16_t seq, uint32_t timestamp, uint32_t ssrc, uint8_t *pkt, size_t size);
@@ -0,0 +1,277 @@
+// rtp_stream.cpp
+// RTP/JPEG sender task fed by the frame hub.
+#include "rtp_stream.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include "esp_random.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "frame_hub.h"
+#include "rtp_jpeg.h"
+#include "stream_pacer.h"
+
+#if defined(ARDUINO_ARCH_ESP32) && defined(CONFIG_ARDUHAL_ESP_LOG)
+#include "esp32-hal-log.h"
+#endif
+
+#define RTP_SENDER_STACK     4096
+#define RTP_SENDER_CORE      0       // With Wi-Fi and lwIP, as the other senders
+#define RTP_PACKET_SIZE      1400    // Whole packet, well under the 1500-byte MTU after IP/UDP headers
+#define RTP_FRAME_WAIT_MS    1000    // Re-check for stop at least this often
+#define RTP_MAX_FRAME_AGE_US 100000  // Older than this when its turn comes: drop, a newer one follows
+#define RTCP_RR              201
+
+typedef struct {
+  // Set by the handler
+  bool running;
+  bool task_alive;
+  struct sockaddr_in dest;
+  int fps;
+  bool fps_changed;
+  // Sender counters
+  uint32_t frames;
+  uint32_t packets;
+  uint64_t bytes;
+  uint32_t late;         // Dropped because they were too old to be worth sending
+  uint32_t skipped;      // Published while the previous frame was still going out
+  uint32_t aborted;      // Cut short when the network stack had no buffers left
+  uint32_t unsupported;  // JPEGs RFC 2435 cannot carry
+  float fps_sent;
+  float kbps;
+  // From the receiver's last RTCP receiver report
+  uint32_t rr_count;
+  float rr_fraction_lost;
+  int32_t rr_cumulative_lost;
+  uint32_t rr_jitter;  // In RTP_JPEG_CLOCK_HZ ticks
+  int64_t rr_time;
+} rtp_session_t;
+
+static rtp_session_t session;
+static portMUX_TYPE session_lock = portMUX_INITIALIZER_UNLOCKED;
+static stream_pacer_t pacer;
+
+static uint32_t be32(const uint8_t *p) {
+  return ((uint32_t)p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+}
+
+// Reports arrive on the socket the packets leave from; read them between frames
+static void read_receiver_reports(int sock, uint32_t ssrc) {
+  uint8_t buf[128];
+  int len;
+  while ((len = recv(sock, buf, sizeof(buf), MSG_DONTWAIT)) > 0) {
+    // Header (8 bytes: V/P/RC, PT, length, reporter SSRC), then report blocks of 24 bytes
+    if (len < 8 || (buf[0] >> 6) != 2 || buf[1] != RTCP_RR) {
+      continue;
+    }
+    int blocks = buf[0] & 0x1F;
+    for (int i = 0; i < blocks && 8 + (i + 1) * 24 <= len; i++) {
+      const uint8_t *block = buf + 8 + i * 24;
+      if (be32(block) != ssrc) {
+        continue;
+      }
+      int32_t cumulative = (block[5] << 16) | (block[6] << 8) | block[7];
+      if (cumulative & 0x800000) {
+        cumulative -= 0x1000000;  // 24-bit signed
+      }
+      session.rr_fraction_lost = block[4] / 256.0f;
+      session.rr_cumulative_lost = cumulative;
+      session.rr_jitter = be32(block + 12);
+      session.rr_time = esp_timer_get_time();
+      session.rr_count++;
+    }
+  }
+}
+
+// Drops the rest of the frame (no retransmission) when lwIP is out of buffers
+static bool send_frame(int sock, const struct sockaddr_in *dest, const hub_frame_t *frame, uint16_t *seq, uint32_t ssrc, uint8_t *pkt) {
+  rtp_jpeg_t jpeg;
+  if (!rtp_jpeg_parse(frame->buf, frame->len, &jpeg)) {
+    session.unsupported++;
+    return true;
+  }
+  uint32_t timestamp = (uint64_t)frame->timestamp.tv_sec * RTP_JPEG_CLOCK_HZ + (uint64_t)frame->timestamp.tv_usec * RTP_JPEG_CLOCK_HZ / 1000000;
+  size_t offset = 0;
+  size_t len;
+  while ((len = rtp_jpeg_packet(&jpeg, &offset, *seq, timestamp, ssrc, pkt, RTP_PACKET_SIZE)) > 0) {
+    (*seq)++;
+    if (sendto(sock, pkt, len, 0, (const struct sockaddr *)dest, sizeof(*dest)) < 0) {
+      session.aborted++;
+      return false;
+    }
+    session.packets++;
+    session.bytes += len;
+  }
+  session.frames++;
+  return true;
+}
+
+static void rtp_sender_task(void *arg) {
+  uint8_t *pkt = (uint8_t *)malloc(RTP_PACKET_SIZE);
+  int sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_IP);
+  uint32_t ssrc = esp_random();
+  uint16_t seq = esp_random();
+  uint32_t last_seq = 0;
+  int64_t rate_start = esp_timer_get_time();
+  uint32_t rate_frames = session.frames;
+  uint64_t rate_bytes = session.bytes;
+
+  if (!pkt || sock < 0 || !frame_hub_attach()) {
+    log_e("RTP sender could not start");
+    taskENTER_CRITICAL(&session_lock);
+    session.running = false;
+    session.task_alive = false;
+    taskEXIT_CRITICAL(&session_lock);
+  } else {
+    stream_pacer_reset(&pacer);
+    while (true) {
+      struct sockaddr_in dest;
+      taskENTER_CRITICAL(&session_lock);
+      bool running = session.running;
+      if (!running) {
+        session.task_alive = false;  // From here on, /rtp starts a new sender
+      }
+      dest = session.dest;
+      if (session.fps_changed) {
+        stream_pacer_set_fps(&pacer, session.fps);
+        session.fps_changed = false;
+      }
+      taskEXIT_CRITICAL(&session_lock);
+      if (!running) {
+        break;
+      }
+
+      stream_pacer_wait(&pacer);
+      hub_frame_t *frame = frame_hub_acquire(last_seq, pdMS_TO_TICKS(RTP_FRAME_WAIT_MS));
+      read_receiver_reports(sock, ssrc);
+      if (!frame) {
+        stream_pacer_restart(&pacer);  // Camera stalled
+        continue;
+      }
+      if (last_seq && frame->seq > last_seq + 1) {
+        session.skipped += frame->seq - last_seq - 1;
+      }
+      last_seq = frame->seq;
+      if (esp_timer_get_time() - frame->published_us > RTP_MAX_FRAME_AGE_US) {
+        session.late++;
+      } else {
+        send_frame(sock, &dest, frame, &seq, ssrc, pkt);
+      }
+      frame_hub_release(frame);
+      stream_pacer_advance(&pacer);
+
+      int64_t now = esp_timer_get_time();
+      if (now - rate_start >= 1000000) {
+        session.fps_sent = (session.frames - rate_frames) * 1000000.0f / (now - rate_start);
+        session.kbps = (session.bytes - rate_bytes) * 8000.0f / (now - rate_start);
+        rate_start = now;
+        rate_frames = session.frames;
+        rate_bytes = session.bytes;
+      }
+    }
+    frame_hub_detach();
+  }
+  if (sock >= 0) {
+    close(sock);
+  }
+  free(pkt);
+  log_i("RTP sender stopped");
+  vTaskDelete(NULL);
+}
+
+bool rtp_stream_init() {
+  return stream_pacer_init(&pacer);
+}
+
+static bool caller_address(httpd_req_t *req, struct in_addr *addr) {
+  struct sockaddr_storage peer;
+  socklen_t peer_len = sizeof(peer);
+  if (getpeername(httpd_req_to_sockfd(req), (struct sockaddr *)&peer, &peer_len) < 0) {
+    return false;
+  }
+  if (peer.ss_family == AF_INET) {
+    *addr = ((struct sockaddr_in *)&peer)->sin_addr;
+    return true;
+  }
+  // The server listens on IPv6: IPv4 callers appear as ::ffff:a.b.c.d
+  memcpy(&addr->s_addr, ((struct sockaddr_in6 *)&peer)->sin6_addr.s6_addr + 12, 4);
+  return true;
+}
+
+esp_err_t rtp_stream_handler(httpd_req_t *req) {
+  char query[96];
+  char value[32];
+  bool has_query = httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK;
+
+  if (has_query && httpd_query_key_value(query, "stop", value, sizeof(value)) == ESP_OK) {
+    taskENTER_CRITICAL(&session_lock);
+    session.running = false;
+    taskEXIT_CRITICAL(&session_lock);
+  } else if (has_query && httpd_query_key_value(query, "port", value, sizeof(value)) == ESP_OK) {
+    struct sockaddr_in dest = {};
+    dest.sin_family = AF_INET;
+    dest.sin_port = htons(atoi(value));
+    bool addr_ok = httpd_query_key_value(query, "ip", value, sizeof(value)) == ESP_OK ? inet_aton(value, &dest.sin_addr) != 0 : caller_address(req, &dest.sin_addr);
+    if (!addr_ok || !dest.sin_port) {
+      httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Bad ip or port");
+      return ESP_FAIL;
+    }
+    int fps = httpd_query_key_value(query, "fps", value, sizeof(value)) == ESP_OK ? atoi(value) : -1;
+
+    // A running sender picks up the new destination with its next frame
+    taskENTER_CRITICAL(&session_lock);
+    bool start = !session.task_alive;
+    session.dest = dest;
+    session.fps = fps;
+    session.fps_changed = true;
+    session.running = true;
+    session.task_alive = true;
+    if (start) {
+      session.frames = 0;
+      session.packets = 0;
+      session.bytes = 0;
+      session.late = 0;
+      session.skipped = 0;
+      session.aborted = 0;
+      session.unsupported = 0;
+      session.rr_count = 0;
+      session.rr_fraction_lost = 0;
+      session.rr_cumulative_lost = 0;
+      session.rr_jitter = 0;
+    }
+    taskEXIT_CRITICAL(&session_lock);
+    if (start && xTaskCreatePinnedToCore(rtp_sender_task, "rtp_tx", RTP_SENDER_STACK, NULL, tskIDLE_PRIORITY + 5, NULL, RTP_SENDER_CORE) != pdPASS) {
+      session.running = false;
+      session.task_alive = false;
+      httpd_resp_send_500(req);
+      return ESP_FAIL;
+    }
+    log_i("RTP to %s:%u", inet_ntoa(dest.sin_addr), ntohs(dest.sin_port));
+  }
+
+  char json[512];
+  rtp_stream_stats_json(json, sizeof(json));
+  httpd_resp_set_type(req, "application/json");
+  httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
+  return httpd_resp_sendstr(req, json);
+}
+
+int rtp_stream_stats_json(char *p, size_t size) {
+  int64_t rr_age = session.rr_count ? (esp_timer_get_time() - session.rr_time) / 1000 : -1;
+  int len = snprintf(
+    p, size,
+    "{\"running\":%u,\"dest\":\"%s:%u\",\"fps\":%.1f,\"target_fps\":%.1f,\"frames\":%u,\"packets\":%u,\"kbytes\":%u,\"kbps\":%.0f,\"late\":%u,\"skipped\":%u,"
+    "\"aborted\":%u,\"unsupported\":%u,\"rr\":{\"reports\":%u,\"fraction_lost\":%.3f,\"cumulative_lost\":%d,\"jitter_ms\":%.1f,\"age_ms\":%d}}",
+    session.running, inet_ntoa(session.dest.sin_addr), ntohs(session.dest.sin_port), session.running ? session.fps_sent : 0.0f, stream_pacer_target_fps(&pacer), session.frames,
+    session.packets, (uint32_t)(session.bytes / 1024), session.kbps, session.late, session.skipped, session.aborted, session.unsupported, session.rr_count,
+    session.rr_fraction_lost, session.rr_cumulative_lost, session.rr_jitter * 1000.0f / RTP_JPEG_CLOCK_HZ, (int)rr_age
+  );
+  return len < (int)size ? len : size - 1;
+}
@@ -0,0 +1,20 @@
+#pragma once
+// rtp_stream.h
+// Optional low-latency mode: the stream as RTP/JPEG (RFC 2435) over UDP to
+// one receiver. UDP has no retransmission, so a lost packet costs one frame
+// instead of stalling every frame behind it as on a TCP /stream, and frames
+// that are already late are dropped rather than sent. Started and stopped
+// with /rtp on port 80; the receiver's RTCP receiver reports (sent back to
+// the source port, RFC 5761 style) show packet loss and jitter in /stats.
+
+#include <stddef.h>
+#include "esp_http_server.h"
+
+bool rtp_stream_init();
+
+// /rtp?port=5004[&ip=a.b.c.d][&fps=N] starts (ip defaults to the caller),
+// /rtp?stop=1 stops, /rtp alone reports; always answers the session as JSON.
+esp_err_t rtp_stream_handler(httpd_req_t *req);
+
+// The session as a JSON object; returns its length.
+int rtp_stream_stats_json(char *p, size_t size);
@@ -0,0 +1,197 @@
+// sensor_roi.cpp
+// OV2640 window / sensor mode selection for region-of-interest streaming.
+#include "sensor_roi.h"
+
+#include <stdio.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+
+#if defined(ARDUINO_ARCH_ESP32) && defined(CONFIG_ARDUHAL_ESP_LOG)
+#include "esp32-hal-log.h"
+#endif
+
+#define ROI_SENSOR_WIDTH  1600
+#define ROI_SENSOR_HEIGHT 1200
+#define ROI_MIN_DETAIL    128  // Automatic mode: window pixels to keep on the ROI's shorter side
+
+// OV2640 readout modes, coarsest (fastest) first. set_res_raw() on the OV2640
+// takes the mode in startX and the window in offset/total, in the mode's own
+// pixels; the DSP then scales the window to the output size.
+typedef struct {
+  int mode;  // ov2640_sensor_mode_t
+  const char *name;
+  uint8_t scale;  // Sensor pixels per mode pixel
+  uint16_t width;
+  uint16_t height;
+} roi_mode_t;
+
+static const roi_mode_t kModes[] = {
+  {2, "CIF", 4, 400, 296},
+  {1, "SVGA", 2, 800, 600},
+  {0, "UXGA", 1, 1600, 1200},
+};
+#define MODE_COUNT (sizeof(kModes) / sizeof(kModes[0]))
+
+static portMUX_TYPE roi_lock = portMUX_INITIALIZER_UNLOCKED;
+static bool active = false;
+static int roi_x, roi_y, roi_w, roi_h;  // As requested
+static int roi_scale;                   // 0 = mode chosen automatically
+static const roi_mode_t *mode = NULL;
+static uint16_t win_x, win_y, win_w, win_h;  // Mode pixels
+static uint16_t out_w, out_h;
+static uint32_t changes = 0;
+
+static esp_err_t apply(sensor_t *s, int x, int y, int w, int h, int scale) {
+  // Unless asked for a mode: the coarsest one that keeps enough detail, but
+  // never a finer (slower) one than the frame size reads out with by itself
+  const resolution_info_t *cap = &resolution[s->status.framesize];
+  const roi_mode_t *m = NULL;
+  for (size_t i = 0; i < MODE_COUNT && !m; i++) {
+    const roi_mode_t *k = &kModes[i];
+    bool detail = (w < h ? w : h) / k->scale >= ROI_MIN_DETAIL;
+    bool framesize_mode = cap->width <= k->width && cap->height <= k->height;
+    if (scale ? k->scale == scale : detail || framesize_mode) {
+      m = k;
+    }
+  }
+  uint16_t ww = (w / m->scale) & ~3;  // The DSP works in units of 4 pixels
+  uint16_t wh = (h / m->scale) & ~3;
+  if (wh > m->height) {
+    wh = m->height;  // CIF is 296 lines, not 300
+  }
+  uint16_t wx = x / m->scale;
+  uint16_t wy = y / m->scale;
+  if (wy + wh > m->height) {
+    wy = m->height - wh;
+  }
+
+  // Largest output within the current frame size, never scaled up
+  float f = 1.0f;
+  if (ww > cap->width) {
+    f = (float)cap->width / ww;
+  }
+  if (wh * f > cap->height) {
+    f = (float)cap->height / wh;
+  }
+  uint16_t ow = ((int)(ww * f)) & ~15;  // Whole JPEG MCUs
+  uint16_t oh = ((int)(wh * f)) & ~15;
+
+  if (s->set_res_raw(s, m->mode, 0, 0, 0, wx, wy, ww, wh, ow, oh, false, false)) {
+    log_e("ROI: sensor rejected window %ux%u+%u+%u (%s) -> %ux%u", ww, wh, wx, wy, m->name, ow, oh);
+    return ESP_FAIL;
+  }
+  log_i("ROI: %d,%d %dx%d -> %s window %ux%u+%u+%u, output %ux%u", x, y, w, h, m->name, ww, wh, wx, wy, ow, oh);
+
+  taskENTER_CRITICAL(&roi_lock);
+  active = true;
+  roi_x = x;
+  roi_y = y;
+  roi_w = w;
+  roi_h = h;
+  roi_scale = scale;
+  mode = m;
+  win_x = wx;
+  win_y = wy;
+  win_w = ww;
+  win_h = wh;
+  out_w = ow;
+  out_h = oh;
+  changes++;
+  taskEXIT_CRITICAL(&roi_lock);
+  return ESP_OK;
+}
+
+esp_err_t sensor_roi_set(int x, int y, int w, int h, int scale) {
+  sensor_t *s = esp_camera_sensor_get();
+  if (!s || s->id.PID != OV2640_PID || s->pixformat != PIXFORMAT_JPEG) {
+    return ESP_ERR_NOT_SUPPORTED;
+  }
+  if (x < 0 || y < 0 || w < SENSOR_ROI_MIN_SIZE || h < SENSOR_ROI_MIN_SIZE || x + w > ROI_SENSOR_WIDTH || y + h > ROI_SENSOR_HEIGHT
+      || (scale != 0 && scale != 1 && scale != 2 && scale != 4)) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  return apply(s, x, y, w, h, scale);
+}
+
+esp_err_t sensor_roi_set_str(const char *spec) {
+  int x, y, w, h;
+  int scale = 0;
+  char end;
+  if (!strcmp(spec, "off") || !strcmp(spec, "0")) {
+    sensor_roi_clear();
+    return ESP_OK;
+  }
+  int n = sscanf(spec, "%d,%d,%d,%d,%d%c", &x, &y, &w, &h, &scale, &end);
+  if (n != 4 && n != 5) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  return sensor_roi_set(x, y, w, h, scale);
+}
+
+void sensor_roi_clear() {
+  if (!active) {
+    return;
+  }
+  sensor_t *s = esp_camera_sensor_get();
+  taskENTER_CRITICAL(&roi_lock);
+  active = false;
+  changes++;
+  taskEXIT_CRITICAL(&roi_lock);
+  s->set_framesize(s, s->status.framesize);  // Back to the full window
+  log_i("ROI: off");
+}
+
+bool sensor_roi_active() {
+  return active;
+}
+
+void sensor_roi_refresh() {
+  if (active && apply(esp_camera_sensor_get(), roi_x, roi_y, roi_w, roi_h, roi_scale) != ESP_OK) {
+    active = false;  // The driver's full-frame window is in place
+  }
+}
+
+// Width and height from the SOF marker; the frame buffer's own when there is none
+static bool jpeg_size(const uint8_t *p, size_t len, uint16_t *width, uint16_t *height) {
+  size_t i = 2;
+  while (i + 9 < len && p[i] == 0xFF) {
+    uint8_t marker = p[i + 1];
+    if (marker >= 0xC0 && marker <= 0xC3) {
+      *height = (p[i + 5] << 8) | p[i + 6];
+      *width = (p[i + 7] << 8) | p[i + 8];
+      return true;
+    }
+    if (marker == 0xDA) {
+      break;  // Start of scan: no SOF before it
+    }
+    i += 2 + ((p[i + 2] << 8) | p[i + 3]);
+  }
+  return false;
+}
+
+void sensor_roi_frame_size(const camera_fb_t *fb, uint16_t *width, uint16_t *height) {
+  if (!active || fb->format != PIXFORMAT_JPEG || !jpeg_size(fb->buf, fb->len, width, height)) {
+    *width = fb->width;
+    *height = fb->height;
+  }
+}
+
+int sensor_roi_json(char *p, size_t size) {
+  taskENTER_CRITICAL(&roi_lock);
+  bool on = active;
+  int roi[4] = {roi_x, roi_y, roi_w, roi_h};
+  uint16_t win[4] = {win_x, win_y, win_w, win_h};
+  uint16_t out[2] = {out_w, out_h};
+  const char *name = mode ? mode->name : "";
+  uint32_t n = changes;
+  taskEXIT_CRITICAL(&roi_lock);
+
+  int len;
+  if (on) {
+    len = snprintf(p, size, "{\"active\":1,\"roi\":[%d,%d,%d,%d],\"mode\":\"%s\",\"window\":[%u,%u,%u,%u],\"output\":[%u,%u],\"changes\":%u}", roi[0], roi[1],
+                   roi[2], roi[3], name, win[0], win[1], win[2], win[3], out[0], out[1], n);
+  } else {
+    len = snprintf(p, size, "{\"active\":0,\"changes\":%u}", n);
+  }
+  return len < (int)size ? len : size - 1;
+}
@@ -0,0 +1,36 @@
+#pragma once
+// sensor_roi.h
+// Region-of-interest streaming: points the OV2640's DSP window at one part of
+// the image and reads the sensor out in the coarsest mode (CIF, SVGA or UXGA,
+// i.e. 4x, 2x or no subsampling) that still leaves the region enough pixels,
+// so a small region streams in smaller frames and, from the coarser modes, at
+// a higher frame rate. The ROI is given in full-sensor coordinates
+// (1600x1200), applies to every viewer, and can be changed at any time from
+// /roi?roi=x,y,w,h, /stream?roi=..., or a /ws "roi=x,y,w,h" message; "off"
+// restores the full frame. JPEG only.
+
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_camera.h"
+#include "esp_err.h"
+
+#define SENSOR_ROI_MIN_SIZE 64  // Smallest ROI side, full-sensor pixels
+
+// "x,y,w,h[,scale]" or "off"; scale 1, 2 or 4 forces the UXGA, SVGA or CIF
+// readout, 0 (the default) picks one. ESP_ERR_INVALID_ARG for a malformed or
+// out-of-range ROI, ESP_ERR_NOT_SUPPORTED for another sensor or pixel format.
+esp_err_t sensor_roi_set_str(const char *spec);
+esp_err_t sensor_roi_set(int x, int y, int w, int h, int scale);
+void sensor_roi_clear();
+bool sensor_roi_active();
+
+// After set_framesize(): the frame size is the ROI's largest output, and the
+// driver has just reset the window. Re-applies an active ROI.
+void sensor_roi_refresh();
+
+// A frame buffer's width and height follow the frame size setting, not the
+// window: with an ROI active read them from the JPEG itself.
+void sensor_roi_frame_size(const camera_fb_t *fb, uint16_t *width, uint16_t *height);
+
+// {"active":...} object for /roi and /stats; returns its length.
+int sensor_roi_json(char *p, size_t size);
@@ -0,0 +1,296 @@
+// stream_clients.cpp
+// One sender task per /stream viewer, fed by the frame hub.
+#include "stream_clients.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+
+#include "adaptive_quality.h"
+#include "config.h"
+#include "frame_hub.h"
+#include "stream_pacer.h"
+
+#if defined(ARDUINO_ARCH_ESP32) && defined(CONFIG_ARDUHAL_ESP_LOG)
+#include "esp32-hal-log.h"
+#endif
+
+#define PART_BOUNDARY "123456789000000000000987654321"
+// Sent raw: the socket leaves the server after this, so no chunked encoding
+static const char *_STREAM_HEAD = "HTTP/1.1 200 OK\r\n"
+                                  "Content-Type: multipart/x-mixed-replace;boundary=" PART_BOUNDARY "\r\n"
+                                  "Access-Control-Allow-Origin: *\r\n"
+                                  "X-Framerate: 60\r\n"
+                                  "Cache-Control: no-cache\r\n"
+                                  "Connection: close\r\n"
+                                  "\r\n";
+static const char *_STREAM_BOUNDARY = "\r\n--" PART_BOUNDARY "\r\n";
+static const char *_STREAM_PART = "Content-Type: image/jpeg\r\nContent-Length: %u\r\nX-Timestamp: %lld.%06ld\r\nX-Frame-Seq: %u\r\n\r\n";
+
+#define STREAM_SENDER_STACK 4096
+#define STREAM_SENDER_CORE 0  // With Wi-Fi and lwIP; core 1 is left to capture and detection
+#define STREAM_FRAME_WAIT_MS 1000  // Re-check the socket at least this often
+
+typedef struct {
+  bool in_use;
+  int fd;                 // -1 once the server closed the socket
+  SemaphoreHandle_t io;   // Held by the sender while it writes to fd
+  uint32_t id;
+  bool coalesce;          // One write per frame (default), or boundary, header and JPEG apart
+  uint32_t frames;
+  uint32_t skipped;       // Frames published while this viewer was still sending
+  uint64_t bytes;
+  uint32_t overhead;      // Framing bytes sent with each JPEG
+  stream_pacer_t pacer;
+  float fps;
+  float kbps;
+  uint32_t send_us;       // Average time to send one frame over the last second
+  uint32_t send_max_us;
+} stream_client_t;
+
+static stream_client_t clients[workshop::kMaxStreamClients];
+static portMUX_TYPE clients_lock = portMUX_INITIALIZER_UNLOCKED;
+static httpd_handle_t stream_server = NULL;
+static uint32_t next_client_id = 1;
+
+static bool send_all(int fd, const uint8_t *data, size_t len) {
+  while (len > 0) {
+    int sent = send(fd, data, len, 0);
+    if (sent <= 0) {
+      return false;  // Closed, reset, or SO_SNDTIMEO (send_wait_timeout) expired
+    }
+    data += sent;
+    len -= sent;
+  }
+  return true;
+}
+
+// Boundary and part header of a frame, written once by the frame hub into the
+// headroom in front of the JPEG (frame_hub_set_prefix)
+static size_t stream_part_prefix(char *dst, size_t size, const hub_frame_t *frame) {
+  size_t len = snprintf(dst, size, "%s", _STREAM_BOUNDARY);
+  len += snprintf(dst + len, size - len, _STREAM_PART, frame->len, (long long)frame->timestamp.tv_sec, (long)frame->timestamp.tv_usec, frame->seq);
+  return len;
+}
+
+static bool send_frame(stream_client_t *c, const hub_frame_t *frame) {
+  const uint8_t *prefix = frame->buf - frame->prefix_len;
+  if (c->coalesce) {
+    return send_all(c->fd, prefix, frame->prefix_len + frame->len);
+  }
+  // The way frames used to go out: three writes, usually three TCP segments
+  size_t boundary_len = strlen(_STREAM_BOUNDARY);
+  return send_all(c->fd, prefix, boundary_len) && send_all(c->fd, prefix + boundary_len, frame->prefix_len - boundary_len)
+         && send_all(c->fd, frame->buf, frame->len);
+}
+
+static void stream_sender_task(void *arg) {
+  stream_client_t *c = (stream_client_t *)arg;
+  uint32_t last_seq = 0;
+  int64_t rate_start = esp_timer_get_time();
+  uint32_t rate_frames = 0;
+  uint64_t rate_bytes = 0;
+  int64_t rate_send_us = 0;
+  int64_t rate_send_max_us = 0;
+
+  if (!frame_hub_attach()) {
+    log_e("Frame hub full");
+  } else {
+    stream_pacer_reset(&c->pacer);
+    while (true) {
+      stream_pacer_wait(&c->pacer);
+      hub_frame_t *frame = frame_hub_acquire(last_seq, pdMS_TO_TICKS(STREAM_FRAME_WAIT_MS));
+      bool ok = true;
+
+      xSemaphoreTake(c->io, portMAX_DELAY);
+      if (c->fd < 0) {
+        ok = false;
+      } else if (frame) {
+        int64_t send_start = esp_timer_get_time();
+        ok = send_frame(c, frame);
+        if (ok) {
+          int64_t send_time = esp_timer_get_time() - send_start;
+          rate_frames++;
+          rate_bytes += frame->prefix_len + frame->len;
+          rate_send_us += send_time;
+          if (send_time > rate_send_max_us) {
+            rate_send_max_us = send_time;
+          }
+          c->frames++;
+          c->bytes += frame->prefix_len + frame->len;
+          c->overhead = frame->prefix_len;
+          if (last_seq && frame->seq > last_seq + 1) {
+            c->skipped += frame->seq - last_seq - 1;
+          }
+        }
+      }
+      xSemaphoreGive(c->io);
+
+      if (frame) {
+        last_seq = frame->seq;
+        frame_hub_release(frame);
+        stream_pacer_advance(&c->pacer);
+      } else {
+        stream_pacer_restart(&c->pacer);  // Camera stalled
+      }
+      if (!ok) {
+        break;
+      }
+
+      int64_t now = esp_timer_get_time();
+      if (now - rate_start >= 1000000) {
+        c->fps = rate_frames * 1000000.0f / (now - rate_start);
+        c->kbps = rate_bytes * 8000.0f / (now - rate_start);
+        c->send_us = rate_frames ? rate_send_us / rate_frames : 0;
+        c->send_max_us = rate_send_max_us;
+        if (rate_frames) {
+          adaptive_sample_t sample;
+          sample.busy = (float)rate_send_us / (now - rate_start);
+          sample.fps = c->fps;
+          sample.target_fps = stream_pacer_target_fps(&c->pacer);
+          sample.sending_kbps = rate_send_us ? rate_bytes * 8000 / rate_send_us : 0;
+          sample.frame_bytes = rate_bytes / rate_frames;
+          sample.send_max_us = rate_send_max_us;
+          adaptive_report(&sample);
+        }
+        rate_start = now;
+        rate_frames = 0;
+        rate_bytes = 0;
+        rate_send_us = 0;
+        rate_send_max_us = 0;
+      }
+    }
+    frame_hub_detach();
+  }
+
+  // If the socket is still ours the viewer stalled or sent an error: let the
+  // server close it (close_fn then finds no client and just closes). fd stays
+  // in the slot until the close is queued, all under io: a close_fn for the
+  // same socket waits here instead of closing it first, so the fd number
+  // cannot go to a new viewer whose session the trigger would then close.
+  xSemaphoreTake(c->io, portMAX_DELAY);
+  if (c->fd >= 0) {
+    httpd_sess_trigger_close(stream_server, c->fd);
+    c->fd = -1;
+  }
+  xSemaphoreGive(c->io);
+  log_i("Stream client %u left after %u frames (%u skipped)", c->id, c->frames, c->skipped);
+
+  taskENTER_CRITICAL(&clients_lock);
+  c->in_use = false;
+  taskEXIT_CRITICAL(&clients_lock);
+  vTaskDelete(NULL);
+}
+
+static int query_int(httpd_req_t *req, const char *key, int def) {
+  char query[64];
+  char value[16];
+  if (httpd_req_get_url_query_str(req, query, sizeof(query)) != ESP_OK || httpd_query_key_value(query, key, value, sizeof(value)) != ESP_OK) {
+    return def;
+  }
+  return atoi(value);
+}
+
+bool stream_clients_init(httpd_handle_t server) {
+  stream_server = server;
+  frame_hub_set_prefix(stream_part_prefix);
+  for (int i = 0; i < workshop::kMaxStreamClients; i++) {
+    clients[i].fd = -1;
+    clients[i].io = xSemaphoreCreateMutex();
+    if (!clients[i].io || !stream_pacer_init(&clients[i].pacer)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+esp_err_t stream_clients_attach(httpd_req_t *req) {
+  stream_client_t *c = NULL;
+
+  taskENTER_CRITICAL(&clients_lock);
+  for (int i = 0; i < workshop::kMaxStreamClients; i++) {
+    if (!clients[i].in_use) {
+      c = &clients[i];
+      c->in_use = true;
+      break;
+    }
+  }
+  taskEXIT_CRITICAL(&clients_lock);
+
+  if (!c) {
+    log_e("Stream rejected: %u viewers already connected", workshop::kMaxStreamClients);
+    httpd_resp_set_status(req, "503 Service Unavailable");
+    httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
+    return httpd_resp_sendstr(req, "Too many stream viewers");
+  }
+
+  if (httpd_send(req, _STREAM_HEAD, strlen(_STREAM_HEAD)) < 0) {
+    c->in_use = false;
+    return ESP_FAIL;
+  }
+
+  c->id = next_client_id++;
+  c->coalesce = query_int(req, "coalesce", 1) != 0;
+  // ?fps=N paces this viewer, ?fps=0 sends every frame; default kStream.stream_delay_ms
+  stream_pacer_set_fps(&c->pacer, query_int(req, "fps", -1));
+  c->frames = 0;
+  c->skipped = 0;
+  c->bytes = 0;
+  c->overhead = 0;
+  c->fps = 0;
+  c->kbps = 0;
+  c->send_us = 0;
+  c->send_max_us = 0;
+  c->fd = httpd_req_to_sockfd(req);
+  if (xTaskCreatePinnedToCore(stream_sender_task, "stream_tx", STREAM_SENDER_STACK, c, tskIDLE_PRIORITY + 5, NULL, STREAM_SENDER_CORE) != pdPASS) {
+    log_e("Stream sender task failed");
+    c->fd = -1;
+    c->in_use = false;
+    return ESP_FAIL;
+  }
+  log_i("Stream client %u connected", c->id);
+  return ESP_OK;
+}
+
+void stream_clients_close_fn(httpd_handle_t hd, int sockfd) {
+  for (int i = 0; i < workshop::kMaxStreamClients; i++) {
+    stream_client_t *c = &clients[i];
+    if (c->in_use && c->fd == sockfd) {
+      // Unblock a send in progress, then wait for it (or for an exiting
+      // sender's trigger_close) so the fd number is not reused under its feet
+      shutdown(sockfd, SHUT_RDWR);
+      xSemaphoreTake(c->io, portMAX_DELAY);
+      c->fd = -1;
+      xSemaphoreGive(c->io);
+      break;
+    }
+  }
+  close(sockfd);
+}
+
+int stream_clients_stats_json(char *p, size_t size) {
+  size_t len = snprintf(p, size, "[");
+  bool first = true;
+  for (int i = 0; i < workshop::kMaxStreamClients && len < size; i++) {
+    stream_client_t *c = &clients[i];
+    if (!c->in_use) {
+      continue;
+    }
+    len += snprintf(p + len, size - len,
+                    "%s{\"id\":%u,\"fps\":%.1f,\"frames\":%u,\"skipped\":%u,\"kbytes\":%u,\"kbps\":%.0f,\"coalesce\":%u,\"send_ms\":%.2f,\"send_max_ms\":%.2f,"
+                    "\"target_fps\":%.1f,\"late\":%u,\"overhead\":%u}",
+                    first ? "" : ",", c->id, c->fps, c->frames, c->skipped, (uint32_t)(c->bytes / 1024), c->kbps, c->coalesce, c->send_us / 1000.0f,
+                    c->send_max_us / 1000.0f, stream_pacer_target_fps(&c->pacer), c->pacer.late, c->overhead);
+    first = false;
+  }
+  if (len < size) {
+    len += snprintf(p + len, size - len, "]");
+  }
+  return len < size ? len : size - 1;
+}
@@ -0,0 +1,21 @@
+#pragma once
+// stream_clients.h
+// /stream viewers. esp_http_server runs every handler on one task, so a
+// handler that loops forever serves a single viewer. Instead the stream
+// handler writes the multipart response head and hands the socket to a
+// sender task of its own, which sends frames from the frame hub until the
+// viewer goes away. The server is free again for the next viewer at once.
+
+#include <stddef.h>
+#include "esp_http_server.h"
+
+bool stream_clients_init(httpd_handle_t server);
+
+// Body of the /stream handler. Answers 503 when every client slot is taken.
+esp_err_t stream_clients_attach(httpd_req_t *req);
+
+// close_fn of the stream server: stops the sender before the socket closes.
+void stream_clients_close_fn(httpd_handle_t hd, int sockfd);
+
+// JSON array with one object per connected viewer; returns its length.
+int stream_clients_stats_json(char *p, size_t size);
@@ -0,0 +1,60 @@
+// stream_pacer.cpp
+// Fixed-grid frame deadlines for the stream senders.
+#include "stream_pacer.h"
+
+#include "config.h"
+
+static void stream_pacer_fire(void *arg) {
+  xSemaphoreGive(((stream_pacer_t *)arg)->due);
+}
+
+bool stream_pacer_init(stream_pacer_t *pacer) {
+  pacer->due = xSemaphoreCreateBinary();
+  esp_timer_create_args_t timer_args = {};
+  timer_args.callback = stream_pacer_fire;
+  timer_args.arg = pacer;
+  timer_args.name = "stream_pace";
+  return pacer->due && esp_timer_create(&timer_args, &pacer->timer) == ESP_OK;
+}
+
+void stream_pacer_set_fps(stream_pacer_t *pacer, int fps) {
+  if (fps < 0) {
+    pacer->period_us = workshop::kStream.stream_delay_ms * 1000LL;
+  } else {
+    pacer->period_us = fps ? 1000000LL / (fps < STREAM_MAX_FPS ? fps : STREAM_MAX_FPS) : 0;
+  }
+}
+
+void stream_pacer_reset(stream_pacer_t *pacer) {
+  pacer->late = 0;
+  pacer->next_us = esp_timer_get_time();
+  xSemaphoreTake(pacer->due, 0);  // Drop a wake-up left over from the previous viewer
+}
+
+void stream_pacer_wait(stream_pacer_t *pacer) {
+  if (!pacer->period_us) {
+    return;
+  }
+  int64_t wait = pacer->next_us - esp_timer_get_time();
+  if (wait > 0 && esp_timer_start_once(pacer->timer, wait) == ESP_OK) {
+    xSemaphoreTake(pacer->due, portMAX_DELAY);
+  }
+}
+
+void stream_pacer_advance(stream_pacer_t *pacer) {
+  int64_t now = esp_timer_get_time();
+  pacer->next_us += pacer->period_us;
+  if (now - pacer->next_us > pacer->period_us) {
+    // More than a frame behind: start over instead of bursting to catch up
+    pacer->next_us = now;
+    pacer->late++;
+  }
+}
+
+void stream_pacer_restart(stream_pacer_t *pacer) {
+  pacer->next_us = esp_timer_get_time();  // No deadline was missed by the viewer
+}
+
+float stream_pacer_target_fps(const stream_pacer_t *pacer) {
+  return pacer->period_us ? 1000000.0f / pacer->period_us : 0.0f;
+}
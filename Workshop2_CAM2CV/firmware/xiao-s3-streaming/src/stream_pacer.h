@@ -0,0 +1,37 @@
+#pragma once
+// stream_pacer.h
+// Per-viewer frame pacing shared by /stream and /ws senders. Deadlines sit on
+// a fixed grid (next += period), not "period after the last send", so send
+// time and scheduling jitter do not accumulate into drift. The wait is an
+// esp_timer one-shot, finer than the 1 ms FreeRTOS tick.
+
+#include <stdint.h>
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+
+#define STREAM_MAX_FPS 60
+
+typedef struct {
+  int64_t period_us;      // One frame per period, 0 = as fast as frames come
+  int64_t next_us;        // Next deadline
+  esp_timer_handle_t timer;
+  SemaphoreHandle_t due;  // Given by the timer at the deadline
+  uint32_t late;          // Times the viewer fell a whole period behind and the schedule restarted
+} stream_pacer_t;
+
+bool stream_pacer_init(stream_pacer_t *pacer);
+
+// fps < 0: kStream.stream_delay_ms, 0: unpaced, else capped at STREAM_MAX_FPS.
+// Safe while the sender runs; the next deadline keeps its place.
+void stream_pacer_set_fps(stream_pacer_t *pacer, int fps);
+// A new viewer: schedule starts now, counters cleared.
+void stream_pacer_reset(stream_pacer_t *pacer);
+
+// Sender side: wait for the deadline before taking a frame, advance after
+// sending one. With no frame to send (camera stalled), restart instead.
+void stream_pacer_wait(stream_pacer_t *pacer);
+void stream_pacer_advance(stream_pacer_t *pacer);
+void stream_pacer_restart(stream_pacer_t *pacer);
+
+float stream_pacer_target_fps(const stream_pacer_t *pacer);
@@ -0,0 +1,414 @@
+// ws_stream.cpp
+// Binary WebSocket frames from the frame hub, one sender task per /ws viewer.
+#include "ws_stream.h"
+
+#ifdef CONFIG_HTTPD_WS_SUPPORT
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+
+#include "adaptive_quality.h"
+#include "config.h"
+#include "frame_hub.h"
+#include "sensor_roi.h"
+#include "stream_pacer.h"
+
+#if defined(ARDUINO_ARCH_ESP32) && defined(CONFIG_ARDUHAL_ESP_LOG)
+#include "esp32-hal-log.h"
+#endif
+
+#define WS_SENDER_STACK    4096
+#define WS_SENDER_CORE     0     // With Wi-Fi and lwIP, as the /stream senders
+#define WS_FRAME_WAIT_MS   1000  // Re-check the socket (and pause) at least this often
+#define WS_CONTROL_MAX_LEN 64
+
+typedef struct {
+  bool in_use;
+  int fd;                // -1 once the server closed the socket
+  SemaphoreHandle_t io;  // Held while a frame or a reply is written to fd
+  TaskHandle_t task;
+  uint32_t id;
+  bool paused;
+  uint32_t frames;
+  uint32_t skipped;  // Frames published while this viewer was still sending
+  uint64_t bytes;
+  uint32_t overhead;  // Header and WebSocket framing bytes sent with each JPEG
+  stream_pacer_t pacer;
+  float fps;
+  float kbps;
+  uint32_t send_us;  // Average time to send one frame over the last second
+  uint32_t send_max_us;
+} ws_client_t;
+
+static ws_client_t clients[workshop::kMaxWsClients];
+static portMUX_TYPE clients_lock = portMUX_INITIALIZER_UNLOCKED;
+static httpd_handle_t ws_server = NULL;
+static ws_control_fn control_fn = NULL;
+static uint32_t next_client_id = 1;
+
+// WebSocket frame header a server sends for a payload of len bytes (unmasked)
+static uint32_t ws_header_len(size_t len) {
+  return len < 126 ? 2 : len < 65536 ? 4 : 10;
+}
+
+// One message in two fragments, so the JPEG goes out straight from the
+// frame hub slot without being copied behind the header first
+static bool send_frame(ws_client_t *c, const hub_frame_t *frame) {
+  ws_frame_header_t header;
+  header.seq = frame->seq;
+  header.timestamp_us = (uint64_t)frame->timestamp.tv_sec * 1000000 + frame->timestamp.tv_usec;
+  header.width = frame->width;
+  header.height = frame->height;
+
+  httpd_ws_frame_t pkt = {};
+  pkt.type = HTTPD_WS_TYPE_BINARY;
+  pkt.fragmented = true;
+  pkt.final = false;
+  pkt.payload = (uint8_t *)&header;
+  pkt.len = sizeof(header);
+  if (httpd_ws_send_frame_async(ws_server, c->fd, &pkt) != ESP_OK) {
+    return false;
+  }
+  pkt.type = HTTPD_WS_TYPE_CONTINUE;
+  pkt.final = true;
+  pkt.payload = frame->buf;
+  pkt.len = frame->len;
+  return httpd_ws_send_frame_async(ws_server, c->fd, &pkt) == ESP_OK;
+}
+
+static void ws_sender_task(void *arg) {
+  ws_client_t *c = (ws_client_t *)arg;
+  uint32_t last_seq = 0;
+  bool attached = false;
+  int64_t rate_start = esp_timer_get_time();
+  uint32_t rate_frames = 0;
+  uint64_t rate_bytes = 0;
+  int64_t rate_send_us = 0;
+  int64_t rate_send_max_us = 0;
+
+  stream_pacer_reset(&c->pacer);
+  while (true) {
+    if (c->paused) {
+      // Detached, so a paused viewer does not keep the camera running
+      if (attached) {
+        frame_hub_detach();
+        attached = false;
+      }
+      ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(WS_FRAME_WAIT_MS));
+      if (c->fd < 0) {
+        break;
+      }
+      stream_pacer_restart(&c->pacer);
+      continue;
+    }
+    if (!attached) {
+      if (!frame_hub_attach()) {
+        log_e("Frame hub full");
+        break;
+      }
+      attached = true;
+    }
+
+    stream_pacer_wait(&c->pacer);
+    hub_frame_t *frame = frame_hub_acquire(last_seq, pdMS_TO_TICKS(WS_FRAME_WAIT_MS));
+    bool ok = true;
+
+    xSemaphoreTake(c->io, portMAX_DELAY);
+    if (c->fd < 0) {
+      ok = false;
+    } else if (frame) {
+      int64_t send_start = esp_timer_get_time();
+      ok = send_frame(c, frame);
+      if (ok) {
+        int64_t send_time = esp_timer_get_time() - send_start;
+        uint32_t overhead = ws_header_len(sizeof(ws_frame_header_t)) + sizeof(ws_frame_header_t) + ws_header_len(frame->len);
+        rate_frames++;
+        rate_bytes += overhead + frame->len;
+        rate_send_us += send_time;
+        if (send_time > rate_send_max_us) {
+          rate_send_max_us = send_time;
+        }
+        c->frames++;
+        c->bytes += overhead + frame->len;
+        c->overhead = overhead;
+        if (last_seq && frame->seq > last_seq + 1) {
+          c->skipped += frame->seq - last_seq - 1;
+        }
+      }
+    }
+    xSemaphoreGive(c->io);
+
+    if (frame) {
+      last_seq = frame->seq;
+      frame_hub_release(frame);
+      stream_pacer_advance(&c->pacer);
+    } else {
+      stream_pacer_restart(&c->pacer);  // Camera stalled
+    }
+    if (!ok) {
+      break;
+    }
+
+    int64_t now = esp_timer_get_time();
+    if (now - rate_start >= 1000000) {
+      c->fps = rate_frames * 1000000.0f / (now - rate_start);
+      c->kbps = rate_bytes * 8000.0f / (now - rate_start);
+      c->send_us = rate_frames ? rate_send_us / rate_frames : 0;
+      c->send_max_us = rate_send_max_us;
+      if (rate_frames) {
+        adaptive_sample_t sample;
+        sample.busy = (float)rate_send_us / (now - rate_start);
+        sample.fps = c->fps;
+        sample.target_fps = stream_pacer_target_fps(&c->pacer);
+        sample.sending_kbps = rate_send_us ? rate_bytes * 8000 / rate_send_us : 0;
+        sample.frame_bytes = rate_bytes / rate_frames;
+        sample.send_max_us = rate_send_max_us;
+        adaptive_report(&sample);
+      }
+      rate_start = now;
+      rate_frames = 0;
+      rate_bytes = 0;
+      rate_send_us = 0;
+      rate_send_max_us = 0;
+    }
+  }
+  if (attached) {
+    frame_hub_detach();
+  }
+
+  // Still ours: the viewer stalled or a send failed, let the server close it.
+  // fd stays set until the close is queued, under io (as in stream_clients.cpp:
+  // a racing close_fn waits, so the fd cannot be reused before the trigger)
+  xSemaphoreTake(c->io, portMAX_DELAY);
+  if (c->fd >= 0) {
+    httpd_sess_trigger_close(ws_server, c->fd);
+    c->fd = -1;
+  }
+  xSemaphoreGive(c->io);
+  log_i("WebSocket client %u left after %u frames (%u skipped)", c->id, c->frames, c->skipped);
+
+  // Under io too: see wake_sender()
+  xSemaphoreTake(c->io, portMAX_DELAY);
+  taskENTER_CRITICAL(&clients_lock);
+  c->in_use = false;
+  taskEXIT_CRITICAL(&clients_lock);
+  xSemaphoreGive(c->io);
+  vTaskDelete(NULL);
+}
+
+// Call with c->io held. A sender frees its slot under io before deleting
+// itself, so while the slot is in use and still on fd, c->task is alive (the
+// slot may have been freed, or even reused, since find_client()).
+static bool wake_sender(ws_client_t *c, int fd) {
+  if (!c->in_use || c->fd != fd) {
+    return false;
+  }
+  xTaskNotifyGive(c->task);
+  return true;
+}
+
+static ws_client_t *find_client(int fd) {
+  for (int i = 0; i < workshop::kMaxWsClients; i++) {
+    if (clients[i].in_use && clients[i].fd == fd) {
+      return &clients[i];
+    }
+  }
+  return NULL;
+}
+
+// Replies go out under io, between two frames of the sender
+static void send_text(ws_client_t *c, int fd, const char *text) {
+  httpd_ws_frame_t pkt = {};
+  pkt.type = HTTPD_WS_TYPE_TEXT;
+  pkt.payload = (uint8_t *)text;
+  pkt.len = strlen(text);
+  if (c) {
+    xSemaphoreTake(c->io, portMAX_DELAY);
+  }
+  if (!c || c->fd >= 0) {
+    httpd_ws_send_frame_async(ws_server, fd, &pkt);
+  }
+  if (c) {
+    xSemaphoreGive(c->io);
+  }
+}
+
+static int client_stats_json(char *p, size_t size, const ws_client_t *c) {
+  return snprintf(p, size,
+                  "{\"id\":%u,\"fps\":%.1f,\"frames\":%u,\"skipped\":%u,\"kbytes\":%u,\"kbps\":%.0f,\"send_ms\":%.2f,\"send_max_ms\":%.2f,"
+                  "\"target_fps\":%.1f,\"late\":%u,\"overhead\":%u,\"paused\":%u}",
+                  c->id, c->fps, c->frames, c->skipped, (uint32_t)(c->bytes / 1024), c->kbps, c->send_us / 1000.0f, c->send_max_us / 1000.0f,
+                  stream_pacer_target_fps(&c->pacer), c->pacer.late, c->overhead, c->paused);
+}
+
+// "fps=N", "pause", "resume", "stats", "roi=x,y,w,h", or "<variable>=<value>" as on /control
+static void handle_control(ws_client_t *c, int fd, char *msg) {
+  char reply[320];
+  char *value = strchr(msg, '=');
+
+  if (!strcmp(msg, "pause") || !strcmp(msg, "resume")) {
+    c->paused = msg[0] == 'p';
+    xSemaphoreTake(c->io, portMAX_DELAY);
+    wake_sender(c, fd);
+    xSemaphoreGive(c->io);
+    snprintf(reply, sizeof(reply), "ok %s", msg);
+  } else if (!strcmp(msg, "stats")) {
+    client_stats_json(reply, sizeof(reply), c);
+  } else if (!strncmp(msg, "roi=", 4)) {
+    // The one control that is not a number
+    snprintf(reply, sizeof(reply), "%s %s", sensor_roi_set_str(msg + 4) == ESP_OK ? "ok" : "error", msg);
+  } else if (value) {
+    *value++ = 0;
+    int val = atoi(value);
+    int res = -1;
+    if (!strcmp(msg, "fps")) {
+      stream_pacer_set_fps(&c->pacer, val);
+      res = 0;
+    } else if (control_fn) {
+      res = control_fn(msg, val);
+    }
+    snprintf(reply, sizeof(reply), "%s %s=%d", res < 0 ? "error" : "ok", msg, val);
+  } else {
+    snprintf(reply, sizeof(reply), "error unknown command");
+  }
+  send_text(c, fd, reply);
+}
+
+bool ws_stream_init(httpd_handle_t server, ws_control_fn control) {
+  ws_server = server;
+  control_fn = control;
+  for (int i = 0; i < workshop::kMaxWsClients; i++) {
+    clients[i].fd = -1;
+    clients[i].io = xSemaphoreCreateMutex();
+    if (!clients[i].io || !stream_pacer_init(&clients[i].pacer)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+static esp_err_t ws_stream_open(httpd_req_t *req) {
+  int fd = httpd_req_to_sockfd(req);
+  ws_client_t *c = NULL;
+
+  taskENTER_CRITICAL(&clients_lock);
+  for (int i = 0; i < workshop::kMaxWsClients; i++) {
+    if (!clients[i].in_use) {
+      c = &clients[i];
+      c->in_use = true;
+      break;
+    }
+  }
+  taskEXIT_CRITICAL(&clients_lock);
+
+  if (!c) {
+    // The handshake is done by now: say why, then close
+    log_e("WebSocket rejected: %u viewers already connected", workshop::kMaxWsClients);
+    send_text(NULL, fd, "error too many viewers");
+    httpd_sess_trigger_close(ws_server, fd);
+    return ESP_OK;
+  }
+
+  char query[64];
+  char value[32];
+  int fps = -1;
+  if (httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK) {
+    if (httpd_query_key_value(query, "fps", value, sizeof(value)) == ESP_OK) {
+      fps = atoi(value);
+    }
+    if (httpd_query_key_value(query, "roi", value, sizeof(value)) == ESP_OK && sensor_roi_set_str(value) != ESP_OK) {
+      // Answer as the roi= control message does; no sender yet, so no io needed
+      char reply[sizeof(value) + 10];
+      snprintf(reply, sizeof(reply), "error roi=%s", value);
+      log_e("WebSocket: invalid ROI %s", value);
+      send_text(NULL, fd, reply);
+    }
+  }
+  stream_pacer_set_fps(&c->pacer, fps);
+  c->id = next_client_id++;
+  c->paused = false;
+  c->frames = 0;
+  c->skipped = 0;
+  c->bytes = 0;
+  c->overhead = 0;
+  c->fps = 0;
+  c->kbps = 0;
+  c->send_us = 0;
+  c->send_max_us = 0;
+  c->fd = fd;
+  if (xTaskCreatePinnedToCore(ws_sender_task, "ws_tx", WS_SENDER_STACK, c, tskIDLE_PRIORITY + 5, &c->task, WS_SENDER_CORE) != pdPASS) {
+    log_e("WebSocket sender task failed");
+    c->fd = -1;
+    c->in_use = false;
+    return ESP_FAIL;
+  }
+  log_i("WebSocket client %u connected", c->id);
+  return ESP_OK;
+}
+
+esp_err_t ws_stream_handler(httpd_req_t *req) {
+  if (req->method == HTTP_GET) {
+    return ws_stream_open(req);  // Handshake
+  }
+
+  uint8_t buf[WS_CONTROL_MAX_LEN + 1];
+  httpd_ws_frame_t pkt = {};
+  pkt.payload = buf;
+  esp_err_t res = httpd_ws_recv_frame(req, &pkt, WS_CONTROL_MAX_LEN);
+  if (res != ESP_OK) {
+    return res;  // Too long for a control message, or the socket failed: the server closes it
+  }
+  if (pkt.type != HTTPD_WS_TYPE_TEXT) {
+    return ESP_OK;
+  }
+  buf[pkt.len] = 0;
+  int fd = httpd_req_to_sockfd(req);
+  ws_client_t *c = find_client(fd);
+  if (c) {
+    handle_control(c, fd, (char *)buf);
+  }
+  return ESP_OK;
+}
+
+void ws_stream_close_fn(httpd_handle_t hd, int sockfd) {
+  ws_client_t *c = find_client(sockfd);
+  if (c) {
+    // Unblock a send in progress, then wait for it so the fd number is not
+    // reused under the sender's feet
+    shutdown(sockfd, SHUT_RDWR);
+    xSemaphoreTake(c->io, portMAX_DELAY);
+    if (wake_sender(c, sockfd)) {  // A paused sender notices at once
+      c->fd = -1;
+    }
+    xSemaphoreGive(c->io);
+  }
+}
+
+int ws_stream_stats_json(char *p, size_t size) {
+  size_t len = snprintf(p, size, "[");
+  bool first = true;
+  for (int i = 0; i < workshop::kMaxWsClients && len < size; i++) {
+    if (!clients[i].in_use) {
+      continue;
+    }
+    if (!first && len < size) {
+      len += snprintf(p + len, size - len, ",");
+    }
+    if (len < size) {
+      len += client_stats_json(p + len, size - len, &clients[i]);
+    }
+    first = false;
+  }
+  if (len < size) {
+    len += snprintf(p + len, size - len, "]");
+  }
+  return len < size ? len : size - 1;
+}
+
+#endif
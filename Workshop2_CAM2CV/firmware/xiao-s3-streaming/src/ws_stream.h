@@ -0,0 +1,38 @@
+#pragma once
+// ws_stream.h
+// /ws on the stream server: the same frames as /stream, as WebSocket
+// messages. Each frame is one binary message, a ws_frame_header_t followed
+// by the JPEG, with no multipart boundary or text headers. The socket also
+// takes text control messages (fps, pause/resume, stats and the /control
+// variables), so browser and Python clients get a back channel on the same
+// connection. Like /stream, every viewer has a sender task of its own.
+
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_http_server.h"
+
+#ifdef CONFIG_HTTPD_WS_SUPPORT
+
+// Little-endian, in front of every JPEG
+typedef struct __attribute__((packed)) {
+  uint32_t seq;           // Frame hub sequence number, as X-Frame-Seq on /stream
+  uint64_t timestamp_us;  // Capture time, as X-Timestamp
+  uint16_t width;
+  uint16_t height;
+} ws_frame_header_t;
+
+// Applies one /control variable; negative on failure, as in cmd_handler.
+typedef int (*ws_control_fn)(const char *variable, int value);
+
+bool ws_stream_init(httpd_handle_t server, ws_control_fn control);
+
+// Handler of the /ws URI (registered with is_websocket).
+esp_err_t ws_stream_handler(httpd_req_t *req);
+
+// From the stream server's close_fn, before the socket closes.
+void ws_stream_close_fn(httpd_handle_t hd, int sockfd);
+
+// JSON array with one object per connected /ws viewer; returns its length.
+int ws_stream_stats_json(char *p, size_t size);
+
+#endif